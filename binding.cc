@@ -1,4 +1,4 @@
-#define NAPI_VERSION 3
+#define NAPI_VERSION 6
 
 #include <napi-macros.h>
 #include <node_api.h>
@@ -8,17 +8,26 @@
 #include <leveldb/write_batch.h>
 #include <leveldb/cache.h>
 #include <leveldb/filter_policy.h>
+#include <leveldb/compressor.h>
 
 #include <map>
 #include <vector>
+#include <deque>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <atomic>
 #include <optional>
+#include <stdlib.h>
 
 /**
  * Forward declarations.
  */
 struct Database;
+struct BaseWorker;
+struct Dispatcher;
+struct Compaction;
+struct GetWorker;
 struct Resource;
 struct Iterator;
 struct ExplicitSnapshot;
@@ -36,6 +45,7 @@ struct LevelDbHandle
 {
   leveldb::DB *db;
   size_t open_handle_count;
+  std::atomic<uint64_t> *write_sequence;
 };
 static std::mutex handles_mutex;
 // only access this when protected by the handles_mutex!
@@ -323,6 +333,98 @@ static std::string StringProperty (napi_env env, napi_value obj, const char* key
   return "";
 }
 
+/**
+ * Returns the compression type named by a JS value, which is either a
+ * boolean (Snappy or no compression) or a string.
+ * Returns Snappy if the JS value is neither.
+ */
+static leveldb::CompressionType CompressionValue (napi_env env, napi_value value) {
+  if (IsString(env, value)) {
+    size_t size = 0;
+    char buf[8];
+    napi_get_value_string_utf8(env, value, buf, sizeof(buf), &size);
+    const std::string name(buf, size);
+
+    if (name == "none") return leveldb::kNoCompression;
+    if (name == "lz4") return leveldb::kLZ4Compression;
+    if (name == "zstd") return leveldb::kZstdCompression;
+
+    return leveldb::kSnappyCompression;
+  }
+
+  return BooleanValue(env, value, true)
+    ? leveldb::kSnappyCompression
+    : leveldb::kNoCompression;
+}
+
+/**
+ * Returns the compression type named by property 'key' of 'obj'.
+ * Returns Snappy if the property doesn't exist.
+ */
+static leveldb::CompressionType CompressionProperty (napi_env env, napi_value obj,
+                                                     const char* key) {
+  if (HasProperty(env, obj, key)) {
+    return CompressionValue(env, GetProperty(env, obj, key));
+  }
+
+  return leveldb::kSnappyCompression;
+}
+
+/**
+ * Returns the compression types in array property 'key' of 'obj'.
+ * Returns an empty vector if the property doesn't exist.
+ */
+static std::vector<leveldb::CompressionType> CompressionArrayProperty (napi_env env,
+                                                                      napi_value obj,
+                                                                      const char* key) {
+  std::vector<leveldb::CompressionType> result;
+  uint32_t length;
+
+  if (HasProperty(env, obj, key)) {
+    napi_value arr = GetProperty(env, obj, key);
+
+    if (napi_get_array_length(env, arr, &length) == napi_ok) {
+      for (uint32_t i = 0; i < length; i++) {
+        napi_value element;
+
+        if (napi_get_element(env, arr, i, &element) == napi_ok) {
+          result.push_back(CompressionValue(env, element));
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Returns the numbers in array property 'key' of 'obj'.
+ * Returns an empty vector if the property doesn't exist.
+ */
+static std::vector<uint32_t> Uint32ArrayProperty (napi_env env, napi_value obj,
+                                                  const char* key) {
+  std::vector<uint32_t> result;
+  uint32_t length;
+
+  if (HasProperty(env, obj, key)) {
+    napi_value arr = GetProperty(env, obj, key);
+
+    if (napi_get_array_length(env, arr, &length) == napi_ok) {
+      for (uint32_t i = 0; i < length; i++) {
+        napi_value element;
+        uint32_t value;
+
+        if (napi_get_element(env, arr, i, &element) == napi_ok &&
+            napi_get_value_uint32(env, element, &value) == napi_ok) {
+          result.push_back(value);
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
 static void DisposeSliceBuffer (leveldb::Slice slice) {
   if (!slice.empty()) delete [] slice.data();
 }
@@ -435,6 +537,23 @@ private:
   std::string value_;
 };
 
+/**
+ * Scheduling classes of workers, from highest to lowest priority. Queued
+ * workers of a higher class are executed first.
+ */
+enum class Priority : uint8_t {
+  // Point reads and writes
+  interactive = 0,
+  // Iterator reads
+  iterator = 1,
+  // Reads of many keys
+  bulk = 2,
+  // Maintenance like clear() and compactRange()
+  background = 3
+};
+
+static const size_t kPriorityClasses = 4;
+
 /**
  * Base worker class. Handles the async work. Derived classes can override the
  * following virtual methods (listed in the order in which they're called):
@@ -449,30 +568,24 @@ struct BaseWorker {
   BaseWorker (napi_env env,
               Database* database,
               napi_deferred deferred,
-              const char* resourceName)
-    : database_(database), errMsg_(NULL), deferred_(deferred) {
+              Priority priority)
+    : database_(database),
+      priority_(priority),
+      errMsg_(NULL),
+      deferred_(deferred),
+      dispatcher_(NULL) {
     // Note: napi_deferred is a strong reference to the JS promise, so there's no need to
     // create a reference ourselves. See `v8_deferred = new v8::Persistent<v8::Value>()` in:
     // https://github.com/nodejs/node/commit/7efb8f7619100973877c660d0ee527ea3d92de8d
 
-    napi_value asyncResourceName;
-    NAPI_STATUS_THROWS_VOID(napi_create_string_utf8(env, resourceName,
-                                               NAPI_AUTO_LENGTH,
-                                               &asyncResourceName));
-    NAPI_STATUS_THROWS_VOID(napi_create_async_work(env, NULL,
-                                              asyncResourceName,
-                                              BaseWorker::Execute,
-                                              BaseWorker::Complete,
-                                              this, &asyncWork_));
+    NAPI_STATUS_THROWS_VOID(napi_get_instance_data(env, (void**)&dispatcher_));
   }
 
   virtual ~BaseWorker () {
     delete [] errMsg_;
   }
 
-  static void Execute (napi_env env, void* data) {
-    BaseWorker* self = (BaseWorker*)data;
-
+  static void Execute (BaseWorker* self) {
     // Don't pass env to DoExecute() because use of Node-API
     // methods should generally be avoided in async work.
     self->DoExecute();
@@ -496,9 +609,7 @@ struct BaseWorker {
 
   virtual void DoExecute () = 0;
 
-  static void Complete (napi_env env, napi_status status, void* data) {
-    BaseWorker* self = (BaseWorker*)data;
-
+  static void Complete (napi_env env, BaseWorker* self) {
     self->DoComplete(env);
     self->DoFinally(env);
   }
@@ -544,24 +655,262 @@ struct BaseWorker {
   }
 
   virtual void DoFinally (napi_env env) {
-    napi_delete_async_work(env, asyncWork_);
     deferred_ = NULL;
     delete this;
   }
 
-  void Queue (napi_env env) {
-    napi_queue_async_work(env, asyncWork_);
-  }
+  void Queue (napi_env env);
 
   Database* database_;
+  const Priority priority_;
 
 private:
   napi_deferred deferred_;
-  napi_async_work asyncWork_;
+  Dispatcher* dispatcher_;
   leveldb::Status status_;
   char *errMsg_;
+
+  friend struct Dispatcher;
+  friend struct ThreadPool;
+};
+
+/**
+ * Threads that execute workers. Owned by us rather than libuv so that database
+ * operations don't compete with fs, dns and zlib for the 4 threads of libuv,
+ * and so that UV_THREADPOOL_SIZE doesn't dictate database concurrency. The pool
+ * is shared by all environments (i.e. worker threads) of the process. Its size
+ * can be set with the CLASSIC_LEVEL_THREADPOOL_SIZE environment variable.
+ *
+ * Workers are queued per priority class. To keep a thread available for point
+ * reads and writes, bulk and background workers together may occupy at most all
+ * but one of the threads (unless the pool has a single thread).
+ */
+struct ThreadPool {
+  static void Submit (BaseWorker* worker) {
+    static ThreadPool* pool = new ThreadPool(Size());
+    pool->Push(worker);
+  }
+
+private:
+  ThreadPool (size_t size)
+    : sharedLimit_(size > 1 ? size - 1 : 1),
+      sharedRunning_(0) {
+    for (size_t i = 0; i < size; i++) {
+      // Threads live as long as the process
+      std::thread(&ThreadPool::Run, this).detach();
+    }
+  }
+
+  static size_t Size () {
+    const char* value = getenv("CLASSIC_LEVEL_THREADPOOL_SIZE");
+    long size = value != NULL ? strtol(value, NULL, 10) : 0;
+
+    if (size <= 0) return 4;
+    if (size > 1024) return 1024;
+
+    return (size_t)size;
+  }
+
+  void Push (BaseWorker* worker) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    queues_[(size_t)worker->priority_].push_back(worker);
+    lock.unlock();
+    cv_.notify_one();
+  }
+
+  /**
+   * Whether workers of a priority class count towards sharedLimit_.
+   */
+  static bool IsShared (size_t priority) {
+    return priority >= (size_t)Priority::bulk;
+  }
+
+  /**
+   * Take the next worker to execute, if any. Must be called with mutex_ held.
+   */
+  BaseWorker* Next () {
+    for (size_t i = 0; i < kPriorityClasses; i++) {
+      if (queues_[i].empty()) continue;
+
+      if (IsShared(i)) {
+        if (sharedRunning_ >= sharedLimit_) continue;
+        sharedRunning_++;
+      }
+
+      BaseWorker* worker = queues_[i].front();
+      queues_[i].pop_front();
+      return worker;
+    }
+
+    return NULL;
+  }
+
+  /**
+   * Whether bulk or background workers are queued. Must be called with
+   * mutex_ held.
+   */
+  bool HasSharedQueued () const {
+    return !queues_[(size_t)Priority::bulk].empty() ||
+           !queues_[(size_t)Priority::background].empty();
+  }
+
+  void Run ();
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<BaseWorker*> queues_[kPriorityClasses];
+
+  // Combined limit and count of running bulk and background workers
+  const size_t sharedLimit_;
+  size_t sharedRunning_;
 };
 
+/**
+ * Completes workers of one environment on its main thread, by way of a
+ * threadsafe function that only keeps the event loop alive while there
+ * are workers in flight. Like the pool, completes workers of a higher
+ * priority class first, so that e.g. a get() isn't delayed behind the
+ * conversion of large getMany() results to JS.
+ */
+struct Dispatcher {
+  Dispatcher ()
+    : tsfn_(NULL), pending_(0), outstanding_(0) {}
+
+  napi_status Init (napi_env env) {
+    napi_value asyncResourceName;
+    napi_status status = napi_create_string_utf8(env, "classic_level.worker",
+                                                 NAPI_AUTO_LENGTH,
+                                                 &asyncResourceName);
+    if (status != napi_ok) return status;
+
+    status = napi_create_threadsafe_function(env, NULL, NULL, asyncResourceName,
+                                             0, 1, this, Dispatcher::Finalize, this,
+                                             Dispatcher::CallJs, &tsfn_);
+    if (status != napi_ok) return status;
+
+    return napi_unref_threadsafe_function(env, tsfn_);
+  }
+
+  void Submit (napi_env env, BaseWorker* worker) {
+    if (pending_++ == 0) {
+      napi_ref_threadsafe_function(env, tsfn_);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    outstanding_++;
+    lock.unlock();
+
+    ThreadPool::Submit(worker);
+  }
+
+  /**
+   * Called in a thread of the pool after DoExecute().
+   */
+  void Done (BaseWorker* worker) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    completed_[(size_t)worker->priority_].push_back(worker);
+    lock.unlock();
+
+    // Each call completes one worker, not necessarily this one
+    napi_call_threadsafe_function(tsfn_, NULL, napi_tsfn_blocking);
+
+    lock.lock();
+    if (--outstanding_ == 0) idle_.notify_all();
+  }
+
+  /**
+   * Wait for workers that were submitted but not yet executed.
+   */
+  void WaitForIdle () {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return outstanding_ == 0; });
+  }
+
+  static void CallJs (napi_env env, napi_value callback, void* context, void* data) {
+    Dispatcher* self = (Dispatcher*)context;
+    BaseWorker* worker = self->NextCompleted();
+
+    if (env == NULL) {
+      // The environment is being torn down
+      delete worker;
+      return;
+    }
+
+    BaseWorker::Complete(env, worker);
+
+    if (--self->pending_ == 0) {
+      napi_unref_threadsafe_function(env, self->tsfn_);
+    }
+  }
+
+  static void EnvCleanupHook (void* arg) {
+    Dispatcher* self = (Dispatcher*)arg;
+    self->WaitForIdle();
+    napi_release_threadsafe_function(self->tsfn_, napi_tsfn_release);
+  }
+
+private:
+  BaseWorker* NextCompleted () {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (size_t i = 0; i < kPriorityClasses; i++) {
+      if (!completed_[i].empty()) {
+        BaseWorker* worker = completed_[i].front();
+        completed_[i].pop_front();
+        return worker;
+      }
+    }
+
+    // Unreachable because there's one call per completed worker
+    assert(false);
+    return NULL;
+  }
+
+  static void Finalize (napi_env env, void* data, void* hint) {
+    delete (Dispatcher*)data;
+  }
+
+  napi_threadsafe_function tsfn_;
+
+  // Only accessed on the main thread
+  size_t pending_;
+
+  std::mutex mutex_;
+  std::condition_variable idle_;
+  size_t outstanding_;
+  std::deque<BaseWorker*> completed_[kPriorityClasses];
+};
+
+void BaseWorker::Queue (napi_env env) {
+  dispatcher_->Submit(env, this);
+}
+
+void ThreadPool::Run () {
+  BaseWorker* worker;
+
+  while (true) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this, &worker] { return (worker = Next()) != NULL; });
+    lock.unlock();
+
+    // The worker may be deleted once done
+    const size_t priority = (size_t)worker->priority_;
+
+    BaseWorker::Execute(worker);
+    worker->dispatcher_->Done(worker);
+
+    if (!IsShared(priority)) continue;
+
+    lock.lock();
+    const bool blocked = sharedRunning_-- == sharedLimit_ && HasSharedQueued();
+    lock.unlock();
+
+    // Another thread may be waiting for the shared classes to drop below
+    // their limit
+    if (blocked) cv_.notify_one();
+  }
+}
+
 /**
  * Owns the LevelDB storage, cache, filter policy and resources.
  */
@@ -570,9 +919,14 @@ struct Database {
     : db_(NULL),
       sharedBuffer_(NULL),
       blockCache_(NULL),
-      filterPolicy_(leveldb::NewBloomFilterPolicy(10)),
+      compressedBlockCache_(NULL),
+      rowCache_(NULL),
+      filterPolicy_(NULL),
       resourceSequence_(0),
       pendingCloseWorker_(NULL),
+      dispatcher_(NULL),
+      coalesceGets_(false),
+      writeSequence_(NULL),
       ref_(NULL),
       sharedBufferRef_(NULL),
       priorityWork_(0) {}
@@ -598,12 +952,20 @@ struct Database {
       delete blockCache_;
       blockCache_ = NULL;
     }
+    if (compressedBlockCache_) {
+      delete compressedBlockCache_;
+      compressedBlockCache_ = NULL;
+    }
+    if (rowCache_) {
+      delete rowCache_;
+      rowCache_ = NULL;
+    }
   }
 
   leveldb::Status Put (const leveldb::WriteOptions& options,
                        leveldb::Slice key,
                        leveldb::Slice value) {
-    return db_->Put(options, key, value);
+    return Written(db_->Put(options, key, value));
   }
 
   leveldb::Status Get (const leveldb::ReadOptions& options,
@@ -612,14 +974,23 @@ struct Database {
     return db_->Get(options, key, &value);
   }
 
+  // Read the table blocks of many keys at once, ahead of getting them
+  void Prefetch (const leveldb::ReadOptions& options,
+                 const std::vector<std::string>& keys) {
+    if (keys.size() > 1) {
+      std::vector<leveldb::Slice> slices(keys.begin(), keys.end());
+      db_->Prefetch(options, slices.data(), slices.size());
+    }
+  }
+
   leveldb::Status Del (const leveldb::WriteOptions& options,
                        leveldb::Slice key) {
-    return db_->Delete(options, key);
+    return Written(db_->Delete(options, key));
   }
 
   leveldb::Status WriteBatch (const leveldb::WriteOptions& options,
                               leveldb::WriteBatch* batch) {
-    return db_->Write(options, batch);
+    return Written(db_->Write(options, batch));
   }
 
   uint64_t ApproximateSize (const leveldb::Range* range) {
@@ -628,9 +999,17 @@ struct Database {
     return size;
   }
 
-  void CompactRange (const leveldb::Slice* start,
-                     const leveldb::Slice* end) {
-    db_->CompactRange(start, end);
+  leveldb::Status CompactRangeAsync (const leveldb::Slice* start,
+                                     const leveldb::Slice* end,
+                                     leveldb::CompactRangeListener* listener) {
+    return db_->CompactRangeAsync(start, end, listener);
+  }
+
+  leveldb::Status DeleteFilesInRange (const leveldb::Slice* begin,
+                                      const leveldb::Slice* end,
+                                      const leveldb::Snapshot* snapshot,
+                                      int* deleted) {
+    return Written(db_->DeleteFilesInRange(begin, end, snapshot, deleted));
   }
 
   void GetProperty (const leveldb::Slice& property, std::string* value) {
@@ -702,13 +1081,31 @@ struct Database {
   leveldb::DB* db_;
   char* sharedBuffer_;
   leveldb::Cache* blockCache_;
+  leveldb::Cache* compressedBlockCache_;
+  leveldb::Cache* rowCache_;
   const leveldb::FilterPolicy* filterPolicy_;
   uint32_t resourceSequence_;
   BaseWorker *pendingCloseWorker_;
   std::map<uint32_t, Resource*> resources_;
+  std::map<uint32_t, Compaction*> compactions_;
+  Dispatcher* dispatcher_;
+
+  // Gets that can be joined by identical gets, if coalesceGets_ is true
+  bool coalesceGets_;
+  std::map<std::string, GetWorker*> pendingGets_;
+
+  // Incremented after every write, to know if a pending get may have missed
+  // it. Shared by all instances that share a db_ with multithreading.
+  std::atomic<uint64_t>* writeSequence_;
+
   napi_ref ref_;
 
 private:
+  leveldb::Status Written (const leveldb::Status& status) {
+    (*writeSequence_)++;
+    return status;
+  }
+
   napi_ref sharedBufferRef_;
   std::atomic<uint32_t> priorityWork_;
   std::string location_;
@@ -722,12 +1119,41 @@ private:
 };
 
 
+/**
+ * Filter policies by type and bits per key. These are never deleted, because
+ * a LevelDB handle that uses one can be shared between Database instances.
+ */
+static std::mutex filter_policies_mutex;
+static std::map<std::pair<std::string, uint32_t>, const leveldb::FilterPolicy*> filter_policies;
+
+static const leveldb::FilterPolicy* GetFilterPolicy (const std::string& type,
+                                                     const uint32_t bitsPerKey) {
+  if (bitsPerKey == 0) return NULL;
+
+  std::unique_lock<std::mutex> lock(filter_policies_mutex);
+  const leveldb::FilterPolicy*& policy = filter_policies[std::make_pair(type, bitsPerKey)];
+
+  if (policy == NULL) {
+    if (type == "blocked-bloom") {
+      policy = leveldb::NewBlockedBloomFilterPolicy(bitsPerKey);
+    } else if (type == "ribbon") {
+      policy = leveldb::NewRibbonFilterPolicy(bitsPerKey);
+    } else {
+      policy = leveldb::NewBloomFilterPolicy(bitsPerKey);
+    }
+  }
+
+  return policy;
+}
+
 leveldb::Status threadsafe_open(const leveldb::Options &options,
                                 bool multithreading,
                                 Database &db_instance) {
   // Bypass lock and handles if multithreading is disabled
   if (!multithreading) {
-    return leveldb::DB::Open(options, db_instance.location_, &db_instance.db_);
+    leveldb::Status status = leveldb::DB::Open(options, db_instance.location_, &db_instance.db_);
+    if (status.ok()) db_instance.writeSequence_ = new std::atomic<uint64_t>(0);
+    return status;
   }
 
   std::unique_lock<std::mutex> lock(handles_mutex);
@@ -736,12 +1162,14 @@ leveldb::Status threadsafe_open(const leveldb::Options &options,
   if (it == db_handles.end()) {
     // Database not opened yet for this location, unless it was with
     // multithreading disabled, in which case we're expected to fail here.
-    LevelDbHandle handle = {nullptr, 0};
+    LevelDbHandle handle = {nullptr, 0, nullptr};
     leveldb::Status status = leveldb::DB::Open(options, db_instance.location_, &handle.db);
 
     if (status.ok()) {
       handle.open_handle_count++;
+      handle.write_sequence = new std::atomic<uint64_t>(0);
       db_instance.db_ = handle.db;
+      db_instance.writeSequence_ = handle.write_sequence;
       db_handles[db_instance.location_] = handle;
     }
 
@@ -750,6 +1178,7 @@ leveldb::Status threadsafe_open(const leveldb::Options &options,
 
   ++(it->second.open_handle_count);
   db_instance.db_ = it->second.db;
+  db_instance.writeSequence_ = it->second.write_sequence;
 
   return leveldb::Status::OK();
 }
@@ -761,13 +1190,16 @@ leveldb::Status threadsafe_close(Database &db_instance) {
   if (it == db_handles.end()) {
     // Was not opened with multithreading enabled
     delete db_instance.db_;
+    delete db_instance.writeSequence_;
   } else if (--(it->second.open_handle_count) == 0) {
     delete it->second.db;
+    delete it->second.write_sequence;
     db_handles.erase(it);
   }
 
   // ensure db_ pointer is nullified in Database instance
   db_instance.db_ = NULL;
+  db_instance.writeSequence_ = NULL;
   return leveldb::Status::OK();
 }
 
@@ -829,8 +1261,8 @@ struct ExplicitSnapshot final : public Resource {
  * Base worker class for doing async work that defers closing the database.
  */
 struct PriorityWorker : public BaseWorker {
-  PriorityWorker (napi_env env, Database* database, napi_deferred deferred, const char* resourceName)
-    : BaseWorker(env, database, deferred, resourceName) {
+  PriorityWorker (napi_env env, Database* database, napi_deferred deferred, Priority priority)
+    : BaseWorker(env, database, deferred, priority) {
       database_->IncrementPriorityWork(env);
   }
 
@@ -894,6 +1326,29 @@ struct BaseIterator {
     return didSeek_;
   }
 
+  const leveldb::Snapshot* CurrentSnapshot () const {
+    return options_->snapshot;
+  }
+
+  /**
+   * Delete the leveldb iterator but keep its snapshot, so that the table
+   * files it references can be unlinked. Must be followed by Refresh().
+   */
+  void ReleaseIterator () {
+    delete dbIterator_;
+    dbIterator_ = NULL;
+  }
+
+  /**
+   * Recreate the leveldb iterator, with the same snapshot, in order to
+   * observe table files that were since removed.
+   */
+  void Refresh () {
+    delete dbIterator_;
+    dbIterator_ = database_->NewIterator(options_);
+    didSeek_ = false;
+  }
+
   /**
    * Seek to the first relevant key based on range options.
    */
@@ -959,15 +1414,6 @@ struct BaseIterator {
     }
   }
 
-  /**
-   * Seek to an exact key.
-   */
-  bool SeekExact (leveldb::Slice& target) {
-    didSeek_ = true;
-    dbIterator_->Seek(target);
-    return dbIterator_->Valid() && dbIterator_->key() == target;
-  }
-
   void CloseIterator () {
     if (!hasClosed_) {
       hasClosed_ = true;
@@ -1144,12 +1590,13 @@ struct Iterator final : public BaseIterator, public Resource {
 };
 
 /**
- * Hook for when the environment exits. This hook will be called after
- * already-scheduled napi_async_work items have finished, which gives us
- * the guarantee that no db operations will be in-flight at this time.
+ * Hook for when the environment exits. This hook first waits for workers
+ * that were already submitted to finish their work, which gives us the
+ * guarantee that no db operations will be in-flight at this time.
  */
 static void env_cleanup_hook (void* arg) {
   Database* database = (Database*)arg;
+  database->dispatcher_->WaitForIdle();
 
   // Do everything that db.close() does but synchronously. We're expecting that GC
   // did not (yet) collect the database because that would be a user mistake (not
@@ -1183,6 +1630,7 @@ static void FinalizeDatabase (napi_env env, void* data, void* hint) {
  */
 NAPI_METHOD(db_init) {
   Database* database = new Database();
+  NAPI_STATUS_THROWS(napi_get_instance_data(env, (void**)&database->dispatcher_));
   napi_add_env_cleanup_hook(env, env_cleanup_hook, database);
 
   napi_value result;
@@ -1207,28 +1655,58 @@ struct OpenWorker final : public BaseWorker {
               const std::string& location,
               const bool createIfMissing,
               const bool errorIfExists,
-              const bool compression,
+              const leveldb::CompressionType compression,
               const bool multithreading,
+              const bool wholeTableFilter,
+              const bool cacheIndexAndFilterBlocks,
+              const bool dataBlockHashIndex,
+              const bool cacheDecodedBlocks,
               const uint32_t writeBufferSize,
               const uint32_t blockSize,
               const uint32_t maxOpenFiles,
               const uint32_t blockRestartInterval,
-              const uint32_t maxFileSize)
-    : BaseWorker(env, database, deferred, "classic_level.db.open"),
+              const uint32_t maxFileSize,
+              const uint32_t indexPartitionSize,
+              const uint32_t negativeCacheSize,
+              const std::vector<leveldb::CompressionType>& compressionPerLevel,
+              const std::vector<uint32_t>& blockSizePerLevel,
+              const std::vector<uint32_t>& blockRestartIntervalPerLevel,
+              const uint32_t compressionDictionarySize,
+              const uint32_t compressionThreads,
+              const bool mmapReads,
+              const uint32_t maxMmapFiles,
+              const bool directIO)
+    : BaseWorker(env, database, deferred, Priority::interactive),
       location_(location),
       multithreading_(multithreading) {
     options_.block_cache = database->blockCache_;
+    options_.compressed_block_cache = database->compressedBlockCache_;
+    options_.row_cache = database->rowCache_;
     options_.filter_policy = database->filterPolicy_;
+    options_.whole_table_filter = wholeTableFilter;
+    options_.cache_index_and_filter_blocks = cacheIndexAndFilterBlocks;
     options_.create_if_missing = createIfMissing;
     options_.error_if_exists = errorIfExists;
-    options_.compression = compression
-      ? leveldb::kSnappyCompression
-      : leveldb::kNoCompression;
+    options_.compression = compression;
     options_.write_buffer_size = writeBufferSize;
     options_.block_size = blockSize;
     options_.max_open_files = maxOpenFiles;
     options_.block_restart_interval = blockRestartInterval;
     options_.max_file_size = maxFileSize;
+    options_.index_partition_size = indexPartitionSize;
+    options_.data_block_hash_index = dataBlockHashIndex;
+    options_.cache_decoded_blocks = cacheDecodedBlocks;
+    options_.negative_cache_entries = negativeCacheSize;
+    options_.compression_per_level = compressionPerLevel;
+    options_.block_size_per_level.assign(blockSizePerLevel.begin(),
+                                         blockSizePerLevel.end());
+    options_.block_restart_interval_per_level.assign(blockRestartIntervalPerLevel.begin(),
+                                                     blockRestartIntervalPerLevel.end());
+    options_.compression_dictionary_size = compressionDictionarySize;
+    options_.compression_threads = compressionThreads;
+    options_.mmap_reads = mmapReads;
+    options_.max_mmap_files = maxMmapFiles;
+    options_.use_direct_io = directIO;
   }
 
   ~OpenWorker () {}
@@ -1254,26 +1732,61 @@ NAPI_METHOD(db_open) {
   napi_value options = argv[2];
   const bool createIfMissing = BooleanProperty(env, options, "createIfMissing", true);
   const bool errorIfExists = BooleanProperty(env, options, "errorIfExists", false);
-  const bool compression = BooleanProperty(env, options, "compression", true);
+  const leveldb::CompressionType compression = CompressionProperty(env, options, "compression");
   const bool multithreading = BooleanProperty(env, options, "multithreading", false);
+  const bool wholeTableFilter = BooleanProperty(env, options, "wholeTableFilter", false);
+  const bool cacheIndexAndFilterBlocks = BooleanProperty(env, options,
+                                                         "cacheIndexAndFilterBlocks", false);
+  const bool dataBlockHashIndex = BooleanProperty(env, options, "dataBlockHashIndex", false);
+  const bool cacheDecodedBlocks = BooleanProperty(env, options, "cacheDecodedBlocks", false);
+  database->coalesceGets_ = BooleanProperty(env, options, "coalesceGets", false);
 
   const uint32_t cacheSize = Uint32Property(env, options, "cacheSize", 8 << 20);
+  const uint32_t compressedCacheSize = Uint32Property(env, options, "compressedCacheSize", 0);
+  const uint32_t rowCacheSize = Uint32Property(env, options, "rowCacheSize", 0);
+  const uint32_t negativeCacheSize = Uint32Property(env, options, "negativeCacheSize", 0);
+  const uint32_t filterBitsPerKey = Uint32Property(env, options, "filterBitsPerKey", 10);
+  const std::string filterType = StringProperty(env, options, "filterType");
   const uint32_t writeBufferSize = Uint32Property(env, options , "writeBufferSize" , 4 << 20);
   const uint32_t blockSize = Uint32Property(env, options, "blockSize", 4096);
   const uint32_t maxOpenFiles = Uint32Property(env, options, "maxOpenFiles", 1000);
   const uint32_t blockRestartInterval = Uint32Property(env, options,
                                                  "blockRestartInterval", 16);
   const uint32_t maxFileSize = Uint32Property(env, options, "maxFileSize", 2 << 20);
+  const uint32_t indexPartitionSize = Uint32Property(env, options, "indexPartitionSize", 0);
+  const std::vector<leveldb::CompressionType> compressionPerLevel =
+    CompressionArrayProperty(env, options, "compressionPerLevel");
+  const std::vector<uint32_t> blockSizePerLevel =
+    Uint32ArrayProperty(env, options, "blockSizePerLevel");
+  const std::vector<uint32_t> blockRestartIntervalPerLevel =
+    Uint32ArrayProperty(env, options, "blockRestartIntervalPerLevel");
+  const uint32_t compressionDictionarySize = Uint32Property(env, options,
+                                                            "compressionDictionarySize", 0);
+  const uint32_t compressionThreads = Uint32Property(env, options, "compressionThreads", 0);
+  const bool mmapReads = BooleanProperty(env, options, "mmapReads", false);
+  const uint32_t maxMmapFiles = Uint32Property(env, options, "maxMmapFiles", 1000);
+  const bool directIO = BooleanProperty(env, options, "directIO", false);
 
   database->blockCache_ = leveldb::NewLRUCache(cacheSize);
+  database->compressedBlockCache_ = compressedCacheSize > 0
+    ? leveldb::NewLRUCache(compressedCacheSize) : NULL;
+  database->filterPolicy_ = GetFilterPolicy(filterType, filterBitsPerKey);
+  database->rowCache_ = rowCacheSize > 0 ? leveldb::NewLRUCache(rowCacheSize) : NULL;
 
   OpenWorker* worker = new OpenWorker(
     env, database, deferred, location,
     createIfMissing, errorIfExists,
     compression, multithreading,
+    wholeTableFilter, cacheIndexAndFilterBlocks,
+    dataBlockHashIndex, cacheDecodedBlocks,
     writeBufferSize, blockSize,
     maxOpenFiles, blockRestartInterval,
-    maxFileSize
+    maxFileSize, indexPartitionSize,
+    negativeCacheSize, compressionPerLevel,
+    blockSizePerLevel, blockRestartIntervalPerLevel,
+    compressionDictionarySize, compressionThreads,
+    mmapReads, maxMmapFiles,
+    directIO
   );
 
   worker->Queue(env);
@@ -1290,7 +1803,7 @@ NAPI_METHOD(db_open) {
  */
 struct CloseWorker final : public BaseWorker {
   CloseWorker (napi_env env, Database* database, napi_deferred deferred)
-    : BaseWorker(env, database, deferred, "classic_level.db.close") {}
+    : BaseWorker(env, database, deferred, Priority::interactive) {}
 
   ~CloseWorker () {}
 
@@ -1340,7 +1853,7 @@ struct PutWorker final : public PriorityWorker {
              leveldb::Slice key,
              leveldb::Slice value,
              bool sync)
-    : PriorityWorker(env, database, deferred, "classic_level.db.put"),
+    : PriorityWorker(env, database, deferred, Priority::interactive),
       key_(key), value_(value) {
     options_.sync = sync;
   }
@@ -1388,10 +1901,11 @@ struct GetWorker final : public PriorityWorker {
              leveldb::Slice key,
              napi_ref keyRef,
              ExplicitSnapshot* snapshot)
-    : PriorityWorker(env, database, deferred, "classic_level.db.get"),
+    : PriorityWorker(env, database, deferred, Priority::interactive),
       flags_(flags),
       key_(key),
-      keyRef_(keyRef) {
+      keyRef_(keyRef),
+      writeSequence_(*database->writeSequence_) {
     options_.fill_cache = (flags & Flags::FILL_CACHE) != 0;
 
     if (snapshot == NULL) {
@@ -1417,11 +1931,64 @@ struct GetWorker final : public PriorityWorker {
   }
 
   void DoFinally (napi_env env) override {
+    if (!coalesceId_.empty()) {
+      // A get that could not join this one may have taken its place
+      auto it = database_->pendingGets_.find(coalesceId_);
+      if (it != database_->pendingGets_.end() && it->second == this) {
+        database_->pendingGets_.erase(it);
+      }
+    }
+
     if (keyRef_) napi_delete_reference(env, keyRef_);
     PriorityWorker::DoFinally(env);
   }
 
   void HandleOKCallback (napi_env env, napi_deferred deferred) override {
+    Resolve(env, deferred);
+
+    for (napi_deferred follower : followers_) {
+      Resolve(env, follower);
+    }
+  }
+
+  void HandleErrorCallback (napi_env env, napi_deferred deferred) override {
+    PriorityWorker::HandleErrorCallback(env, deferred);
+
+    for (napi_deferred follower : followers_) {
+      PriorityWorker::HandleErrorCallback(env, follower);
+    }
+  }
+
+  /**
+   * Allow identical gets to join this one, until it completes.
+   */
+  void Lead (const std::string& coalesceId) {
+    coalesceId_ = coalesceId;
+    database_->pendingGets_[coalesceId_] = this;
+  }
+
+  /**
+   * Resolve an identical get with the result of this one, if no writes
+   * happened since this get was started. Otherwise the result might miss
+   * a write that the caller of the identical get has already seen.
+   */
+  bool Join (napi_deferred deferred) {
+    if (*database_->writeSequence_ != writeSequence_) {
+      return false;
+    }
+
+    followers_.push_back(deferred);
+    return true;
+  }
+
+  static std::string CoalesceId (uint32_t flags, const leveldb::Slice& key) {
+    std::string id((const char*)&flags, sizeof(flags));
+    id.append(key.data(), key.size());
+    return id;
+  }
+
+private:
+  void Resolve (napi_env env, napi_deferred deferred) {
     napi_value argv;
 
     if ((flags_ & Flags::VALUE_AS_BUFFER) != 0) {
@@ -1433,13 +2000,15 @@ struct GetWorker final : public PriorityWorker {
     napi_resolve_deferred(env, deferred, argv);
   }
 
-private:
   leveldb::ReadOptions options_;
   uint32_t flags_;
   leveldb::Slice key_;
   napi_ref keyRef_;
   std::string value_;
   const leveldb::Snapshot* implicitSnapshot_;
+  const uint64_t writeSequence_;
+  std::string coalesceId_;
+  std::vector<napi_deferred> followers_;
 };
 
 /**
@@ -1460,12 +2029,23 @@ private:
   size_t keySize;
   GetWorker* worker;
 
+  // Coalesce with a pending get of the same key, unless reading from a snapshot
+  const bool coalesce = database->coalesceGets_ && snapshot == NULL;
+  std::string coalesceId;
+
   if ((flags & Flags::KEY_AS_BUFFER) != 0) {
+    NAPI_STATUS_THROWS(napi_get_typedarray_info(env, argv[2], NULL, &keySize, (void**)&keyBuffer, NULL, NULL));
+    leveldb::Slice keySlice(keyBuffer, keySize);
+
+    if (coalesce) {
+      coalesceId = GetWorker::CoalesceId(flags, keySlice);
+      auto it = database->pendingGets_.find(coalesceId);
+      if (it != database->pendingGets_.end() && it->second->Join(deferred)) return promise;
+    }
+
     // Instead of copying the memory, create a reference so that it stays valid
     napi_ref keyRef;
     NAPI_STATUS_THROWS(napi_create_reference(env, argv[2], 1, &keyRef));
-    NAPI_STATUS_THROWS(napi_get_typedarray_info(env, argv[2], NULL, &keySize, (void**)&keyBuffer, NULL, NULL));
-    leveldb::Slice keySlice(keyBuffer, keySize);
     worker = new GetWorker(env, database, deferred, flags, keySlice, keyRef, snapshot);
   } else {
     NAPI_STATUS_THROWS(napi_get_value_string_utf8(env, argv[2], NULL, 0, &keySize));
@@ -1474,11 +2054,22 @@ private:
     keyBuffer[keySize] = '\0';
     leveldb::Slice keySlice(keyBuffer, keySize);
 
+    if (coalesce) {
+      coalesceId = GetWorker::CoalesceId(flags, keySlice);
+      auto it = database->pendingGets_.find(coalesceId);
+
+      if (it != database->pendingGets_.end() && it->second->Join(deferred)) {
+        delete [] keyBuffer;
+        return promise;
+      }
+    }
+
     // A null keyRef implies that keyBuffer needs to be deleted after the read
     // TODO: solve in a more obvious way like a subclass
     worker = new GetWorker(env, database, deferred, flags, keySlice, NULL, snapshot);
   }
 
+  if (coalesce) worker->Lead(coalesceId);
   worker->Queue(env);
   return promise;
 }
@@ -1576,6 +2167,13 @@ NAPI_METHOD(db_set_shared_buffer) {
   return undefined;
 }
 
+/**
+ * Value sink for when only the existence of a key matters.
+ */
+struct DiscardValueSink : public leveldb::ValueSink {
+  void assign (const char* s, size_t n) override {}
+};
+
 /**
  * Worker class for db.has().
  */
@@ -1587,27 +2185,34 @@ struct HasWorker final : public PriorityWorker {
     leveldb::Slice key,
     const bool fillCache,
     ExplicitSnapshot* snapshot
-  ) : PriorityWorker(env, database, deferred, "classic_level.db.has"),
+  ) : PriorityWorker(env, database, deferred, Priority::interactive),
       key_(key) {
-    iterator_ = new BaseIterator(
-      database,
-      // Range options (not relevant)
-      false, NULL, NULL, NULL, NULL, -1,
-      fillCache,
-      snapshot
-    );
+    options_.fill_cache = fillCache;
+
+    if (snapshot == NULL) {
+      implicitSnapshot_ = database->NewSnapshot();
+      options_.snapshot = implicitSnapshot_;
+    } else {
+      implicitSnapshot_ = NULL;
+      options_.snapshot = snapshot->nut;
+    }
   }
 
   ~HasWorker () {
     DisposeSliceBuffer(key_);
-    delete iterator_;
   }
 
   void DoExecute () override {
-    // LevelDB has no Has() method so use an iterator
-    result_ = iterator_->SeekExact(key_);
-    SetStatus(iterator_->Status());
-    iterator_->CloseIterator();
+    // LevelDB has no Has() method so do a Get() without copying the value
+    DiscardValueSink sink;
+    leveldb::Status status = database_->Get(options_, key_, sink);
+
+    result_ = status.ok();
+    if (!status.IsNotFound()) SetStatus(status);
+
+    if (implicitSnapshot_) {
+      database_->ReleaseSnapshot(implicitSnapshot_);
+    }
   }
 
   void HandleOKCallback (napi_env env, napi_deferred deferred) override {
@@ -1617,8 +2222,9 @@ struct HasWorker final : public PriorityWorker {
   }
 
 private:
+  leveldb::ReadOptions options_;
   leveldb::Slice key_;
-  BaseIterator* iterator_;
+  const leveldb::Snapshot* implicitSnapshot_;
   bool result_;
 };
 
@@ -1655,7 +2261,7 @@ struct GetManyWorker final : public PriorityWorker {
                  const Encoding valueEncoding,
                  const bool fillCache,
                  ExplicitSnapshot* snapshot)
-    : PriorityWorker(env, database, deferred, "classic_level.get.many"),
+    : PriorityWorker(env, database, deferred, Priority::bulk),
       keys_(std::move(keys)), valueEncoding_(valueEncoding) {
       options_.fill_cache = fillCache;
 
@@ -1670,6 +2276,7 @@ struct GetManyWorker final : public PriorityWorker {
 
   void DoExecute () override {
     cache_.reserve(keys_.size());
+    database_->Prefetch(options_, keys_);
 
     for (const std::string& key: keys_) {
       std::string* value = new std::string();
@@ -1762,39 +2369,45 @@ struct HasManyWorker final : public PriorityWorker {
     uint32_t* bitset,
     const bool fillCache,
     ExplicitSnapshot* snapshot
-  ) : PriorityWorker(env, database, deferred, "classic_level.has.many"),
+  ) : PriorityWorker(env, database, deferred, Priority::bulk),
       keys_(std::move(keys)),
       bitset_(bitset) {
-    iterator_ = new BaseIterator(
-      database,
-      // Range options (not relevant)
-      false, NULL, NULL, NULL, NULL, -1,
-      fillCache,
-      snapshot
-    );
-  }
+    options_.fill_cache = fillCache;
 
-  ~HasManyWorker () {
-    delete iterator_;
+    if (snapshot == NULL) {
+      implicitSnapshot_ = database->NewSnapshot();
+      options_.snapshot = implicitSnapshot_;
+    } else {
+      implicitSnapshot_ = NULL;
+      options_.snapshot = snapshot->nut;
+    }
   }
 
   void DoExecute () override {
+    DiscardValueSink sink;
+    database_->Prefetch(options_, keys_);
+
     for (size_t i = 0; i != keys_.size(); i++) {
-      leveldb::Slice target = leveldb::Slice(keys_[i]);
+      leveldb::Status status = database_->Get(options_, keys_[i], sink);
 
-      if (iterator_->SeekExact(target)) {
+      if (status.ok()) {
         bitset_[i >> 5] |= 1 << (i & 31); // Set bit
+      } else if (!status.IsNotFound()) {
+        SetStatus(status);
+        break;
       }
     }
 
-    SetStatus(iterator_->Status());
-    iterator_->CloseIterator();
+    if (implicitSnapshot_) {
+      database_->ReleaseSnapshot(implicitSnapshot_);
+    }
   }
 
 private:
+  leveldb::ReadOptions options_;
   const std::vector<std::string> keys_;
   uint32_t* bitset_;
-  BaseIterator* iterator_;
+  const leveldb::Snapshot* implicitSnapshot_;
 };
 
 /**
@@ -1831,7 +2444,7 @@ struct DelWorker final : public PriorityWorker {
              napi_deferred deferred,
              leveldb::Slice key,
              bool sync)
-    : PriorityWorker(env, database, deferred, "classic_level.db.del"),
+    : PriorityWorker(env, database, deferred, Priority::interactive),
       key_(key) {
     options_.sync = sync;
   }
@@ -1879,7 +2492,27 @@ struct ClearWorker final : public PriorityWorker {
                std::string* gt,
                std::string* gte,
                ExplicitSnapshot* snapshot)
-    : PriorityWorker(env, database, deferred, "classic_level.db.clear") {
+    : PriorityWorker(env, database, deferred, Priority::background) {
+    // Table files that are fully covered by the range can be dropped without
+    // reading them, but not if that would remove entries that should survive
+    dropFiles_ = snapshot == NULL && limit < 0;
+
+    // Convert to a [begin, end) range, where appending a zero byte yields the
+    // smallest key that sorts after the original key.
+    if (gte != NULL) {
+      begin_.emplace(*gte);
+    } else if (gt != NULL) {
+      begin_.emplace(*gt);
+      begin_->push_back('\0');
+    }
+
+    if (lte != NULL) {
+      end_.emplace(*lte);
+      end_->push_back('\0');
+    } else if (lt != NULL) {
+      end_.emplace(*lt);
+    }
+
     iterator_ = new BaseIterator(database, reverse, lt, lte, gt, gte, limit, false, snapshot);
     writeOptions_ = new leveldb::WriteOptions();
     writeOptions_->sync = false;
@@ -1891,6 +2524,28 @@ struct ClearWorker final : public PriorityWorker {
   }
 
   void DoExecute () override {
+    if (dropFiles_) {
+      leveldb::Slice begin, end;
+      if (begin_) begin = *begin_;
+      if (end_) end = *end_;
+      int deleted = 0;
+
+      // The iterator pins the current version, which would keep the removed
+      // files on disk until some later compaction. Its snapshot stays alive.
+      iterator_->ReleaseIterator();
+
+      if (!SetStatus(database_->DeleteFilesInRange(begin_ ? &begin : NULL,
+                                                   end_ ? &end : NULL,
+                                                   iterator_->CurrentSnapshot(),
+                                                   &deleted))) {
+        iterator_->CloseIterator();
+        return;
+      }
+
+      // Only the remaining keys have to be deleted one by one
+      iterator_->Refresh();
+    }
+
     iterator_->SeekToRange();
 
     // TODO: add option
@@ -1924,6 +2579,9 @@ struct ClearWorker final : public PriorityWorker {
 private:
   BaseIterator* iterator_;
   leveldb::WriteOptions* writeOptions_;
+  bool dropFiles_;
+  std::optional<std::string> begin_;
+  std::optional<std::string> end_;
 };
 
 /**
@@ -1964,7 +2622,7 @@ struct ApproximateSizeWorker final : public PriorityWorker {
                          napi_deferred deferred,
                          leveldb::Slice start,
                          leveldb::Slice end)
-    : PriorityWorker(env, database, deferred, "classic_level.db.approximate_size"),
+    : PriorityWorker(env, database, deferred, Priority::bulk),
       start_(start), end_(end) {}
 
   ~ApproximateSizeWorker () {
@@ -2008,16 +2666,205 @@ NAPI_METHOD(db_approximate_size) {
 }
 
 /**
- * Worker class for compacting a range in a database.
+ * A manual compaction that runs in the background thread of LevelDB. It is
+ * kept alive by LevelDB until OnDone() and by the threadsafe function until
+ * that is finalized, whichever comes last.
+ */
+struct Compaction final : public leveldb::CompactRangeListener {
+  Compaction (napi_env env,
+              Database* database,
+              const uint32_t id,
+              napi_deferred deferred,
+              napi_value onProgress)
+    : database_(database),
+      id_(id),
+      deferred_(deferred),
+      hasProgressCallback_(onProgress != NULL),
+      tsfn_(NULL),
+      aborted_(false),
+      cancelled_(false),
+      running_(true),
+      finalized_(false) {
+    napi_value asyncResourceName;
+    NAPI_STATUS_THROWS_VOID(napi_create_string_utf8(env, "classic_level.db.compact_range",
+                                                    NAPI_AUTO_LENGTH,
+                                                    &asyncResourceName));
+    NAPI_STATUS_THROWS_VOID(napi_create_threadsafe_function(env, onProgress, NULL,
+                                                            asyncResourceName,
+                                                            0, 1, NULL,
+                                                            Compaction::Finalize,
+                                                            this,
+                                                            Compaction::CallJs,
+                                                            &tsfn_));
+
+    database_->compactions_[id_] = this;
+    database_->IncrementPriorityWork(env);
+  }
+
+  void Abort () {
+    aborted_ = true;
+  }
+
+  bool OnProgress (const leveldb::CompactRangeProgress& progress) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (hasProgressCallback_ && !finalized_) {
+      napi_call_threadsafe_function(tsfn_, new Event(false, progress), napi_tsfn_nonblocking);
+    }
+
+    // An abort after the last step doesn't cancel anything
+    if (aborted_ && progress.levels_done < progress.levels_total) {
+      cancelled_ = true;
+    }
+
+    return !cancelled_;
+  }
+
+  void OnDone (const leveldb::Status& status) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    running_ = false;
+
+    if (finalized_) {
+      // The environment is being torn down
+      lock.unlock();
+      delete this;
+      return;
+    }
+
+    status_ = status;
+    napi_call_threadsafe_function(tsfn_, new Event(true, leveldb::CompactRangeProgress()), napi_tsfn_nonblocking);
+    napi_release_threadsafe_function(tsfn_, napi_tsfn_release);
+  }
+
+  /**
+   * Release resources if LevelDB was unable to start the compaction, in
+   * which case the promise is rejected by the worker instead.
+   */
+  void Abandon (napi_env env) {
+    Forget(env);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    running_ = false;
+    napi_release_threadsafe_function(tsfn_, napi_tsfn_release);
+  }
+
+private:
+  struct Event {
+    Event (bool done, const leveldb::CompactRangeProgress& progress)
+      : done(done), progress(progress) {}
+
+    const bool done;
+    const leveldb::CompactRangeProgress progress;
+  };
+
+  static void CallJs (napi_env env, napi_value callback, void* context, void* data) {
+    Compaction* self = (Compaction*)context;
+    Event* event = (Event*)data;
+
+    if (env == NULL) {
+      // The threadsafe function is being torn down
+    } else if (event->done) {
+      self->Complete(env);
+    } else if (callback != NULL) {
+      napi_value progress;
+      napi_create_object(env, &progress);
+      SetNumber(env, progress, "levelsDone", event->progress.levels_done);
+      SetNumber(env, progress, "levelsTotal", event->progress.levels_total);
+      SetNumber(env, progress, "bytesRead", (double)event->progress.bytes_read);
+      SetNumber(env, progress, "bytesWritten", (double)event->progress.bytes_written);
+
+      napi_value global;
+      napi_get_global(env, &global);
+      napi_call_function(env, global, callback, 1, &progress, NULL);
+    }
+
+    delete event;
+  }
+
+  static void SetNumber (napi_env env, napi_value obj, const char* key, double value) {
+    napi_value number;
+    napi_create_double(env, value, &number);
+    napi_set_named_property(env, obj, key, number);
+  }
+
+  void Complete (napi_env env) {
+    napi_value argv;
+
+    if (!status_.ok()) {
+      if (status_.IsCorruption()) {
+        argv = CreateCodeError(env, "LEVEL_CORRUPTION", status_.ToString().c_str());
+      } else if (status_.IsIOError()) {
+        argv = CreateCodeError(env, "LEVEL_IO_ERROR", status_.ToString().c_str());
+      } else {
+        argv = CreateError(env, status_.ToString().c_str());
+      }
+    } else if (cancelled_) {
+      argv = CreateCodeError(env, "LEVEL_ABORTED", "Operation has been aborted");
+      napi_value name;
+      napi_create_string_utf8(env, "AbortError", NAPI_AUTO_LENGTH, &name);
+      napi_set_named_property(env, argv, "name", name);
+    } else {
+      argv = NULL;
+    }
+
+    Settle(env, argv);
+  }
+
+  void Settle (napi_env env, napi_value error) {
+    if (error == NULL) {
+      napi_value undefinedValue;
+      napi_get_undefined(env, &undefinedValue);
+      napi_resolve_deferred(env, deferred_, undefinedValue);
+    } else {
+      napi_reject_deferred(env, deferred_, error);
+    }
+
+    Forget(env);
+  }
+
+  void Forget (napi_env env) {
+    deferred_ = NULL;
+    database_->compactions_.erase(id_);
+    database_->DecrementPriorityWork(env);
+  }
+
+  static void Finalize (napi_env env, void* data, void* hint) {
+    Compaction* self = (Compaction*)hint;
+    std::unique_lock<std::mutex> lock(self->mutex_);
+    self->finalized_ = true;
+
+    if (!self->running_) {
+      lock.unlock();
+      delete self;
+    }
+  }
+
+  Database* database_;
+  const uint32_t id_;
+  napi_deferred deferred_;
+  const bool hasProgressCallback_;
+  napi_threadsafe_function tsfn_;
+  std::atomic<bool> aborted_;
+  bool cancelled_;
+  leveldb::Status status_;
+  std::mutex mutex_;
+  bool running_;
+  bool finalized_;
+};
+
+/**
+ * Worker class for starting a compaction, which involves waiting for
+ * earlier writes. The compaction itself then settles the promise.
  */
 struct CompactRangeWorker final : public PriorityWorker {
   CompactRangeWorker (napi_env env,
                       Database* database,
                       napi_deferred deferred,
+                      Compaction* compaction,
                       leveldb::Slice start,
                       leveldb::Slice end)
-    : PriorityWorker(env, database, deferred, "classic_level.db.compact_range"),
-      start_(start), end_(end) {}
+    : PriorityWorker(env, database, deferred, Priority::background),
+      compaction_(compaction), start_(start), end_(end) {}
 
   ~CompactRangeWorker () {
     DisposeSliceBuffer(start_);
@@ -2025,9 +2872,19 @@ struct CompactRangeWorker final : public PriorityWorker {
   }
 
   void DoExecute () override {
-    database_->CompactRange(&start_, &end_);
+    SetStatus(database_->CompactRangeAsync(&start_, &end_, compaction_));
+  }
+
+  void HandleOKCallback (napi_env env, napi_deferred deferred) override {
+    // Compaction has started and will call us back
+  }
+
+  void HandleErrorCallback (napi_env env, napi_deferred deferred) override {
+    BaseWorker::HandleErrorCallback(env, deferred);
+    compaction_->Abandon(env);
   }
 
+  Compaction* compaction_;
   leveldb::Slice start_;
   leveldb::Slice end_;
 };
@@ -2036,21 +2893,47 @@ struct CompactRangeWorker final : public PriorityWorker {
  * Compacts a range in a database.
  */
 NAPI_METHOD(db_compact_range) {
-  NAPI_ARGV(3);
+  NAPI_ARGV(5);
   NAPI_DB_CONTEXT();
   NAPI_PROMISE();
 
-  leveldb::Slice start = ToSlice(env, argv[1]);
-  leveldb::Slice end = ToSlice(env, argv[2]);
+  uint32_t id;
+  NAPI_STATUS_THROWS(napi_get_value_uint32(env, argv[1], &id));
+
+  leveldb::Slice start = ToSlice(env, argv[2]);
+  leveldb::Slice end = ToSlice(env, argv[3]);
 
+  napi_valuetype onProgressType;
+  NAPI_STATUS_THROWS(napi_typeof(env, argv[4], &onProgressType));
+  napi_value onProgress = onProgressType == napi_function ? argv[4] : NULL;
+
+  Compaction* compaction = new Compaction(env, database, id, deferred, onProgress);
   CompactRangeWorker* worker = new CompactRangeWorker(
-    env, database, deferred, start, end
+    env, database, deferred, compaction, start, end
   );
 
   worker->Queue(env);
   return promise;
 }
 
+/**
+ * Aborts a compaction (if any, eventually).
+ */
+NAPI_METHOD(db_compact_range_abort) {
+  NAPI_ARGV(2);
+  NAPI_DB_CONTEXT();
+
+  uint32_t id;
+  NAPI_STATUS_THROWS(napi_get_value_uint32(env, argv[1], &id));
+
+  auto it = database->compactions_.find(id);
+  if (it != database->compactions_.end()) {
+    it->second->Abort();
+  }
+
+  NAPI_RETURN_UNDEFINED();
+}
+
 /**
  * Get a property from a database.
  */
@@ -2076,7 +2959,7 @@ NAPI_METHOD(db_get_property) {
  */
 struct DestroyWorker final : public BaseWorker {
   DestroyWorker (napi_env env, const std::string& location, napi_deferred deferred)
-    : BaseWorker(env, NULL, deferred, "classic_level.destroy_db"),
+    : BaseWorker(env, NULL, deferred, Priority::background),
       location_(location) {}
 
   ~DestroyWorker () {}
@@ -2109,7 +2992,7 @@ NAPI_METHOD(destroy_db) {
  */
 struct RepairWorker final : public BaseWorker {
   RepairWorker (napi_env env, const std::string& location, napi_deferred deferred)
-    : BaseWorker(env, NULL, deferred, "classic_level.repair_db"),
+    : BaseWorker(env, NULL, deferred, Priority::background),
       location_(location) {}
 
   ~RepairWorker () {}
@@ -2138,6 +3021,22 @@ NAPI_METHOD(repair_db) {
   return promise;
 }
 
+/**
+ * Returns true if this build supports the named compression algorithm.
+ * LZ4 and Zstandard are opt-in at build time.
+ */
+NAPI_METHOD(compression_supported) {
+  NAPI_ARGV(1);
+
+  const leveldb::CompressionType type = CompressionValue(env, argv[0]);
+  const bool supported = type == leveldb::kNoCompression ||
+                         leveldb::GetCompressor(type) != NULL;
+
+  napi_value result;
+  napi_get_boolean(env, supported, &result);
+  return result;
+}
+
 /**
  * Create an iterator.
  */
@@ -2242,7 +3141,7 @@ NAPI_METHOD(iterator_abort) {
  */
 struct NextWorker final : public BaseWorker {
   NextWorker (napi_env env, Iterator* iterator, uint32_t size, napi_deferred deferred)
-    : BaseWorker(env, iterator->database, deferred, "classic_level.iterator.next"),
+    : BaseWorker(env, iterator->database, deferred, Priority::iterator),
       iterator_(iterator), size_(size), ok_() {}
 
   ~NextWorker () {}
@@ -2339,7 +3238,7 @@ struct BatchWorker final : public PriorityWorker {
                leveldb::WriteBatch* batch,
                const bool sync,
                const bool hasData)
-    : PriorityWorker(env, database, deferred, "classic_level.batch.do"),
+    : PriorityWorker(env, database, deferred, Priority::interactive),
       batch_(batch), hasData_(hasData) {
     options_.sync = sync;
   }
@@ -2531,7 +3430,7 @@ struct BatchWriteWorker final : public PriorityWorker {
                     Batch* batch,
                     napi_deferred deferred,
                     const bool sync)
-    : PriorityWorker(env, batch->database_, deferred, "classic_level.batch.write"),
+    : PriorityWorker(env, batch->database_, deferred, Priority::interactive),
       batch_(batch),
       sync_(sync) {
         // Prevent GC of batch object before we execute
@@ -2615,6 +3514,11 @@ NAPI_METHOD(snapshot_close) {
  * All exported functions.
  */
 NAPI_INIT() {
+  Dispatcher* dispatcher = new Dispatcher();
+  NAPI_STATUS_THROWS_VOID(dispatcher->Init(env));
+  NAPI_STATUS_THROWS_VOID(napi_set_instance_data(env, dispatcher, NULL, NULL));
+  NAPI_STATUS_THROWS_VOID(napi_add_env_cleanup_hook(env, Dispatcher::EnvCleanupHook, dispatcher));
+
   NAPI_EXPORT_FUNCTION(db_init);
   NAPI_EXPORT_FUNCTION(db_set_shared_buffer)
   NAPI_EXPORT_FUNCTION(db_open);
@@ -2629,10 +3533,12 @@ NAPI_INIT() {
   NAPI_EXPORT_FUNCTION(db_clear);
   NAPI_EXPORT_FUNCTION(db_approximate_size);
   NAPI_EXPORT_FUNCTION(db_compact_range);
+  NAPI_EXPORT_FUNCTION(db_compact_range_abort);
   NAPI_EXPORT_FUNCTION(db_get_property);
 
   NAPI_EXPORT_FUNCTION(destroy_db);
   NAPI_EXPORT_FUNCTION(repair_db);
+  NAPI_EXPORT_FUNCTION(compression_supported);
 
   NAPI_EXPORT_FUNCTION(iterator_init);
   NAPI_EXPORT_FUNCTION(iterator_seek);
@@ -27,7 +27,8 @@ Status BuildTable(const std::string& dbname,
   std::string fname = TableFileName(dbname, meta->number);
   if (iter->Valid()) {
     WritableFile* file;
-    s = env->NewWritableFile(fname, &file);
+    s = options.use_direct_io ? env->NewWritableFileWithDirectIO(fname, &file)
+                              : env->NewWritableFile(fname, &file);
     if (!s.ok()) {
       return s;
     }
@@ -17,9 +17,12 @@
 #include "db/log_reader.h"
 #include "db/log_writer.h"
 #include "db/memtable.h"
+#include "db/negative_cache.h"
 #include "db/table_cache.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
+#include "leveldb/cache.h"
+#include "leveldb/compressor.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "leveldb/status.h"
@@ -95,9 +98,15 @@ Options SanitizeOptions(const std::string& dbname,
   result.comparator = icmp;
   result.filter_policy = (src.filter_policy != NULL) ? ipolicy : NULL;
   ClipToRange(&result.max_open_files,    64 + kNumNonTableCacheFiles, 50000);
+  ClipToRange(&result.max_mmap_files,    0,                           50000);
   ClipToRange(&result.write_buffer_size, 64<<10,                      1<<30);
   ClipToRange(&result.max_file_size,     1<<20,                       1<<30);
   ClipToRange(&result.block_size,        1<<10,                       4<<20);
+  for (size_t i = 0; i < result.block_size_per_level.size(); i++) {
+    ClipToRange(&result.block_size_per_level[i], 1<<10, 4<<20);
+  }
+  ClipToRange(&result.compression_dictionary_size, 0,                 1<<20);
+  ClipToRange(&result.compression_threads,         0,                    64);
   if (result.info_log == NULL) {
     // Open a log file in the same directory as the db
     src.env->CreateDir(dbname);  // In case it does not exist
@@ -134,7 +143,14 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
       seed_(0),
       tmp_batch_(new WriteBatch),
       bg_compaction_scheduled_(false),
-      manual_compaction_(NULL) {
+      manual_compaction_(NULL),
+      manual_file_deletion_(NULL),
+      row_cache_id_(options_.row_cache != NULL ? options_.row_cache->NewId() : 0),
+      row_cache_generation_(0),
+      row_cache_min_sequence_(0),
+      negative_cache_(options_.negative_cache_entries > 0
+                      ? new NegativeCache(options_.negative_cache_entries)
+                      : NULL) {
   has_imm_.Release_Store(NULL);
 
   // Reserve ten files or so for other uses and give the rest to TableCache.
@@ -152,8 +168,16 @@ DBImpl::~DBImpl() {
   while (bg_compaction_scheduled_) {
     bg_cv_.Wait();
   }
+  std::deque<RangeCompaction*> range_compactions;
+  range_compactions.swap(range_compactions_);
   mutex_.Unlock();
 
+  for (size_t i = 0; i < range_compactions.size(); i++) {
+    RangeCompaction* r = range_compactions[i];
+    r->listener->OnDone(Status::IOError("Deleting DB during compaction"));
+    delete r;
+  }
+
   if (db_lock_ != NULL) {
     env_->UnlockFile(db_lock_);
   }
@@ -165,6 +189,7 @@ DBImpl::~DBImpl() {
   delete log_;
   delete logfile_;
   delete table_cache_;
+  delete negative_cache_;
 
   if (owns_info_log_) {
     delete options_.info_log;
@@ -496,10 +521,23 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
   Log(options_.info_log, "Level-0 table #%llu: started",
       (unsigned long long) meta.number);
 
+  // Pick the level before building the table, so that the table is built
+  // with the settings of that level.  The first and last keys of the
+  // memtable will be those of the table.
+  int level = 0;
+  iter->SeekToFirst();
+  if (iter->Valid() && base != NULL) {
+    const std::string min_user_key = ExtractUserKey(iter->key()).ToString();
+    iter->SeekToLast();
+    const Slice max_user_key = ExtractUserKey(iter->key());
+    level = base->PickLevelForMemTableOutput(min_user_key, max_user_key);
+  }
+
   Status s;
   {
     mutex_.Unlock();
-    s = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta);
+    s = BuildTable(dbname_, env_, OptionsForLevel(options_, level),
+                   table_cache_, iter, &meta);
     mutex_.Lock();
   }
 
@@ -513,13 +551,7 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
 
   // Note that if file_size is zero, the file has been deleted and
   // should not be added to the manifest.
-  int level = 0;
   if (s.ok() && meta.file_size > 0) {
-    const Slice min_user_key = meta.smallest.user_key();
-    const Slice max_user_key = meta.largest.user_key();
-    if (base != NULL) {
-      level = base->PickLevelForMemTableOutput(min_user_key, max_user_key);
-    }
     edit->AddFile(level, meta.number, meta.file_size,
                   meta.smallest, meta.largest);
   }
@@ -558,6 +590,7 @@ void DBImpl::CompactMemTable() {
     imm_->Unref();
     imm_ = NULL;
     has_imm_.Release_Store(NULL);
+    InvalidateRowCache();
     DeleteObsoleteFiles();
   } else {
     RecordBackgroundError(s);
@@ -581,6 +614,95 @@ void DBImpl::CompactRange(const Slice* begin, const Slice* end) {
   }
 }
 
+Status DBImpl::CompactRangeAsync(const Slice* begin, const Slice* end,
+                                 CompactRangeListener* listener) {
+  RangeCompaction* r = new RangeCompaction;
+  r->listener = listener;
+  r->manual.level = 0;
+  r->manual.done = false;
+  if (begin == NULL) {
+    r->manual.begin = NULL;
+  } else {
+    r->begin_storage = InternalKey(*begin, kMaxSequenceNumber,
+                                   kValueTypeForSeek);
+    r->manual.begin = &r->begin_storage;
+  }
+  r->begin = r->manual.begin;
+  if (end == NULL) {
+    r->manual.end = NULL;
+  } else {
+    r->end_storage = InternalKey(*end, 0, static_cast<ValueType>(0));
+    r->manual.end = &r->end_storage;
+  }
+
+  int max_level_with_files = 1;
+  {
+    MutexLock l(&mutex_);
+    Version* base = versions_->current();
+    for (int level = 1; level < config::kNumLevels; level++) {
+      if (base->OverlapInLevel(level, begin, end)) {
+        max_level_with_files = level;
+      }
+    }
+  }
+  r->max_level = max_level_with_files;
+  r->progress.levels_total = max_level_with_files;
+
+  // NULL batch means just wait for earlier writes to be done, after which
+  // the memtable is compacted ahead of the levels.
+  Status s = Write(WriteOptions(), NULL);
+  if (!s.ok()) {
+    delete r;
+    return s;
+  }
+
+  MutexLock l(&mutex_);
+  if (!bg_error_.ok()) {
+    delete r;
+    return bg_error_;
+  }
+  range_compactions_.push_back(r);
+  MaybeScheduleCompaction();
+  return Status::OK();
+}
+
+void DBImpl::AdvanceRangeCompaction(const Status& status,
+                                    uint64_t bytes_read,
+                                    uint64_t bytes_written) {
+  mutex_.AssertHeld();
+  RangeCompaction* r = range_compactions_.front();
+  r->progress.bytes_read += bytes_read;
+  r->progress.bytes_written += bytes_written;
+
+  bool done = !status.ok();
+  if (!done && r->manual.done) {
+    r->progress.levels_done++;
+    if (++r->manual.level >= r->max_level) {
+      done = true;
+    } else {
+      r->manual.done = false;
+      r->manual.begin = r->begin;
+    }
+  }
+
+  if (status.ok()) {
+    CompactRangeProgress progress = r->progress;
+    mutex_.Unlock();
+    if (!r->listener->OnProgress(progress)) {
+      done = true;
+    }
+    mutex_.Lock();
+  }
+
+  if (done) {
+    range_compactions_.pop_front();
+    mutex_.Unlock();
+    r->listener->OnDone(status);
+    mutex_.Lock();
+    delete r;
+  }
+}
+
 void DBImpl::TEST_CompactRange(int level, const Slice* begin,const Slice* end) {
   assert(level >= 0);
   assert(level + 1 < config::kNumLevels);
@@ -618,6 +740,53 @@ void DBImpl::TEST_CompactRange(int level, const Slice* begin,const Slice* end) {
   }
 }
 
+Status DBImpl::DeleteFilesInRange(const Slice* begin, const Slice* end,
+                                  const Snapshot* snapshot, int* deleted) {
+  InternalKey begin_storage, end_storage;
+
+  ManualFileDeletion m;
+  m.done = false;
+  m.snapshot = reinterpret_cast<const SnapshotImpl*>(snapshot);
+  m.deleted = 0;
+  if (begin == NULL) {
+    m.begin = NULL;
+  } else {
+    begin_storage = InternalKey(*begin, kMaxSequenceNumber, kValueTypeForSeek);
+    m.begin = &begin_storage;
+  }
+  if (end == NULL) {
+    m.end = NULL;
+  } else {
+    end_storage = InternalKey(*end, kMaxSequenceNumber, kValueTypeForSeek);
+    m.end = &end_storage;
+  }
+
+  MutexLock l(&mutex_);
+  // Files are removed by the background thread, so that it can't happen
+  // while a compaction is reading them.
+  while (!m.done && !shutting_down_.Acquire_Load() && bg_error_.ok()) {
+    if (manual_file_deletion_ == NULL) {  // Idle
+      manual_file_deletion_ = &m;
+      MaybeScheduleCompaction();
+    } else {  // Running either my deletion or another one.
+      bg_cv_.Wait();
+    }
+  }
+  if (manual_file_deletion_ == &m) {
+    // Cancel my deletion since we aborted early for some reason.
+    manual_file_deletion_ = NULL;
+  }
+
+  if (deleted != NULL) {
+    *deleted = m.deleted;
+  }
+  if (!m.done) {
+    return bg_error_.ok() ? Status::IOError("Deleting files during shutdown")
+                          : bg_error_;
+  }
+  return m.status;
+}
+
 Status DBImpl::TEST_CompactMemTable() {
   // NULL batch means just wait for earlier writes to be done
   Status s = Write(WriteOptions(), NULL);
@@ -634,11 +803,23 @@ Status DBImpl::TEST_CompactMemTable() {
   return s;
 }
 
+void DBImpl::InvalidateRowCache() {
+  mutex_.AssertHeld();
+  row_cache_generation_++;
+  row_cache_min_sequence_ = versions_->LastSequence();
+}
+
 void DBImpl::RecordBackgroundError(const Status& s) {
   mutex_.AssertHeld();
   if (bg_error_.ok()) {
     bg_error_ = s;
     bg_cv_.SignalAll();
+
+    // Make sure that pending CompactRangeAsync() requests are failed
+    if (!range_compactions_.empty() && !bg_compaction_scheduled_) {
+      bg_compaction_scheduled_ = true;
+      env_->Schedule(&DBImpl::BGWork, this);
+    }
   }
 }
 
@@ -652,6 +833,8 @@ void DBImpl::MaybeScheduleCompaction() {
     // Already got an error; no more changes
   } else if (imm_ == NULL &&
              manual_compaction_ == NULL &&
+             manual_file_deletion_ == NULL &&
+             range_compactions_.empty() &&
              !versions_->NeedsCompaction()) {
     // No work to be done
   } else {
@@ -675,6 +858,18 @@ void DBImpl::BackgroundCall() {
     BackgroundCompaction();
   }
 
+  if (!bg_error_.ok() && !range_compactions_.empty()) {
+    std::deque<RangeCompaction*> range_compactions;
+    range_compactions.swap(range_compactions_);
+    Status s = bg_error_;
+    mutex_.Unlock();
+    for (size_t i = 0; i < range_compactions.size(); i++) {
+      range_compactions[i]->listener->OnDone(s);
+      delete range_compactions[i];
+    }
+    mutex_.Lock();
+  }
+
   bg_compaction_scheduled_ = false;
 
   // Previous compaction may have produced too many files in a level,
@@ -691,6 +886,16 @@ void DBImpl::BackgroundCompaction() {
     return;
   }
 
+  if (manual_file_deletion_ != NULL) {
+    BackgroundFileDeletion(manual_file_deletion_);
+    manual_file_deletion_ = NULL;
+    return;
+  }
+
+  if (manual_compaction_ == NULL && !range_compactions_.empty()) {
+    manual_compaction_ = &range_compactions_.front()->manual;
+  }
+
   Compaction* c;
   bool is_manual = (manual_compaction_ != NULL);
   InternalKey manual_end;
@@ -712,6 +917,8 @@ void DBImpl::BackgroundCompaction() {
   }
 
   Status status;
+  uint64_t bytes_read = 0;
+  uint64_t bytes_written = 0;
   if (c == NULL) {
     // Nothing to do
   } else if (!is_manual && c->IsTrivialMove()) {
@@ -738,6 +945,12 @@ void DBImpl::BackgroundCompaction() {
     if (!status.ok()) {
       RecordBackgroundError(status);
     }
+    for (int which = 0; which < 2; which++) {
+      for (int i = 0; i < c->num_input_files(which); i++) {
+        bytes_read += c->input(which, i)->file_size;
+      }
+    }
+    bytes_written = compact->total_bytes;
     CleanupCompaction(compact);
     c->ReleaseInputs();
     DeleteObsoleteFiles();
@@ -765,9 +978,78 @@ void DBImpl::BackgroundCompaction() {
       m->begin = &m->tmp_storage;
     }
     manual_compaction_ = NULL;
+
+    if (!range_compactions_.empty() &&
+        m == &range_compactions_.front()->manual) {
+      AdvanceRangeCompaction(status, bytes_read, bytes_written);
+    }
   }
 }
 
+void DBImpl::BackgroundFileDeletion(ManualFileDeletion* m) {
+  mutex_.AssertHeld();
+  m->done = true;
+
+  // Other snapshots (including the implicit ones of iterators) would
+  // observe the removal, unlike deleting the keys one by one.
+  if (m->snapshot == NULL ? !snapshots_.empty()
+                          : (snapshots_.oldest() != m->snapshot ||
+                             snapshots_.newest() != m->snapshot)) {
+    return;
+  }
+
+  const Comparator* ucmp = user_comparator();
+  Version* base = versions_->current();
+  VersionEdit edit;
+  uint64_t bytes = 0;
+
+  // Level-0 files are skipped because they are few and short-lived
+  for (int level = 1; level < config::kNumLevels; level++) {
+    std::vector<FileMetaData*> files;
+    base->GetOverlappingInputs(level, m->begin, m->end, &files);
+
+    for (size_t i = 0; i < files.size(); i++) {
+      FileMetaData* f = files[i];
+      if (m->begin != NULL &&
+          ucmp->Compare(f->smallest.user_key(), m->begin->user_key()) < 0) {
+        continue;
+      }
+      if (m->end != NULL &&
+          ucmp->Compare(f->largest.user_key(), m->end->user_key()) >= 0) {
+        continue;
+      }
+      if (m->snapshot != NULL &&
+          f->number >= m->snapshot->next_file_number_) {
+        // May contain writes made after the snapshot
+        continue;
+      }
+      edit.DeleteFile(level, f->number);
+      bytes += f->file_size;
+      m->deleted++;
+    }
+  }
+
+  if (m->deleted == 0) {
+    return;
+  }
+
+  m->status = versions_->LogAndApply(&edit, &mutex_);
+  if (!m->status.ok()) {
+    RecordBackgroundError(m->status);
+    m->deleted = 0;
+  } else {
+    InvalidateRowCache();
+    DeleteObsoleteFiles();
+  }
+
+  VersionSet::LevelSummaryStorage tmp;
+  Log(options_.info_log, "Deleted %d files in range, %lld bytes %s: %s\n",
+      m->deleted,
+      static_cast<unsigned long long>(bytes),
+      m->status.ToString().c_str(),
+      versions_->LevelSummary(&tmp));
+}
+
 void DBImpl::CleanupCompaction(CompactionState* compact) {
   mutex_.AssertHeld();
   if (compact->builder != NULL) {
@@ -803,9 +1085,13 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
 
   // Make the output file
   std::string fname = TableFileName(dbname_, file_number);
-  Status s = env_->NewWritableFile(fname, &compact->outfile);
+  Status s = options_.use_direct_io
+      ? env_->NewWritableFileWithDirectIO(fname, &compact->outfile)
+      : env_->NewWritableFile(fname, &compact->outfile);
   if (s.ok()) {
-    compact->builder = new TableBuilder(options_, compact->outfile);
+    compact->builder = new TableBuilder(
+        OptionsForLevel(options_, compact->compaction->level() + 1),
+        compact->outfile);
   }
   return s;
 }
@@ -1106,10 +1392,16 @@ int64_t DBImpl::TEST_MaxNextLevelOverlappingBytes() {
   return versions_->MaxNextLevelOverlappingBytes();
 }
 
+static void DeleteRow(const Slice& key, void* value) {
+  delete reinterpret_cast<std::string*>(value);
+}
+
 Status DBImpl::Get(const ReadOptions& options,
                    const Slice& key,
                    ValueSink* value) {
   Status s;
+  const uint64_t hash =
+      negative_cache_ != NULL ? NegativeCache::HashKey(key) : 0;
   MutexLock l(&mutex_);
   SequenceNumber snapshot;
   if (options.snapshot != NULL) {
@@ -1118,6 +1410,10 @@ Status DBImpl::Get(const ReadOptions& options,
     snapshot = versions_->LastSequence();
   }
 
+  if (negative_cache_ != NULL && negative_cache_->Lookup(hash, snapshot)) {
+    return Status::NotFound(Slice());
+  }
+
   MemTable* mem = mem_;
   MemTable* imm = imm_;
   Version* current = versions_->current();
@@ -1125,6 +1421,17 @@ Status DBImpl::Get(const ReadOptions& options,
   if (imm != NULL) imm->Ref();
   current->Ref();
 
+  // The row cache only holds the newest value of a key in the table files
+  // of the current generation, so reads at older snapshots can't use it.
+  Cache* row_cache = NULL;
+  std::string row_key;
+  if (options_.row_cache != NULL && snapshot >= row_cache_min_sequence_) {
+    row_cache = options_.row_cache;
+    PutFixed64(&row_key, row_cache_id_);
+    PutFixed64(&row_key, row_cache_generation_);
+    row_key.append(key.data(), key.size());
+  }
+
   bool have_stat_update = false;
   Version::GetStats stats;
 
@@ -1137,6 +1444,29 @@ Status DBImpl::Get(const ReadOptions& options,
       // Done
     } else if (imm != NULL && imm->Get(lkey, value, &s)) {
       // Done
+    } else if (row_cache != NULL) {
+      Cache::Handle* handle = row_cache->Lookup(row_key);
+      if (handle != NULL) {
+        const std::string* row =
+            reinterpret_cast<std::string*>(row_cache->Value(handle));
+        value->assign(row->data(), row->size());
+        row_cache->Release(handle);
+      } else {
+        std::string* row = new std::string;
+        StringValueSink sink(row);
+        s = current->Get(options, lkey, &sink, &stats);
+        have_stat_update = true;
+        if (s.ok()) {
+          value->assign(row->data(), row->size());
+        }
+        if (s.ok() && options.fill_cache) {
+          handle = row_cache->Insert(row_key, row, row_key.size() + row->size(),
+                                     &DeleteRow);
+          row_cache->Release(handle);
+        } else {
+          delete row;
+        }
+      }
     } else {
       s = current->Get(options, lkey, value, &stats);
       have_stat_update = true;
@@ -1144,6 +1474,9 @@ Status DBImpl::Get(const ReadOptions& options,
     mutex_.Lock();
   }
 
+  if (negative_cache_ != NULL && s.IsNotFound()) {
+    negative_cache_->Insert(hash, snapshot);
+  }
   if (have_stat_update && current->UpdateStats(stats)) {
     MaybeScheduleCompaction();
   }
@@ -1153,6 +1486,76 @@ Status DBImpl::Get(const ReadOptions& options,
   return s;
 }
 
+namespace {
+struct DiscardValueSink : public ValueSink {
+  void assign(const char* s, size_t n) override { }
+};
+}
+
+void DBImpl::Prefetch(const ReadOptions& options,
+                      const Slice* keys, size_t n) {
+  if (!options.fill_cache) {
+    return;
+  }
+  MutexLock l(&mutex_);
+  SequenceNumber snapshot;
+  if (options.snapshot != NULL) {
+    snapshot = reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_;
+  } else {
+    snapshot = versions_->LastSequence();
+  }
+
+  MemTable* mem = mem_;
+  MemTable* imm = imm_;
+  Version* current = versions_->current();
+  mem->Ref();
+  if (imm != NULL) imm->Ref();
+  current->Ref();
+  const bool use_row_cache =
+      options_.row_cache != NULL && snapshot >= row_cache_min_sequence_;
+  std::string row_key;
+  if (use_row_cache) {
+    PutFixed64(&row_key, row_cache_id_);
+    PutFixed64(&row_key, row_cache_generation_);
+  }
+  const size_t row_key_prefix = row_key.size();
+
+  {
+    mutex_.Unlock();
+    // Keys that Get() finds without reading a table file need no blocks
+    std::vector<std::string> ikeys;
+    ikeys.reserve(n);
+    DiscardValueSink sink;
+    for (size_t i = 0; i < n; i++) {
+      Status s;
+      LookupKey lkey(keys[i], snapshot);
+      if (mem->Get(lkey, &sink, &s) ||
+          (imm != NULL && imm->Get(lkey, &sink, &s))) {
+        continue;
+      }
+      if (use_row_cache) {
+        row_key.resize(row_key_prefix);
+        row_key.append(keys[i].data(), keys[i].size());
+        Cache::Handle* handle = options_.row_cache->Lookup(row_key);
+        if (handle != NULL) {
+          options_.row_cache->Release(handle);
+          continue;
+        }
+      }
+      ikeys.push_back(lkey.internal_key().ToString());
+    }
+    std::vector<Slice> slices(ikeys.begin(), ikeys.end());
+    if (!slices.empty()) {
+      current->Prefetch(options, &slices[0], slices.size());
+    }
+    mutex_.Lock();
+  }
+
+  mem->Unref();
+  if (imm != NULL) imm->Unref();
+  current->Unref();
+}
+
 Iterator* DBImpl::NewIterator(const ReadOptions& options) {
   SequenceNumber latest_snapshot;
   uint32_t seed;
@@ -1174,7 +1577,8 @@ void DBImpl::RecordReadSample(Slice key) {
 
 const Snapshot* DBImpl::GetSnapshot() {
   MutexLock l(&mutex_);
-  return snapshots_.New(versions_->LastSequence());
+  return snapshots_.New(versions_->LastSequence(),
+                        versions_->NextFileNumber());
 }
 
 void DBImpl::ReleaseSnapshot(const Snapshot* s) {
@@ -1191,6 +1595,26 @@ Status DBImpl::Delete(const WriteOptions& options, const Slice& key) {
   return DB::Delete(options, key);
 }
 
+namespace {
+
+// Collects hashes of the keys in a batch, for NegativeCache::Invalidate()
+class KeyHasher : public WriteBatch::Handler {
+ public:
+  explicit KeyHasher(std::vector<uint64_t>* hashes) : hashes_(hashes) { }
+
+  virtual void Put(const Slice& key, const Slice& value) {
+    hashes_->push_back(NegativeCache::HashKey(key));
+  }
+  virtual void Delete(const Slice& key) {
+    hashes_->push_back(NegativeCache::HashKey(key));
+  }
+
+ private:
+  std::vector<uint64_t>* hashes_;
+};
+
+}  // namespace
+
 Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
   Writer w(&mutex_);
   w.batch = my_batch;
@@ -1214,6 +1638,7 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
     WriteBatch* updates = BuildBatchGroup(&last_writer);
     WriteBatchInternal::SetSequence(updates, last_sequence + 1);
     last_sequence += WriteBatchInternal::Count(updates);
+    std::vector<uint64_t> written;
 
     // Add to log and apply to memtable.  We can release the lock
     // during this phase since &w is currently responsible for logging
@@ -1232,6 +1657,10 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
       if (status.ok()) {
         status = WriteBatchInternal::InsertInto(updates, mem_);
       }
+      if (negative_cache_ != NULL) {
+        KeyHasher hasher(&written);
+        updates->Iterate(&hasher);
+      }
       mutex_.Lock();
       if (sync_error) {
         // The state of the log file is indeterminate: the log record we
@@ -1242,6 +1671,11 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
     }
     if (updates == tmp_batch_) tmp_batch_->Clear();
 
+    // Before the writes become visible to new snapshots
+    for (size_t i = 0; i < written.size(); i++) {
+      negative_cache_->Invalidate(written[i], last_sequence);
+    }
+
     versions_->SetLastSequence(last_sequence);
   }
 
@@ -1427,8 +1861,23 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
   } else if (in == "sstables") {
     *value = versions_->current()->DebugString();
     return true;
+  } else if (in == "negative-cache") {
+    const uint64_t lookups =
+        negative_cache_ != NULL ? negative_cache_->lookups() : 0;
+    const uint64_t hits = negative_cache_ != NULL ? negative_cache_->hits() : 0;
+    char buf[200];
+    snprintf(buf, sizeof(buf),
+             "Lookups: %llu\nHits: %llu\nHit rate: %.2f%%\n",
+             static_cast<unsigned long long>(lookups),
+             static_cast<unsigned long long>(hits),
+             lookups > 0 ? 100.0 * hits / lookups : 0.0);
+    value->append(buf);
+    return true;
   } else if (in == "approximate-memory-usage") {
     size_t total_usage = options_.block_cache->TotalCharge();
+    if (options_.compressed_block_cache != NULL) {
+      total_usage += options_.compressed_block_cache->TotalCharge();
+    }
     if (mem_) {
       total_usage += mem_->ApproximateMemoryUsage();
     }
@@ -1487,9 +1936,19 @@ Status DB::Delete(const WriteOptions& opt, const Slice& key) {
 
 DB::~DB() { }
 
+void DB::Prefetch(const ReadOptions& options, const Slice* keys, size_t n) {
+}
+
 Status DB::Open(const Options& options, const std::string& dbname,
                 DB** dbptr) {
   *dbptr = NULL;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    const CompressionType type = OptionsForLevel(options, level).compression;
+    if (type != kNoCompression && GetCompressor(type) == NULL) {
+      return Status::NotSupported(
+          "compression type not supported by this build");
+    }
+  }
 
   DBImpl* impl = new DBImpl(options, dbname);
   impl->mutex_.Lock();
@@ -1534,6 +1993,9 @@ Status DB::Open(const Options& options, const std::string& dbname,
 Snapshot::~Snapshot() {
 }
 
+CompactRangeListener::~CompactRangeListener() {
+}
+
 Status DestroyDB(const std::string& dbname, const Options& options) {
   Env* env = options.env;
   std::vector<std::string> filenames;
@@ -19,6 +19,7 @@
 namespace leveldb {
 
 class MemTable;
+class NegativeCache;
 class TableCache;
 class Version;
 class VersionEdit;
@@ -36,12 +37,18 @@ class DBImpl : public DB {
   virtual Status Get(const ReadOptions& options,
                      const Slice& key,
                      ValueSink* value);
+  virtual void Prefetch(const ReadOptions& options,
+                        const Slice* keys, size_t n);
   virtual Iterator* NewIterator(const ReadOptions&);
   virtual const Snapshot* GetSnapshot();
   virtual void ReleaseSnapshot(const Snapshot* snapshot);
   virtual bool GetProperty(const Slice& property, std::string* value);
   virtual void GetApproximateSizes(const Range* range, int n, uint64_t* sizes);
   virtual void CompactRange(const Slice* begin, const Slice* end);
+  virtual Status CompactRangeAsync(const Slice* begin, const Slice* end,
+                                   CompactRangeListener* listener);
+  virtual Status DeleteFilesInRange(const Slice* begin, const Slice* end,
+                                    const Snapshot* snapshot, int* deleted);
 
   // Extra methods (for testing) that are not in the public DB interface
 
@@ -69,6 +76,8 @@ class DBImpl : public DB {
   friend class DB;
   struct CompactionState;
   struct Writer;
+  struct ManualFileDeletion;
+  struct RangeCompaction;
 
   Iterator* NewInternalIterator(const ReadOptions&,
                                 SequenceNumber* latest_snapshot,
@@ -105,10 +114,19 @@ class DBImpl : public DB {
 
   void RecordBackgroundError(const Status& s);
 
+  // Called after changing the set of table files in a way that may change
+  // the result of a read, i.e. adding a level-0 file or removing files.
+  void InvalidateRowCache() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   void MaybeScheduleCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   static void BGWork(void* db);
   void BackgroundCall();
   void  BackgroundCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void BackgroundFileDeletion(ManualFileDeletion* m)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void AdvanceRangeCompaction(const Status& status,
+                              uint64_t bytes_read, uint64_t bytes_written)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void CleanupCompaction(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   Status DoCompactionWork(CompactionState* compact)
@@ -169,8 +187,42 @@ class DBImpl : public DB {
   };
   ManualCompaction* manual_compaction_;
 
+  // Information for a manual removal of table files
+  struct ManualFileDeletion {
+    bool done;
+    const InternalKey* begin;   // NULL means beginning of key range
+    const InternalKey* end;     // NULL means end of key range
+    const SnapshotImpl* snapshot;
+    int deleted;
+    Status status;
+  };
+  ManualFileDeletion* manual_file_deletion_;
+
+  // Information for a CompactRangeAsync() request, which performs a
+  // manual compaction of each level in turn
+  struct RangeCompaction {
+    ManualCompaction manual;    // Compaction of the current level
+    const InternalKey* begin;   // NULL means beginning of key range
+    InternalKey begin_storage;
+    InternalKey end_storage;
+    int max_level;              // Compact levels below this one
+    CompactRangeListener* listener;
+    CompactRangeProgress progress;
+  };
+  std::deque<RangeCompaction*> range_compactions_;
+
   VersionSet* versions_;
 
+  // Entries of the row cache are keyed by id, generation and user key.
+  // The generation is incremented by InvalidateRowCache(), after which
+  // the cache can only be used by reads at or after min_sequence.
+  const uint64_t row_cache_id_;
+  uint64_t row_cache_generation_;
+  SequenceNumber row_cache_min_sequence_;
+
+  // Remembers keys that don't exist, if enabled
+  NegativeCache* negative_cache_;
+
   // Have we encountered a background error in paranoid mode?
   Status bg_error_;
 
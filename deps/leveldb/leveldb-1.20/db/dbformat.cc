@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
+#include <algorithm>
 #include <stdio.h>
 #include "db/dbformat.h"
 #include "port/port.h"
@@ -137,4 +138,22 @@ LookupKey::LookupKey(const Slice& user_key, SequenceNumber s) {
   end_ = dst;
 }
 
+template <class T>
+static void ApplyLevelSetting(const std::vector<T>& per_level, int level,
+                              T* value) {
+  if (!per_level.empty()) {
+    *value = per_level[std::min<size_t>(level, per_level.size() - 1)];
+  }
+}
+
+Options OptionsForLevel(const Options& options, int level) {
+  Options result = options;
+  ApplyLevelSetting(options.compression_per_level, level,
+                    &result.compression);
+  ApplyLevelSetting(options.block_size_per_level, level, &result.block_size);
+  ApplyLevelSetting(options.block_restart_interval_per_level, level,
+                    &result.block_restart_interval);
+  return result;
+}
+
 }  // namespace leveldb
@@ -225,6 +225,10 @@ inline LookupKey::~LookupKey() {
   if (start_ != space_) delete[] start_;
 }
 
+// Return a copy of options with the per-level settings for tables written
+// to the specified level applied.
+extern Options OptionsForLevel(const Options& options, int level);
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_DB_DBFORMAT_H_
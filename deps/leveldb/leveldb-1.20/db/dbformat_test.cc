@@ -105,6 +105,43 @@ TEST(FormatTest, InternalKeyShortestSuccessor) {
             ShortSuccessor(IKey("\xff\xff", 100, kTypeValue)));
 }
 
+TEST(FormatTest, OptionsForLevel) {
+  Options options;
+  options.compression = kSnappyCompression;
+  options.block_size = 4096;
+  options.block_restart_interval = 16;
+
+  // Without per-level settings, every level gets the global ones
+  for (int level = 0; level < config::kNumLevels; level++) {
+    Options result = OptionsForLevel(options, level);
+    ASSERT_EQ(kSnappyCompression, result.compression);
+    ASSERT_EQ(4096, result.block_size);
+    ASSERT_EQ(16, result.block_restart_interval);
+  }
+
+  options.compression_per_level.push_back(kNoCompression);
+  options.compression_per_level.push_back(kNoCompression);
+  options.compression_per_level.push_back(kZstdCompression);
+  options.block_size_per_level.push_back(2048);
+  options.block_size_per_level.push_back(16384);
+
+  Options level0 = OptionsForLevel(options, 0);
+  ASSERT_EQ(kNoCompression, level0.compression);
+  ASSERT_EQ(2048, level0.block_size);
+  ASSERT_EQ(16, level0.block_restart_interval);
+
+  Options level1 = OptionsForLevel(options, 1);
+  ASSERT_EQ(kNoCompression, level1.compression);
+  ASSERT_EQ(16384, level1.block_size);
+
+  // The last entries apply to the levels after them
+  for (int level = 2; level < config::kNumLevels; level++) {
+    Options result = OptionsForLevel(options, level);
+    ASSERT_EQ(kZstdCompression, result.compression);
+    ASSERT_EQ(16384, result.block_size);
+  }
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
@@ -0,0 +1,59 @@
+#include "db/negative_cache.h"
+
+#include <assert.h>
+#include "util/hash.h"
+
+namespace leveldb {
+
+NegativeCache::NegativeCache(size_t entries)
+    : slots_(new Slot[entries]),
+      size_(entries),
+      lookups_(0),
+      hits_(0) {
+  assert(entries > 0);
+  for (size_t i = 0; i < size_; i++) {
+    slots_[i].hash = 0;
+    slots_[i].inserted = 0;
+    slots_[i].invalidated = 0;
+  }
+}
+
+NegativeCache::~NegativeCache() {
+  delete[] slots_;
+}
+
+uint64_t NegativeCache::HashKey(const Slice& user_key) {
+  // Two 32-bit hashes with different seeds make false positives (which
+  // would turn a present key into a missing one) negligibly rare.
+  const uint64_t hi = Hash(user_key.data(), user_key.size(), 0x9ae16a3b);
+  const uint64_t lo = Hash(user_key.data(), user_key.size(), 0xbc9f1d34);
+  return (hi << 32) | lo | 1;
+}
+
+bool NegativeCache::Lookup(uint64_t hash, SequenceNumber snapshot) {
+  const Slot& slot = slots_[hash % size_];
+  lookups_++;
+  if (slot.hash == hash && snapshot >= slot.inserted) {
+    hits_++;
+    return true;
+  }
+  return false;
+}
+
+void NegativeCache::Insert(uint64_t hash, SequenceNumber snapshot) {
+  Slot& slot = slots_[hash % size_];
+  if (snapshot >= slot.invalidated) {
+    slot.hash = hash;
+    slot.inserted = snapshot;
+  }
+}
+
+void NegativeCache::Invalidate(uint64_t hash, SequenceNumber sequence) {
+  Slot& slot = slots_[hash % size_];
+  slot.hash = 0;
+  if (sequence > slot.invalidated) {
+    slot.invalidated = sequence;
+  }
+}
+
+}  // namespace leveldb
@@ -0,0 +1,60 @@
+// A compact cache of user keys that were found to not exist, so that
+// repeated reads of missing keys can skip the memtables and table files.
+// The cache is direct-mapped and keyed by a 64-bit hash of the user key.
+// A write to a key clears the slot that the key maps to, so entries never
+// have to be invalidated by anything else.
+//
+// Not thread-safe: callers must provide external synchronization.
+
+#ifndef STORAGE_LEVELDB_DB_NEGATIVE_CACHE_H_
+#define STORAGE_LEVELDB_DB_NEGATIVE_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "db/dbformat.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+class NegativeCache {
+ public:
+  explicit NegativeCache(size_t entries);
+  ~NegativeCache();
+
+  // Return a hash of user_key to pass to the methods below.  Never zero.
+  static uint64_t HashKey(const Slice& user_key);
+
+  // Return true if the key was found to not exist at a sequence number
+  // less than or equal to snapshot, and has not been written since.
+  bool Lookup(uint64_t hash, SequenceNumber snapshot);
+
+  // Record that the key does not exist at snapshot.  Ignored if a key that
+  // maps to the same slot was written after snapshot.
+  void Insert(uint64_t hash, SequenceNumber snapshot);
+
+  // Record that the key was written at sequence.
+  void Invalidate(uint64_t hash, SequenceNumber sequence);
+
+  uint64_t lookups() const { return lookups_; }
+  uint64_t hits() const { return hits_; }
+
+ private:
+  struct Slot {
+    uint64_t hash;                // Zero if empty
+    SequenceNumber inserted;      // Snapshot at which the key was missing
+    SequenceNumber invalidated;   // Latest write to a key of this slot
+  };
+
+  Slot* const slots_;
+  const size_t size_;
+  uint64_t lookups_;
+  uint64_t hits_;
+
+  // No copying allowed
+  NegativeCache(const NegativeCache&);
+  void operator=(const NegativeCache&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_NEGATIVE_CACHE_H_
@@ -18,6 +18,10 @@ class SnapshotImpl : public Snapshot {
  public:
   SequenceNumber number_;  // const after creation
 
+  // Table files numbered below this were written before the snapshot
+  // was created. Const after creation.
+  uint64_t next_file_number_;
+
  private:
   friend class SnapshotList;
 
@@ -39,9 +43,10 @@ class SnapshotList {
   SnapshotImpl* oldest() const { assert(!empty()); return list_.next_; }
   SnapshotImpl* newest() const { assert(!empty()); return list_.prev_; }
 
-  const SnapshotImpl* New(SequenceNumber seq) {
+  const SnapshotImpl* New(SequenceNumber seq, uint64_t next_file_number) {
     SnapshotImpl* s = new SnapshotImpl;
     s->number_ = seq;
+    s->next_file_number_ = next_file_number;
     s->list_ = this;
     s->next_ = &list_;
     s->prev_ = list_.prev_;
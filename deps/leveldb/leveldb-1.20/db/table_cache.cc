@@ -8,18 +8,25 @@
 #include "leveldb/env.h"
 #include "leveldb/table.h"
 #include "util/coding.h"
+#include "util/mutexlock.h"
 
 namespace leveldb {
 
 struct TableAndFile {
   RandomAccessFile* file;
   Table* table;
+  TableCache* mapped_by;  // Non-NULL if counted in mmap_files_ of it
+  int sequential_readers;  // Iterators that advised sequential access
 };
 
-static void DeleteEntry(const Slice& key, void* value) {
+void TableCache::DeleteEntry(const Slice& key, void* value) {
   TableAndFile* tf = reinterpret_cast<TableAndFile*>(value);
   delete tf->table;
   delete tf->file;
+  if (tf->mapped_by != NULL) {
+    MutexLock l(&tf->mapped_by->mmap_mutex_);
+    tf->mapped_by->mmap_files_--;
+  }
   delete tf;
 }
 
@@ -29,13 +36,29 @@ static void UnrefEntry(void* arg1, void* arg2) {
   cache->Release(h);
 }
 
+// Like UnrefEntry(), for iterators that advised sequential access.  The
+// file is advised random access again once the last of them is done.
+void TableCache::UnrefSequentialEntry(void* arg1, void* arg2) {
+  Cache* cache = reinterpret_cast<Cache*>(arg1);
+  Cache::Handle* h = reinterpret_cast<Cache::Handle*>(arg2);
+  TableAndFile* tf = reinterpret_cast<TableAndFile*>(cache->Value(h));
+  {
+    MutexLock l(&tf->mapped_by->mmap_mutex_);
+    if (--tf->sequential_readers == 0) {
+      tf->file->Hint(RandomAccessFile::kRandom);
+    }
+  }
+  cache->Release(h);
+}
+
 TableCache::TableCache(const std::string& dbname,
                        const Options* options,
                        int entries)
     : env_(options->env),
       dbname_(dbname),
       options_(options),
-      cache_(NewLRUCache(entries)) {
+      cache_(NewLRUCache(entries)),
+      mmap_files_(0) {
 }
 
 TableCache::~TableCache() {
@@ -50,35 +73,64 @@ Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
   Slice key(buf, sizeof(buf));
   *handle = cache_->Lookup(key);
   if (*handle == NULL) {
+    bool mmap = false;
+    if (options_->mmap_reads && !options_->use_direct_io) {
+      MutexLock l(&mmap_mutex_);
+      if (mmap_files_ < options_->max_mmap_files) {
+        mmap_files_++;
+        mmap = true;
+      }
+    }
+
     std::string fname = TableFileName(dbname_, file_number);
     RandomAccessFile* file = NULL;
     Table* table = NULL;
-    s = env_->NewRandomAccessFile(fname, &file);
+    s = OpenFile(fname, mmap, &file);
     if (!s.ok()) {
       std::string old_fname = SSTTableFileName(dbname_, file_number);
-      if (env_->NewRandomAccessFile(old_fname, &file).ok()) {
+      if (OpenFile(old_fname, mmap, &file).ok()) {
         s = Status::OK();
       }
     }
     if (s.ok()) {
+      if (mmap) {
+        file->Hint(RandomAccessFile::kRandom);
+      }
       s = Table::Open(*options_, file, file_size, &table);
     }
 
     if (!s.ok()) {
       assert(table == NULL);
       delete file;
+      if (mmap) {
+        MutexLock l(&mmap_mutex_);
+        mmap_files_--;
+      }
       // We do not cache error results so that if the error is transient,
       // or somebody repairs the file, we recover automatically.
     } else {
       TableAndFile* tf = new TableAndFile;
       tf->file = file;
       tf->table = table;
+      tf->mapped_by = mmap ? this : NULL;
+      tf->sequential_readers = 0;
       *handle = cache_->Insert(key, tf, 1, &DeleteEntry);
     }
   }
   return s;
 }
 
+Status TableCache::OpenFile(const std::string& fname, bool mmap,
+                            RandomAccessFile** file) {
+  if (options_->use_direct_io) {
+    return env_->NewRandomAccessFileWithDirectIO(fname, file);
+  }
+  if (options_->mmap_reads) {
+    return env_->NewRandomAccessFileWithMmap(fname, mmap, file);
+  }
+  return env_->NewRandomAccessFile(fname, file);
+}
+
 Iterator* TableCache::NewIterator(const ReadOptions& options,
                                   uint64_t file_number,
                                   uint64_t file_size,
@@ -93,9 +145,21 @@ Iterator* TableCache::NewIterator(const ReadOptions& options,
     return NewErrorIterator(s);
   }
 
-  Table* table = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+  TableAndFile* tf = reinterpret_cast<TableAndFile*>(cache_->Value(handle));
+  Table* table = tf->table;
   Iterator* result = table->NewIterator(options);
-  result->RegisterCleanup(&UnrefEntry, cache_, handle);
+  if (tf->mapped_by != NULL && !options.fill_cache) {
+    // A bulk scan, such as a compaction, that benefits from readahead
+    {
+      MutexLock l(&mmap_mutex_);
+      if (tf->sequential_readers++ == 0) {
+        tf->file->Hint(RandomAccessFile::kSequential);
+      }
+    }
+    result->RegisterCleanup(&UnrefSequentialEntry, cache_, handle);
+  } else {
+    result->RegisterCleanup(&UnrefEntry, cache_, handle);
+  }
   if (tableptr != NULL) {
     *tableptr = table;
   }
@@ -118,6 +182,76 @@ Status TableCache::Get(const ReadOptions& options,
   return s;
 }
 
+bool TableCache::AddPrefetch(const ReadOptions& options,
+                             uint64_t file_number,
+                             uint64_t file_size,
+                             const Slice& k,
+                             PrefetchBatch* batch) {
+  Cache::Handle* handle = NULL;
+  if (!FindTable(file_number, file_size, &handle).ok()) {
+    // Left to Get() to report
+    return true;
+  }
+  TableAndFile* tf = reinterpret_cast<TableAndFile*>(cache_->Value(handle));
+  BlockHandle block;
+  bool cached;
+  const bool may_match = tf->table->FindDataBlock(options, k, &block, &cached);
+  // Reads of a mapped file do not wait for the device, whether it was
+  // mapped for Options::mmap_reads or by the Env itself
+  if (!may_match || cached || tf->file->IsMapped() ||
+      !batch->seen.insert(std::make_pair(tf->table, block.offset())).second) {
+    cache_->Release(handle);
+    return may_match;
+  }
+
+  ReadRequest request;
+  request.file = tf->file;
+  request.offset = block.offset();
+  request.n = static_cast<size_t>(block.size()) + kBlockTrailerSize;
+  // Blocks read past the capacity of the block cache would evict the
+  // first ones before Get() gets to them
+  if (batch->bytes + request.n > options_->block_cache->Capacity()) {
+    batch->full = true;
+    cache_->Release(handle);
+    return true;
+  }
+  batch->bytes += request.n;
+  batch->tables.push_back(handle);
+  batch->block_tables.push_back(tf->table);
+  batch->blocks.push_back(block);
+  batch->requests.push_back(request);
+  return true;
+}
+
+void TableCache::Prefetch(const ReadOptions& options, PrefetchBatch* batch) {
+  std::vector<ReadRequest>& requests = batch->requests;
+  for (size_t i = 0; i < requests.size(); i++) {
+    requests[i].scratch = new char[requests[i].n];
+  }
+  if (!requests.empty()) {
+    env_->MultiRead(&requests[0], requests.size());
+  }
+  for (size_t i = 0; i < requests.size(); i++) {
+    if (requests[i].status.ok()) {
+      batch->block_tables[i]->InsertDataBlock(options, batch->blocks[i],
+                                              requests[i].scratch,
+                                              requests[i].result);
+    } else {
+      delete[] requests[i].scratch;
+    }
+  }
+  for (size_t i = 0; i < batch->tables.size(); i++) {
+    cache_->Release(batch->tables[i]);
+  }
+  batch->tables.clear();
+  batch->block_tables.clear();
+  batch->blocks.clear();
+  batch->requests.clear();
+  batch->seen.clear();
+  batch->bytes = 0;
+  batch->full = false;
+}
+
 void TableCache::Evict(uint64_t file_number) {
   char buf[sizeof(file_number)];
   EncodeFixed64(buf, file_number);
@@ -7,17 +7,20 @@
 #ifndef STORAGE_LEVELDB_DB_TABLE_CACHE_H_
 #define STORAGE_LEVELDB_DB_TABLE_CACHE_H_
 
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
 #include <stdint.h>
 #include "db/dbformat.h"
 #include "leveldb/cache.h"
+#include "leveldb/env.h"
 #include "leveldb/table.h"
 #include "port/port.h"
+#include "table/format.h"
 
 namespace leveldb {
 
-class Env;
-
 class TableCache {
  public:
   TableCache(const std::string& dbname, const Options* options, int entries);
@@ -44,6 +47,35 @@ class TableCache {
              void* arg,
              void (*handle_result)(void*, const Slice&, const Slice&));
 
+  // Data blocks gathered by AddPrefetch() for Prefetch() to read at once.
+  // Holds on to the tables they belong to until then.
+  struct PrefetchBatch {
+    std::vector<Cache::Handle*> tables;
+    std::vector<Table*> block_tables;
+    std::vector<BlockHandle> blocks;
+    std::vector<ReadRequest> requests;
+    std::set<std::pair<Table*, uint64_t> > seen;
+    size_t bytes;  // Combined size of requests
+    bool full;     // True if a block did not fit in the block cache
+
+    PrefetchBatch() : bytes(0), full(false) { }
+  };
+
+  // Returns false if internal key "k" is not in the specified file, as far
+  // as its filter and index tell.  Otherwise returns true and, unless it
+  // is cached or in a mapped file, adds the data block that would hold "k"
+  // to *batch.  Sets batch->full instead if the blocks would no longer fit
+  // in the block cache together.
+  bool AddPrefetch(const ReadOptions& options,
+                   uint64_t file_number,
+                   uint64_t file_size,
+                   const Slice& k,
+                   PrefetchBatch* batch);
+
+  // Read the data blocks in *batch with Env::MultiRead() and store them in
+  // the block cache, then empty *batch.
+  void Prefetch(const ReadOptions& options, PrefetchBatch* batch);
+
   // Evict any entry for the specified file number
   void Evict(uint64_t file_number);
 
@@ -53,7 +85,16 @@ class TableCache {
   const Options* options_;
   Cache* cache_;
 
+  // Number of table files in cache_ that are mapped into memory, for
+  // Options::max_mmap_files.  Also guards the hints of those files.
+  port::Mutex mmap_mutex_;
+  int mmap_files_;
+
   Status FindTable(uint64_t file_number, uint64_t file_size, Cache::Handle**);
+  Status OpenFile(const std::string& fname, bool mmap,
+                  RandomAccessFile** file);
+  static void DeleteEntry(const Slice& key, void* value);
+  static void UnrefSequentialEntry(void* arg1, void* arg2);
 };
 
 }  // namespace leveldb
@@ -0,0 +1,142 @@
+#include "db/table_cache.h"
+
+#include "db/filename.h"
+#include "leveldb/env.h"
+#include "leveldb/iterator.h"
+#include "leveldb/table_builder.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+namespace {
+
+class AtomicCounter {
+ private:
+  port::Mutex mu_;
+  int count_;
+ public:
+  AtomicCounter() : count_(0) { }
+  void Increment() {
+    MutexLock l(&mu_);
+    count_++;
+  }
+  int Read() {
+    MutexLock l(&mu_);
+    return count_;
+  }
+  void Reset() {
+    MutexLock l(&mu_);
+    count_ = 0;
+  }
+};
+
+// Counts the hints given to files opened with NewRandomAccessFileWithMmap()
+class HintCountingEnv : public EnvWrapper {
+ public:
+  AtomicCounter random_hints_;
+  AtomicCounter sequential_hints_;
+
+  explicit HintCountingEnv(Env* base) : EnvWrapper(base) { }
+
+  Status NewRandomAccessFileWithMmap(const std::string& f, bool mmap,
+                                     RandomAccessFile** r) {
+    class HintCountingFile : public RandomAccessFile {
+     private:
+      RandomAccessFile* target_;
+      HintCountingEnv* env_;
+     public:
+      HintCountingFile(RandomAccessFile* target, HintCountingEnv* env)
+          : target_(target), env_(env) {
+      }
+      virtual ~HintCountingFile() { delete target_; }
+      virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                          char* scratch) const {
+        return target_->Read(offset, n, result, scratch);
+      }
+      virtual void Hint(AccessPattern pattern) const {
+        if (pattern == kRandom) {
+          env_->random_hints_.Increment();
+        } else if (pattern == kSequential) {
+          env_->sequential_hints_.Increment();
+        }
+        target_->Hint(pattern);
+      }
+      virtual bool IsMapped() const { return target_->IsMapped(); }
+    };
+
+    Status s = target()->NewRandomAccessFileWithMmap(f, mmap, r);
+    if (s.ok()) {
+      *r = new HintCountingFile(*r, this);
+    }
+    return s;
+  }
+};
+
+}  // namespace
+
+class TableCacheTest {
+ public:
+  std::string dbname_;
+  HintCountingEnv env_;
+  Options options_;
+  TableCache* cache_;
+  uint64_t file_size_;
+
+  TableCacheTest() : env_(Env::Default()) {
+    dbname_ = test::TmpDir() + "/table_cache_test";
+    env_.CreateDir(dbname_);
+    options_.env = &env_;
+    options_.mmap_reads = true;
+    cache_ = new TableCache(dbname_, &options_, 10);
+  }
+
+  ~TableCacheTest() {
+    delete cache_;
+    env_.DeleteFile(TableFileName(dbname_, 1));
+    env_.DeleteDir(dbname_);
+  }
+
+  void BuildTable() {
+    WritableFile* file;
+    ASSERT_OK(env_.NewWritableFile(TableFileName(dbname_, 1), &file));
+    TableBuilder builder(options_, file);
+    builder.Add("a", "va");
+    builder.Add("b", "vb");
+    ASSERT_OK(builder.Finish());
+    ASSERT_OK(file->Close());
+    file_size_ = builder.FileSize();
+    delete file;
+  }
+};
+
+TEST(TableCacheTest, SequentialHintWithConcurrentScans) {
+  BuildTable();
+
+  // Bulk scans of a mapped table advise sequential access
+  ReadOptions read_options;
+  read_options.fill_cache = false;
+  Iterator* iter1 = cache_->NewIterator(read_options, 1, file_size_);
+  Iterator* iter2 = cache_->NewIterator(read_options, 1, file_size_);
+  iter1->SeekToFirst();
+  iter2->SeekToFirst();
+  ASSERT_EQ("a", iter1->key().ToString());
+  ASSERT_EQ("a", iter2->key().ToString());
+  ASSERT_EQ(1, env_.sequential_hints_.Read());
+
+  // Random access is only advised again when both are done
+  env_.random_hints_.Reset();
+  delete iter1;
+  ASSERT_EQ(0, env_.random_hints_.Read());
+  iter2->Next();
+  ASSERT_EQ("b", iter2->key().ToString());
+  delete iter2;
+  ASSERT_EQ(1, env_.random_hints_.Read());
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
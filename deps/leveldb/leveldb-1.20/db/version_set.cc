@@ -428,6 +428,38 @@ Status Version::Get(const ReadOptions& options,
   return Status::NotFound(Slice());  // Use an empty error message for speed
 }
 
+namespace {
+struct PrefetchState {
+  const ReadOptions* options;
+  TableCache* table_cache;
+  TableCache::PrefetchBatch* batch;
+  Slice ikey;
+};
+}
+static bool AddPrefetch(void* arg, int level, FileMetaData* f) {
+  PrefetchState* state = reinterpret_cast<PrefetchState*>(arg);
+  // Files past the first that may hold the key are only read if it turns
+  // out not to be there, so stop at that one
+  return !state->table_cache->AddPrefetch(*state->options, f->number,
+                                          f->file_size, state->ikey,
+                                          state->batch);
+}
+
+void Version::Prefetch(const ReadOptions& options,
+                       const Slice* ikeys, size_t n) {
+  TableCache::PrefetchBatch batch;
+  PrefetchState state;
+  state.options = &options;
+  state.table_cache = vset_->table_cache_;
+  state.batch = &batch;
+  for (size_t i = 0; i < n && !batch.full; i++) {
+    state.ikey = ikeys[i];
+    ForEachOverlapping(ExtractUserKey(ikeys[i]), ikeys[i], &state,
+                       &AddPrefetch);
+  }
+  vset_->table_cache_->Prefetch(options, &batch);
+}
+
 bool Version::UpdateStats(const GetStats& stats) {
   FileMetaData* f = stats.seek_file;
   if (f != NULL) {
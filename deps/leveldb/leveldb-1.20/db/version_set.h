@@ -74,6 +74,12 @@ class Version {
   Status Get(const ReadOptions&, const LookupKey& key, ValueSink* val,
              GetStats* stats);
 
+  // Read the data blocks that Get() would read first for each of the
+  // internal keys in ikeys[0,n-1], with a single Env::MultiRead(), into
+  // the block cache.
+  // REQUIRES: lock is not held
+  void Prefetch(const ReadOptions&, const Slice* ikeys, size_t n);
+
   // Adds "stats" into the current state.  Returns true if a new
   // compaction may need to be triggered, false otherwise.
   // REQUIRES: lock is held
@@ -191,6 +197,9 @@ class VersionSet {
   // Allocate and return a new file number
   uint64_t NewFileNumber() { return next_file_number_++; }
 
+  // Return the number that will be allocated to the next new file.
+  uint64_t NextFileNumber() const { return next_file_number_; }
+
   // Arrange to reuse "file_number" unless a newer file number has
   // already been allocated.
   // REQUIRES: "file_number" was returned by a call to NewFileNumber().
@@ -52,6 +52,17 @@ class Cache {
   virtual Handle* Insert(const Slice& key, void* value, size_t charge,
                          void (*deleter)(const Slice& key, void* value)) = 0;
 
+  enum Priority { kLowPriority, kHighPriority };
+
+  // Like Insert(), but with the given priority.  Entries with high
+  // priority are only evicted if no entries with low priority can be.
+  // The default implementation ignores the priority.
+  virtual Handle* Insert(const Slice& key, void* value, size_t charge,
+                         void (*deleter)(const Slice& key, void* value),
+                         Priority priority) {
+    return Insert(key, value, charge, deleter);
+  }
+
   // If the cache has no mapping for "key", returns NULL.
   //
   // Else return a handle that corresponds to the mapping.  The caller
@@ -92,6 +103,9 @@ class Cache {
   // cache.
   virtual size_t TotalCharge() const = 0;
 
+  // Return the combined charge of elements that the cache holds at most.
+  virtual size_t Capacity() const = 0;
+
  private:
   void LRU_Remove(Handle* e);
   void LRU_Append(Handle* e);
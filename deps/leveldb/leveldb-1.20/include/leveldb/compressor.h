@@ -0,0 +1,110 @@
+// A Compressor compresses the blocks of table files.  The type of each
+// block is stored in its trailer, so a table can be read regardless of
+// Options::compression as long as a compressor is registered for every
+// type of block in it.
+//
+// Compressors for the builtin CompressionType values are registered
+// automatically, if the library was built with support for them.  An
+// application can register its own with RegisterCompressor(), and select
+// it with Options::compression = static_cast<CompressionType>(type()).
+//
+// A compressor may also support dictionaries, which are trained from
+// sample blocks and stored in each table that uses one.  See
+// Options::compression_dictionary_size.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_COMPRESSOR_H_
+#define STORAGE_LEVELDB_INCLUDE_COMPRESSOR_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "leveldb/options.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+class CompressionDictionary;
+class Slice;
+
+class Compressor {
+ public:
+  virtual ~Compressor();
+
+  // The name of the compression algorithm, for logging.
+  virtual const char* Name() const = 0;
+
+  // The type stored in the trailer of blocks compressed by this object.
+  // Values below 0x80 are reserved for builtin compressors.
+  //
+  // REQUIRES: the encoding of a type must never change, since it is part
+  // of the persistent format on disk.
+  virtual CompressionType type() const = 0;
+
+  // Store the compressed form of input in *output, replacing its contents.
+  // Return false if input could not be compressed, in which case the block
+  // is stored uncompressed.
+  virtual bool Compress(const Slice& input, std::string* output) const = 0;
+
+  // Set *length to the uncompressed length of input, a block compressed by
+  // Compress().  Return false if input is corrupt.
+  virtual bool GetUncompressedLength(const Slice& input,
+                                     size_t* length) const = 0;
+
+  // Uncompress input into output, which has room for the number of bytes
+  // returned by GetUncompressedLength().  Return false if input is corrupt.
+  virtual bool Uncompress(const Slice& input, char* output) const = 0;
+
+  // Return true if TrainDictionary() and NewDictionary() are implemented.
+  // Table builders only hold back sample blocks for compressors that
+  // support dictionaries.  The default implementation returns false.
+  virtual bool SupportsDictionaries() const;
+
+  // Train a dictionary of at most max_size bytes from samples, which are
+  // typical of the blocks to be compressed, and store it in *dictionary.
+  // Return false if dictionaries are not supported, or if the samples are
+  // not enough to train one.  The default implementation returns false.
+  virtual bool TrainDictionary(const std::vector<Slice>& samples,
+                               size_t max_size,
+                               std::string* dictionary) const;
+
+  // Return a new object that compresses blocks with dictionary, as trained
+  // by TrainDictionary(), or NULL if it is not valid.  The caller should
+  // delete the result when it is no longer needed.  The default
+  // implementation returns NULL.
+  virtual CompressionDictionary* NewDictionary(const Slice& dictionary) const;
+};
+
+// Compresses blocks of a table with a dictionary trained for that table.
+// Blocks are stored with the type of the compressor that created it, and
+// are uncompressed with GetUncompressedLength() of that compressor
+// followed by Uncompress() of this object.
+//
+// Must be safe for concurrent use by multiple threads.
+class CompressionDictionary {
+ public:
+  virtual ~CompressionDictionary();
+
+  // The type of the compressor that created this object.
+  virtual CompressionType type() const = 0;
+
+  // Like Compressor::Compress(), but with the dictionary.
+  virtual bool Compress(const Slice& input, std::string* output) const = 0;
+
+  // Like Compressor::Uncompress().  input may have been compressed with
+  // this dictionary, or by the compressor without one.
+  virtual bool Uncompress(const Slice& input, char* output) const = 0;
+};
+
+// Register a compressor for blocks of type compressor->type().  Returns
+// InvalidArgument if another compressor is registered for that type.
+// The compressor must remain live while any database is open.
+extern Status RegisterCompressor(const Compressor* compressor);
+
+// Return the compressor registered for blocks of the given type, or NULL
+// if there is none.  There is none for kNoCompression, nor for builtin
+// types that this library was built without.
+extern const Compressor* GetCompressor(CompressionType type);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_COMPRESSOR_H_
@@ -39,6 +39,33 @@ struct Range {
   Range(const Slice& s, const Slice& l) : start(s), limit(l) { }
 };
 
+// Progress of a compaction started by DB::CompactRangeAsync().
+struct CompactRangeProgress {
+  int levels_done;          // Number of levels that have been compacted
+  int levels_total;         // Number of levels to compact
+  uint64_t bytes_read;      // Bytes of table files read so far
+  uint64_t bytes_written;   // Bytes of table files written so far
+
+  CompactRangeProgress()
+      : levels_done(0), levels_total(0), bytes_read(0), bytes_written(0) { }
+};
+
+// Observes a compaction started by DB::CompactRangeAsync(). Methods are
+// called from the background compaction thread, without holding any of
+// the DB's locks.
+class CompactRangeListener {
+ public:
+  virtual ~CompactRangeListener();
+
+  // Called after each step of the compaction, where a step produces a
+  // handful of table files. Returning false stops the compaction before
+  // the next step; it then finishes with an OK status.
+  virtual bool OnProgress(const CompactRangeProgress& progress) = 0;
+
+  // Called exactly once, when the compaction has finished or failed.
+  virtual void OnDone(const Status& status) = 0;
+};
+
 // A DB is a persistent ordered map from keys to values.
 // A DB is safe for concurrent access from multiple threads without
 // any external synchronization.
@@ -84,6 +111,16 @@ class DB {
   virtual Status Get(const ReadOptions& options,
                      const Slice& key, ValueSink* value) = 0;
 
+  // Read the blocks of the table files that Get() calls for keys[0,n-1]
+  // would read into the block cache, issuing those reads to the device at
+  // once where the Env supports it (see Env::MultiRead()), so that the
+  // Get() calls then do not each wait for one.  Only a hint: does nothing
+  // if options.fill_cache is false, blocks of files mapped into memory are
+  // not read, and blocks past the capacity of the block cache are left to
+  // Get().  The default implementation does nothing.
+  virtual void Prefetch(const ReadOptions& options,
+                        const Slice* keys, size_t n);
+
   // Return a heap-allocated iterator over the contents of the database.
   // The result of NewIterator() is initially invalid (caller must
   // call one of the Seek methods on the iterator before using it).
@@ -118,6 +155,8 @@ class DB {
   //     of the sstables that make up the db contents.
   //  "leveldb.approximate-memory-usage" - returns the approximate number of
   //     bytes of memory in use by the DB.
+  //  "leveldb.negative-cache" - returns a multi-line string with the number
+  //     of lookups in the negative cache, hits and the hit rate.
   virtual bool GetProperty(const Slice& property, std::string* value) = 0;
 
   // For each i in [0,n-1], store in "sizes[i]", the approximate
@@ -143,6 +182,31 @@ class DB {
   //    db->CompactRange(NULL, NULL);
   virtual void CompactRange(const Slice* begin, const Slice* end) = 0;
 
+  // Like CompactRange() but returns once the memtable has been scheduled
+  // for compaction, leaving the rest to the background compaction thread
+  // which reports to "listener". If a non-OK status is returned then the
+  // listener is not called. Otherwise it must stay alive until OnDone()
+  // has been called, which at the latest happens when the DB is deleted.
+  virtual Status CompactRangeAsync(const Slice* begin, const Slice* end,
+                                   CompactRangeListener* listener) = 0;
+
+  // Remove table files in level 1 and higher that only contain keys in
+  // the range [*begin,*end), without reading or rewriting them. Keys in
+  // files that are not fully covered by the range, in level-0 files and
+  // in the memtable are left alone, so the caller is expected to delete
+  // those individually. Stores the number of removed files in *deleted.
+  //
+  // Because removing files is visible to every reader, nothing is removed
+  // unless "snapshot" is the only live snapshot (or, if NULL, there are no
+  // live snapshots). Only files that were written before "snapshot" was
+  // created are considered, so that writes made after it survive.
+  //
+  // begin==NULL is treated as a key before all keys in the database.
+  // end==NULL is treated as a key after all keys in the database.
+  virtual Status DeleteFilesInRange(const Slice* begin, const Slice* end,
+                                    const Snapshot* snapshot,
+                                    int* deleted) = 0;
+
  private:
   // No copying allowed
   DB(const DB&);
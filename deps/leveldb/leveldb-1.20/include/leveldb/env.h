@@ -17,6 +17,7 @@
 #include <vector>
 #include <stdarg.h>
 #include <stdint.h>
+#include "leveldb/slice.h"
 #include "leveldb/status.h"
 
 namespace leveldb {
@@ -25,9 +26,22 @@ class FileLock;
 class Logger;
 class RandomAccessFile;
 class SequentialFile;
-class Slice;
 class WritableFile;
 
+// One read in a batch passed to Env::MultiRead().  The caller fills in
+// file, offset, n and scratch; MultiRead() sets result and status as
+// RandomAccessFile::Read() would.
+struct ReadRequest {
+  const RandomAccessFile* file;
+  uint64_t offset;
+  size_t n;
+  char* scratch;
+  Slice result;
+  Status status;
+
+  ReadRequest() : file(NULL), offset(0), n(0), scratch(NULL) { }
+};
+
 class Env {
  public:
   Env() { }
@@ -59,6 +73,35 @@ class Env {
   virtual Status NewRandomAccessFile(const std::string& fname,
                                      RandomAccessFile** result) = 0;
 
+  // Like NewRandomAccessFile(), but the file is mapped into memory if mmap
+  // is true, so that reads return its contents without copying them, and
+  // is not mapped otherwise, regardless of any limit the environment places
+  // on the number of mapped files.  The default implementation ignores
+  // mmap and calls NewRandomAccessFile().  EnvWrapper does not forward it,
+  // so that subclasses that override NewRandomAccessFile() see every file.
+  virtual Status NewRandomAccessFileWithMmap(const std::string& fname,
+                                             bool mmap,
+                                             RandomAccessFile** result);
+
+  // Like NewRandomAccessFile() and NewWritableFile(), but the file is read
+  // or written with direct I/O, bypassing the page cache, where supported.
+  // The default implementations call NewRandomAccessFile() and
+  // NewWritableFile().  EnvWrapper does not forward them, for the same
+  // reason as NewRandomAccessFileWithMmap().
+  virtual Status NewRandomAccessFileWithDirectIO(const std::string& fname,
+                                                 RandomAccessFile** result);
+  virtual Status NewWritableFileWithDirectIO(const std::string& fname,
+                                             WritableFile** result);
+
+  // Perform the n reads in requests[0,n-1], which may be issued to the
+  // device at once rather than one after the other.  The default
+  // implementation calls RandomAccessFile::Read() for each request.
+  // EnvWrapper does not forward it, so that a wrapped environment never
+  // sees files it did not open.
+  //
+  // REQUIRES: every file was opened by this environment.
+  virtual void MultiRead(ReadRequest* requests, size_t n);
+
   // Create an object that writes to a new file with the specified
   // name.  Deletes any existing file with the same name and creates a
   // new file.  On success, stores a pointer to the new file in
@@ -203,6 +246,14 @@ class RandomAccessFile {
   RandomAccessFile() { }
   virtual ~RandomAccessFile();
 
+  // How a file is expected to be read, for Hint()
+  enum AccessPattern {
+    kNormal,
+    kRandom,      // Read ahead as little as possible
+    kSequential,  // Read ahead aggressively
+    kWillNeed     // Read the whole file ahead
+  };
+
   // Read up to "n" bytes from the file starting at "offset".
   // "scratch[0..n-1]" may be written by this routine.  Sets "*result"
   // to the data that was read (including if fewer than "n" bytes were
@@ -215,6 +266,17 @@ class RandomAccessFile {
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const = 0;
 
+  // Advise the environment of how the file will be read from now on, so
+  // that it can tune readahead.  The default implementation does nothing.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void Hint(AccessPattern pattern) const;
+
+  // Return true if the file is mapped into memory, so that reads copy
+  // from the page cache rather than wait for the device.  The default
+  // implementation returns false.
+  virtual bool IsMapped() const;
+
  private:
   // No copying allowed
   RandomAccessFile(const RandomAccessFile&);
@@ -6,6 +6,7 @@
 #define STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
 
 #include <stddef.h>
+#include <vector>
 
 namespace leveldb {
 
@@ -23,8 +24,13 @@ class Snapshot;
 enum CompressionType {
   // NOTE: do not change the values of existing entries, as these are
   // part of the persistent format on disk.
+  // The values of kLZ4Compression and kZstdCompression match those of
+  // other leveldb derivatives.  See leveldb/compressor.h for the
+  // compressors of these types, and for adding more.
   kNoCompression     = 0x0,
-  kSnappyCompression = 0x1
+  kSnappyCompression = 0x1,
+  kLZ4Compression    = 0x4,
+  kZstdCompression   = 0x7
 };
 
 // Options to control the behavior of a database (passed to DB::Open)
@@ -89,6 +95,35 @@ struct Options {
   // Default: 1000
   int max_open_files;
 
+  // If true, table files are mapped into memory, up to max_mmap_files of
+  // them, and blocks are read from them without copying.  Uncompressed
+  // blocks read from a mapped file are not stored in block_cache, so that
+  // they are only held in memory once, by the page cache, and a small
+  // block_cache will do.  Mapped files are advised that they will be read
+  // randomly, except while iterators with ReadOptions::fill_cache false,
+  // such as those of compactions, read them sequentially.
+  //
+  // If false, the env decides.  Env::Default() maps up to 1000 table files
+  // at a time on 64-bit platforms, shared by all databases in the process.
+  //
+  // Default: false
+  bool mmap_reads;
+
+  // If mmap_reads is true, the number of table files to map into memory.
+  // Others are opened as if mmap_reads was false.
+  //
+  // Default: 1000
+  int max_mmap_files;
+
+  // If true, table files are written and read with direct I/O, bypassing
+  // the page cache of the operating system, so that block_cache is the only
+  // cache of their contents and should be sized accordingly.  Takes
+  // precedence over mmap_reads.  Where the file system does not support
+  // direct I/O, table files are accessed as if this was false.
+  //
+  // Default: false
+  bool use_direct_io;
+
   // Control over blocks (user data is stored in a set of blocks, and
   // a block is the unit of reading from disk).
 
@@ -97,6 +132,29 @@ struct Options {
   // Default: NULL
   Cache* block_cache;
 
+  // If non-NULL, use the specified cache for data blocks as they are
+  // stored in table files, compressed.  A read that misses block_cache
+  // looks for the block here before reading it from the file, and then
+  // only has to uncompress it.  Since compressed blocks are typically a
+  // third to half the size of uncompressed ones, this holds more data in
+  // the same memory than block_cache, at the cost of uncompressing it on
+  // each use.  Blocks that are stored uncompressed are not cached here.
+  // Default: NULL
+  Cache* compressed_block_cache;
+
+  // If non-NULL, use the specified cache for values of keys found in
+  // table files, so that repeated reads of the same keys skip the table
+  // lookup.  Entries are keyed by user key, so this requires a comparator
+  // that only considers keys equal if their bytes are equal.
+  // Default: NULL
+  Cache* row_cache;
+
+  // If non-zero, remember up to this many user keys that were found to not
+  // exist, so that repeated reads of missing keys are answered without
+  // looking at the memtables and table files.  Each entry takes 24 bytes.
+  // Default: 0
+  size_t negative_cache_entries;
+
   // Approximate size of user data packed per block.  Note that the
   // block size specified here corresponds to uncompressed data.  The
   // actual size of the unit read from disk may be smaller if
@@ -138,8 +196,55 @@ struct Options {
   // worth switching to kNoCompression.  Even if the input data is
   // incompressible, the kSnappyCompression implementation will
   // efficiently detect that and will switch to uncompressed mode.
+  //
+  // kLZ4Compression compresses and decompresses faster than Snappy.
+  // kZstdCompression compresses to about 2/3 of the size that Snappy
+  // does, but compresses several times slower and decompresses about
+  // half as fast.  Both are only available if the library was built with
+  // them; otherwise DB::Open() returns NotSupported.
   CompressionType compression;
 
+  // Per-level overrides of compression, block_size and
+  // block_restart_interval, for the tables that flushes and compactions
+  // write to each level.  Entry i applies to level i, and the last entry
+  // to the levels after it.  If empty, all levels use the setting above.
+  //
+  // Data in the first levels is rewritten soon, so compressing it mostly
+  // costs CPU, while the last levels hold most of the data.  For example,
+  // { kNoCompression, kNoCompression, kLZ4Compression, kZstdCompression }
+  // only compresses tables from level 2 on, and the coldest data the most.
+  //
+  // Default: empty
+  std::vector<CompressionType> compression_per_level;
+  std::vector<size_t> block_size_per_level;
+  std::vector<int> block_restart_interval_per_level;
+
+  // If non-zero, each table whose compressor supports dictionaries (only
+  // kZstdCompression among the builtin ones) gets a dictionary of up to
+  // this many bytes, trained on its first data blocks and stored in it.
+  // This helps most when values are small and alike, such as JSON
+  // documents of a few hundred bytes, which a block holds too few of to
+  // compress well on its own.
+  //
+  // To train a dictionary, a table holds back about 100 times its size
+  // of entries before writing any, so this costs memory and CPU during
+  // flushes and compactions.  Pair it with compression_per_level so that
+  // only the last levels, where most data ends up, use kZstdCompression;
+  // tables written with other compressors don't hold back any entries.
+  //
+  // Default: 0
+  size_t compression_dictionary_size;
+
+  // If positive, flushes and compactions hand the data blocks of the
+  // tables they write to this many threads to compress, while they go on
+  // building the next blocks, and write the compressed blocks in order.
+  // This keeps slow compressors such as kZstdCompression from limiting
+  // their throughput, if there are idle cores.  The threads are shared by
+  // all databases in the process.  Has no effect with kNoCompression.
+  //
+  // Default: 0
+  int compression_threads;
+
   // EXPERIMENTAL: If true, append to existing MANIFEST and log files
   // when a database is opened.  This can significantly speed up open.
   //
@@ -153,6 +258,55 @@ struct Options {
   // Default: NULL
   const FilterPolicy* filter_policy;
 
+  // If true, new table files get a single filter for all of their keys
+  // instead of one filter per 2KB of data.  A whole-table filter is
+  // checked once per table before its index is searched, and makes
+  // better use of its bits, but has to be held in memory at once.
+  // Tables written with either kind of filter can be read regardless of
+  // this setting.
+  //
+  // Default: false
+  bool whole_table_filter;
+
+  // If true and block_cache is non-NULL, the index block and filter of a
+  // table are stored in block_cache instead of being held for as long as
+  // the table is open, so that block_cache's capacity bounds their memory
+  // too.  They are inserted with high priority, so that they are only
+  // evicted if no data blocks can be.
+  //
+  // Default: false
+  bool cache_index_and_filter_blocks;
+
+  // If non-zero, the index of new table files is split into partitions of
+  // approximately this many bytes, which are read like data blocks when
+  // needed, plus a top-level index of the partitions that is read when a
+  // table is opened.  This bounds the cost of opening large tables and the
+  // memory their index takes.  Tables with a partitioned index have a
+  // different magic number, so versions of leveldb without support for it
+  // fail to open them with a Corruption status.
+  //
+  // Default: 0
+  size_t index_partition_size;
+
+  // If true, data blocks of new table files get a hash index that maps
+  // each user key to the restart interval it is in, so that a lookup of
+  // a key that is in the block can skip the binary search of the restart
+  // array.  It takes about 1.3 bytes per key.  Tables with a hash index
+  // can not be read by versions of leveldb without support for it.
+  //
+  // Default: false
+  bool data_block_hash_index;
+
+  // If true and block_cache is non-NULL, the first iterator that reads a
+  // data block with ReadOptions::fill_cache set stores a decoded copy of
+  // it in block_cache, with all keys materialized, instead of the block
+  // itself.  Later reads of the block use that copy, which makes Next()
+  // and Prev() cheaper at the cost of memory for the keys that the block
+  // stores prefix-compressed.
+  //
+  // Default: false
+  bool cache_decoded_blocks;
+
   // Create an Options object with default values for all fields.
   Options();
 };
@@ -12,6 +12,8 @@ namespace leveldb {
 
 class Block;
 class BlockHandle;
+struct BlockContents;
+class FilterBlockReader;
 class Footer;
 struct Options;
 class RandomAccessFile;
@@ -62,6 +64,36 @@ class Table {
   explicit Table(Rep* rep) { rep_ = rep; }
   static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
 
+  // Like BlockReader(), for iterators that scan the table: may decode the
+  // block and store it in the block cache (see cache_decoded_blocks).
+  static Iterator* ScanBlockReader(void*, const ReadOptions&, const Slice&);
+  static Iterator* ReadDataBlock(void*, const ReadOptions&, const Slice&,
+                                 bool scan);
+
+  // Reads the contents of a data block from the compressed block cache,
+  // or else from the file.
+  Status ReadBlockContents(const ReadOptions&, const BlockHandle& handle,
+                           BlockContents* contents) const;
+
+  // Returns true if the data block identified by handle is in the block
+  // cache, decoded or not, or in the compressed block cache.
+  bool DataBlockIsCached(const BlockHandle& handle) const;
+
+  // Returns a new iterator over the index, which maps the last key of
+  // each data block to its handle.  If the index is partitioned, this
+  // reads index partitions as needed.
+  Iterator* NewIndexIterator(const ReadOptions&) const;
+
+  // Returns a new iterator over the index block, which is looked up in
+  // the block cache if the index is not held by the table itself.
+  Iterator* NewTopLevelIndexIterator(const ReadOptions&) const;
+
+  // Returns the filter of the table, or NULL if it has none.  If the
+  // filter is held by the block cache, sets *cache_handle to the handle
+  // that the caller must pass to ReleaseFilter() when done with it.
+  FilterBlockReader* GetFilter(void** cache_handle) const;
+  void ReleaseFilter(void* cache_handle) const;
+
   // Calls (*handle_result)(arg, ...) with the entry found after a call
   // to Seek(key).  May not make such a call if filter policy says
   // that key is not present.
@@ -71,9 +103,22 @@ class Table {
       void* arg,
       void (*handle_result)(void* arg, const Slice& k, const Slice& v));
 
+  // Sets *handle to the data block that InternalGet() would read for key,
+  // and *cached to whether it can be had without reading the file.
+  // Returns false if the filter or the index rule key out.
+  bool FindDataBlock(const ReadOptions&, const Slice& key,
+                     BlockHandle* handle, bool* cached) const;
+
+  // Stores the data block identified by handle, which was read into buf
+  // as contents, in the block cache.  Takes ownership of buf, which must
+  // have been allocated with new[].
+  void InsertDataBlock(const ReadOptions&, const BlockHandle& handle,
+                       char* buf, const Slice& contents) const;
+
 
-  void ReadMeta(const Footer& footer);
-  void ReadFilter(const Slice& filter_handle_value);
+  Status ReadMeta(const Footer& footer);
+  void ReadFilter(const Slice& filter_handle_value, bool whole_table);
+  Status ReadDictionary(const Slice& dictionary_handle_value);
 
   // No copying allowed
   Table(const Table&);
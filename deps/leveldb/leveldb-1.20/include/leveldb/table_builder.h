@@ -13,7 +13,9 @@
 #ifndef STORAGE_LEVELDB_INCLUDE_TABLE_BUILDER_H_
 #define STORAGE_LEVELDB_INCLUDE_TABLE_BUILDER_H_
 
+#include <stddef.h>
 #include <stdint.h>
+#include <string>
 #include "leveldb/options.h"
 #include "leveldb/status.h"
 
@@ -21,6 +23,7 @@ namespace leveldb {
 
 class BlockBuilder;
 class BlockHandle;
+class CompressionDictionary;
 class WritableFile;
 
 class TableBuilder {
@@ -70,13 +73,21 @@ class TableBuilder {
   // Number of calls to Add() so far.
   uint64_t NumEntries() const;
 
-  // Size of the file generated so far.  If invoked after a successful
-  // Finish() call, returns the size of the final generated file.
+  // Size of the file generated so far, counting entries held back to
+  // train a compression dictionary at their uncompressed size.  If invoked
+  // after a successful Finish() call, returns the size of the final
+  // generated file.
   uint64_t FileSize() const;
 
  private:
   bool ok() const { return status().ok(); }
-  void WriteBlock(BlockBuilder* block, BlockHandle* handle);
+  void AddToBlock(const Slice& key, const Slice& value);
+  void StartDictionary();
+  void AddIndexEntry(const std::string& key, const BlockHandle& handle);
+  void WriteCompressedBlocks(size_t max_in_flight);
+  void WriteBlock(BlockBuilder* block, BlockHandle* handle,
+                  const CompressionDictionary* dictionary = NULL);
+  void FlushIndexPartition(const std::string& last_key);
   void WriteRawBlock(const Slice& data, CompressionType, BlockHandle* handle);
 
   struct Rep;
@@ -135,6 +135,10 @@ extern bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg);
 // the newly extended CRC value (which may also be zero).
 uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size);
 
+// Returns the number of elements of array[0,n-1] that are less than value,
+// using SIMD instructions if the CPU supports them.
+size_t CountLessThan(const uint64_t* array, size_t n, uint64_t value);
+
 }  // namespace port
 }  // namespace leveldb
 
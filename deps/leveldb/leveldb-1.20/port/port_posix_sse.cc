@@ -2,12 +2,13 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 //
-// A portable implementation of crc32c, optimized to handle
-// four bytes at a time.
+// Hardware accelerated crc32c, and CountLessThan().
 //
-// In a separate source file to allow this accelerated CRC32C function to be
-// compiled with the appropriate compiler flags to enable x86 SSE 4.2
-// instructions.
+// In a separate source file so that the functions using SSE 4.2, PCLMUL,
+// AVX2 or ARMv8 CRC instructions can be compiled for them with function
+// target attributes, without enabling them for the rest of the library.
+// Which variant runs is decided at runtime, so the same build still works
+// on CPUs without these instructions.
 
 #include <stdint.h>
 #include <string.h>
@@ -17,28 +18,55 @@
 
 #if defined(_MSC_VER)
 #include <intrin.h>
-#elif defined(__GNUC__) && defined(__SSE4_2__)
-#include <nmmintrin.h>
+#define LEVELDB_TARGET_SSE42
+#define LEVELDB_TARGET_SSE42_PCLMUL
+#elif defined(__GNUC__)
 #include <cpuid.h>
+#include <immintrin.h>
+#define LEVELDB_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define LEVELDB_TARGET_SSE42_PCLMUL __attribute__((target("sse4.2,pclmul")))
 #endif
 
-#endif  // defined(LEVELDB_PLATFORM_POSIX_SSE)
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+
+// Built for a CPU that always has the CRC32 instructions
+#include <arm_acle.h>
+#define LEVELDB_ARM_CRC32C 1
+#define LEVELDB_TARGET_ARM_CRC
+
+#elif defined(__aarch64__) && defined(__linux__) && defined(__GNUC__) && \
+    !defined(__clang__) && __GNUC__ >= 10
+
+// Optional on ARMv8.0, so look for them at runtime
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#define LEVELDB_ARM_CRC32C 1
+#define LEVELDB_ARM_CRC32C_RUNTIME 1
+#define LEVELDB_TARGET_ARM_CRC __attribute__((target("+crc")))
+
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LEVELDB_HAVE_SIMD_TARGETS 1
+#include <immintrin.h>
+#endif
 
 namespace leveldb {
 namespace port {
 
-#if defined(LEVELDB_PLATFORM_POSIX_SSE)
+#if defined(LEVELDB_PLATFORM_POSIX_SSE) || defined(LEVELDB_ARM_CRC32C)
 
 // Used to fetch a naturally-aligned 32-bit word in little endian byte-order
 static inline uint32_t LE_LOAD32(const uint8_t *p) {
-  // SSE is x86 only, so ensured that |p| is always little-endian.
+  // Only used on x86 and little-endian ARM, so |p| is little-endian.
   uint32_t word;
   memcpy(&word, p, sizeof(word));
   return word;
 }
 
-#if defined(_M_X64) || defined(__x86_64__)  // LE_LOAD64 is only used on x64.
-
 // Used to fetch a naturally-aligned 64-bit word in little endian byte-order
 static inline uint64_t LE_LOAD64(const uint8_t *p) {
   uint64_t dword;
@@ -46,83 +74,274 @@ static inline uint64_t LE_LOAD64(const uint8_t *p) {
   return dword;
 }
 
-#endif  // defined(_M_X64) || defined(__x86_64__)
+#endif  // defined(LEVELDB_PLATFORM_POSIX_SSE) || defined(LEVELDB_ARM_CRC32C)
 
-static inline bool HaveSSE42() {
+#if defined(LEVELDB_PLATFORM_POSIX_SSE)
+
+static inline void CPUID1(unsigned int* ecx) {
 #if defined(_MSC_VER)
   int cpu_info[4];
   __cpuid(cpu_info, 1);
-  return (cpu_info[2] & (1 << 20)) != 0;
-#elif defined(__GNUC__)
-  unsigned int eax, ebx, ecx, edx;
-  __get_cpuid(1, &eax, &ebx, &ecx, &edx);
-  return (ecx & (1 << 20)) != 0;
+  *ecx = static_cast<unsigned int>(cpu_info[2]);
 #else
-  return false;
+  unsigned int eax, ebx, edx;
+  *ecx = 0;
+  __get_cpuid(1, &eax, &ebx, ecx, &edx);
 #endif
 }
 
-#endif  // defined(LEVELDB_PLATFORM_POSIX_SSE)
+static inline bool HaveSSE42() {
+  unsigned int ecx;
+  CPUID1(&ecx);
+  return (ecx & (1 << 20)) != 0;
+}
 
-// For further improvements see Intel publication at:
-// http://download.intel.com/design/intarch/papers/323405.pdf
-uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size) {
-#if !defined(LEVELDB_PLATFORM_POSIX_SSE)
-  return 0;
+static inline bool HavePCLMUL() {
+  unsigned int ecx;
+  CPUID1(&ecx);
+  return (ecx & (1 << 1)) != 0;
+}
+
+// A crc32 instruction has a latency of 3 cycles but a throughput of one per
+// cycle, so a single dependency chain leaves it two thirds idle.  Larger
+// buffers are thus split into three streams of equal length, whose crcs are
+// computed together and then combined.  Combining is cheap but not free, so
+// long streams are used for as much of the buffer as possible, and short
+// ones for what is left.  See the Intel paper "Fast CRC Computation for
+// iSCSI Polynomial Using CRC32 Instruction".
+static const size_t kLongStream = 8192;
+static const size_t kShortStream = 256;
+
+// Returns x^n mod P, bit-reflected like the crc register, where P is the
+// crc32c polynomial.  Only used to compute the constants below, once.
+static uint32_t XPowModP(size_t n) {
+  uint32_t r = 0x80000000u;  // x^0
+  for (; n > 0; n--) {
+    r = (r >> 1) ^ ((r & 1) ? 0x82f63b78u : 0);
+  }
+  return r;
+}
+
+// The crc register for stream bytes A followed by len(B) bytes B is that
+// of A shifted by len(B) bytes, xor that of B started from zero.  Shifting
+// by n bytes is a multiplication by x^(8n) mod P.  Folding the 64 bit
+// carry-less product back to 32 bits with a crc32 instruction multiplies
+// it by x^32 and reduces it, while the product itself is off by one for
+// the reflected operands, hence the constant x^(8n-33).
+struct StreamShift {
+  uint32_t long_shift;
+  uint32_t short_shift;
+
+  StreamShift()
+      : long_shift(XPowModP(8 * kLongStream - 33)),
+        short_shift(XPowModP(8 * kShortStream - 33)) {
+  }
+};
+
+LEVELDB_TARGET_SSE42
+static inline uint32_t CRC32CWord(uint32_t l, const uint8_t* p) {
+#if defined(_M_X64) || defined(__x86_64__)
+  return static_cast<uint32_t>(_mm_crc32_u64(l, LE_LOAD64(p)));
 #else
-  static bool have = HaveSSE42();
-  if (!have) {
-    return 0;
+  // _mm_crc32_u64 is only available on x64.
+  l = _mm_crc32_u32(l, LE_LOAD32(p));
+  return _mm_crc32_u32(l, LE_LOAD32(p + 4));
+#endif
+}
+
+LEVELDB_TARGET_SSE42_PCLMUL
+static inline uint32_t ShiftCRC(uint32_t l, uint32_t shift) {
+  const __m128i product = _mm_clmulepi64_si128(
+      _mm_cvtsi32_si128(static_cast<int>(l)),
+      _mm_cvtsi32_si128(static_cast<int>(shift)), 0);
+  uint8_t folded[8];
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(folded), product);
+  return CRC32CWord(0, folded);
+}
+
+// Processes the 3 * n bytes at p as three streams, n a multiple of 8
+LEVELDB_TARGET_SSE42_PCLMUL
+static inline uint32_t CRC32CStreams(uint32_t l, const uint8_t* p, size_t n,
+                                     uint32_t shift) {
+  uint32_t l1 = 0;
+  uint32_t l2 = 0;
+  for (size_t i = 0; i < n; i += 8) {
+    l = CRC32CWord(l, p + i);
+    l1 = CRC32CWord(l1, p + n + i);
+    l2 = CRC32CWord(l2, p + 2 * n + i);
   }
+  l = ShiftCRC(l, shift) ^ l1;
+  return ShiftCRC(l, shift) ^ l2;
+}
 
-  const uint8_t *p = reinterpret_cast<const uint8_t *>(buf);
-  const uint8_t *e = p + size;
-  uint32_t l = crc ^ 0xffffffffu;
-
-#define STEP1 do {                              \
-    l = _mm_crc32_u8(l, *p++);                  \
-} while (0)
-#define STEP4 do {                              \
-    l = _mm_crc32_u32(l, LE_LOAD32(p));         \
-    p += 4;                                     \
-} while (0)
-#define STEP8 do {                              \
-    l = _mm_crc32_u64(l, LE_LOAD64(p));         \
-    p += 8;                                     \
-} while (0)
-
-  if (size > 16) {
+// Takes and returns the crc register, i.e. the inverted crc
+LEVELDB_TARGET_SSE42
+static uint32_t CRC32CSerial(uint32_t l, const uint8_t* p, const uint8_t* e) {
+  if (e - p > 16) {
     // Process unaligned bytes
-    for (unsigned int i = reinterpret_cast<uintptr_t>(p) % 8; i; --i) {
-      STEP1;
+    for (unsigned int i = (8 - reinterpret_cast<uintptr_t>(p) % 8) % 8;
+         i; --i) {
+      l = _mm_crc32_u8(l, *p++);
     }
-
-    // _mm_crc32_u64 is only available on x64.
-#if defined(_M_X64) || defined(__x86_64__)
     // Process 8 bytes at a time
     while ((e-p) >= 8) {
-      STEP8;
-    }
-    // Process 4 bytes at a time
-    if ((e-p) >= 4) {
-      STEP4;
+      l = CRC32CWord(l, p);
+      p += 8;
     }
-#else  // !(defined(_M_X64) || defined(__x86_64__))
-    // Process 4 bytes at a time
-    while ((e-p) >= 4) {
-      STEP4;
-    }
-#endif  // defined(_M_X64) || defined(__x86_64__)
   }
   // Process the last few bytes
   while (p != e) {
-    STEP1;
+    l = _mm_crc32_u8(l, *p++);
   }
-#undef STEP8
-#undef STEP4
-#undef STEP1
-  return l ^ 0xffffffffu;
+  return l;
+}
+
+LEVELDB_TARGET_SSE42_PCLMUL
+static uint32_t CRC32CInterleaved(uint32_t l, const uint8_t* p,
+                                  const uint8_t* e) {
+  static const StreamShift shifts;
+
+  if (static_cast<size_t>(e - p) >= 3 * kShortStream + 8) {
+    // Process unaligned bytes
+    for (unsigned int i = (8 - reinterpret_cast<uintptr_t>(p) % 8) % 8;
+         i; --i) {
+      l = _mm_crc32_u8(l, *p++);
+    }
+    while (static_cast<size_t>(e - p) >= 3 * kLongStream) {
+      l = CRC32CStreams(l, p, kLongStream, shifts.long_shift);
+      p += 3 * kLongStream;
+    }
+    while (static_cast<size_t>(e - p) >= 3 * kShortStream) {
+      l = CRC32CStreams(l, p, kShortStream, shifts.short_shift);
+      p += 3 * kShortStream;
+    }
+  }
+  return CRC32CSerial(l, p, e);
+}
+
 #endif  // defined(LEVELDB_PLATFORM_POSIX_SSE)
+
+#if defined(LEVELDB_ARM_CRC32C)
+
+static inline bool HaveARMCRC32() {
+#if defined(LEVELDB_ARM_CRC32C_RUNTIME)
+  return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+  return true;
+#endif
+}
+
+LEVELDB_TARGET_ARM_CRC
+static uint32_t CRC32CARM(uint32_t l, const uint8_t* p, const uint8_t* e) {
+  while (p != e && reinterpret_cast<uintptr_t>(p) % 8 != 0) {
+    l = __crc32cb(l, *p++);
+  }
+  while ((e-p) >= 8) {
+    l = __crc32cd(l, LE_LOAD64(p));
+    p += 8;
+  }
+  while (p != e) {
+    l = __crc32cb(l, *p++);
+  }
+  return l;
+}
+
+#endif  // defined(LEVELDB_ARM_CRC32C)
+
+uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size) {
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(buf);
+  const uint8_t *e = p + size;
+#if defined(LEVELDB_PLATFORM_POSIX_SSE)
+  static const bool have_sse42 = HaveSSE42();
+  static const bool have_pclmul = HavePCLMUL();
+  if (!have_sse42) {
+    return 0;
+  }
+  if (have_pclmul) {
+    return CRC32CInterleaved(crc ^ 0xffffffffu, p, e) ^ 0xffffffffu;
+  }
+  return CRC32CSerial(crc ^ 0xffffffffu, p, e) ^ 0xffffffffu;
+#elif defined(LEVELDB_ARM_CRC32C)
+  static const bool have_crc32 = HaveARMCRC32();
+  if (!have_crc32) {
+    return 0;
+  }
+  return CRC32CARM(crc ^ 0xffffffffu, p, e) ^ 0xffffffffu;
+#else
+  (void)p;
+  (void)e;
+  return 0;
+#endif
+}
+
+static size_t CountLessThanScalar(const uint64_t* array, size_t n,
+                                 uint64_t value) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++) {
+    count += (array[i] < value);
+  }
+  return count;
+}
+
+#if defined(LEVELDB_HAVE_SIMD_TARGETS)
+
+// The SIMD comparisons are signed, so flip the sign bit of both operands
+static const int64_t kSignBit = static_cast<int64_t>(1ull << 63);
+
+__attribute__((target("sse4.2,popcnt")))
+static size_t CountLessThanSSE42(const uint64_t* array, size_t n,
+                                 uint64_t value) {
+  const __m128i sign = _mm_set1_epi64x(kSignBit);
+  const __m128i v = _mm_xor_si128(
+      _mm_set1_epi64x(static_cast<int64_t>(value)), sign);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    const __m128i a = _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(array + i)), sign);
+    const __m128i lt = _mm_cmpgt_epi64(v, a);
+    count += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(lt)));
+  }
+  return count + CountLessThanScalar(array + i, n - i, value);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t CountLessThanAVX2(const uint64_t* array, size_t n,
+                                uint64_t value) {
+  const __m256i sign = _mm256_set1_epi64x(kSignBit);
+  const __m256i v = _mm256_xor_si256(
+      _mm256_set1_epi64x(static_cast<int64_t>(value)), sign);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256i a = _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(array + i)), sign);
+    const __m256i lt = _mm256_cmpgt_epi64(v, a);
+    count += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(lt)));
+  }
+  return count + CountLessThanScalar(array + i, n - i, value);
+}
+
+#endif  // defined(LEVELDB_HAVE_SIMD_TARGETS)
+
+typedef size_t (*CountLessThanFunction)(const uint64_t*, size_t, uint64_t);
+
+static CountLessThanFunction ChooseCountLessThan() {
+#if defined(LEVELDB_HAVE_SIMD_TARGETS)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return CountLessThanAVX2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return CountLessThanSSE42;
+  }
+#endif
+  return CountLessThanScalar;
+}
+
+size_t CountLessThan(const uint64_t* array, size_t n, uint64_t value) {
+  static const CountLessThanFunction count_less_than = ChooseCountLessThan();
+  return count_less_than(array, n, value);
 }
 
 }  // namespace port
@@ -6,38 +6,96 @@
 
 #include "table/block.h"
 
+#include <string.h>
 #include <vector>
 #include <algorithm>
+#include "db/dbformat.h"
 #include "leveldb/comparator.h"
+#include "port/port.h"
 #include "table/format.h"
 #include "util/coding.h"
 #include "util/logging.h"
 
 namespace leveldb {
 
-inline uint32_t Block::NumRestarts() const {
-  assert(size_ >= sizeof(uint32_t));
-  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+// Up to this many restart points, Seek() counts the restart points with a
+// smaller key prefix with SIMD instructions rather than binary search.
+static const uint32_t kMaxLinearSearchRestarts = 64;
+
+// Returns the first 8 bytes of p[0,n-1] (padded with zeroes) as a big
+// endian integer, so that comparing the prefixes of two strings gives the
+// same result as comparing the strings, or equality.
+static inline uint64_t KeyPrefix(const char* p, size_t n) {
+  unsigned char buf[8] = { 0 };
+  memcpy(buf, p, n < sizeof(buf) ? n : sizeof(buf));
+  uint64_t result = 0;
+  for (size_t i = 0; i < sizeof(buf); i++) {
+    result = (result << 8) | buf[i];
+  }
+  return result;
+}
+
+// Returns the number of bytes after the user key of the keys that cmp
+// compares, or -1 if cmp does not order the user keys bytewise.
+static int KeyTrailerSize(const Comparator* cmp) {
+  if (cmp == BytewiseComparator()) {
+    return 0;
+  }
+  if (strcmp(cmp->Name(), "leveldb.InternalKeyComparator") == 0 &&
+      static_cast<const InternalKeyComparator*>(cmp)->user_comparator() ==
+          BytewiseComparator()) {
+    return 8;
+  }
+  return -1;
 }
 
-Block::Block(const BlockContents& contents)
+Block::Block(const BlockContents& contents, const Comparator* comparator)
     : data_(contents.data.data()),
       size_(contents.data.size()),
-      owned_(contents.heap_allocated) {
+      restart_offset_(0),
+      num_restarts_(0),
+      hash_buckets_(NULL),
+      num_buckets_(0),
+      owned_(contents.heap_allocated),
+      comparator_(NULL),
+      restart_prefixes_(NULL),
+      key_trailer_(0) {
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
-  } else {
-    size_t max_restarts_allowed = (size_-sizeof(uint32_t)) / sizeof(uint32_t);
-    if (NumRestarts() > max_restarts_allowed) {
-      // The size is too small for NumRestarts()
+    return;
+  }
+
+  uint32_t num_restarts = DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+  size_t limit = size_ - sizeof(uint32_t);  // End of restart array
+  if (num_restarts & kBlockHashIndexFlag) {
+    num_restarts &= ~kBlockHashIndexFlag;
+    const unsigned char* p =
+        reinterpret_cast<const unsigned char*>(data_ + limit);
+    const uint32_t num_buckets = (limit >= 2 ? p[-2] | (p[-1] << 8) : 0);
+    if (num_buckets == 0 || limit < 2 + num_buckets) {
       size_ = 0;
-    } else {
-      restart_offset_ = size_ - (1 + NumRestarts()) * sizeof(uint32_t);
+      return;
+    }
+    limit -= 2 + num_buckets;
+    hash_buckets_ = reinterpret_cast<const uint8_t*>(data_ + limit);
+    num_buckets_ = num_buckets;
+  }
+
+  size_t max_restarts_allowed = limit / sizeof(uint32_t);
+  if (num_restarts > max_restarts_allowed) {
+    // The size is too small for the number of restarts
+    size_ = 0;
+  } else {
+    restart_offset_ = limit - num_restarts * sizeof(uint32_t);
+    num_restarts_ = num_restarts;
+    if (comparator != NULL && num_restarts_ > 1) {
+      InitRestartPrefixes(comparator);
     }
   }
 }
 
 Block::~Block() {
+  delete[] restart_prefixes_;
   if (owned_) {
     delete[] data_;
   }
@@ -79,6 +137,11 @@ class Block::Iter : public Iterator {
   const char* const data_;      // underlying block contents
   uint32_t const restarts_;     // Offset of restart array (list of fixed32)
   uint32_t const num_restarts_; // Number of uint32_t entries in restart array
+  const uint8_t* const hash_buckets_;  // Hash index of user keys, or NULL
+  uint32_t const num_buckets_;
+  const uint64_t* const restart_prefixes_;  // See Block, or NULL
+  size_t const key_trailer_;
+  Slice const common_prefix_;
 
   // current_ is offset in data_ of current entry.  >= restarts_ if !Valid
   uint32_t current_;
@@ -115,11 +178,21 @@ class Block::Iter : public Iterator {
   Iter(const Comparator* comparator,
        const char* data,
        uint32_t restarts,
-       uint32_t num_restarts)
+       uint32_t num_restarts,
+       const uint8_t* hash_buckets,
+       uint32_t num_buckets,
+       const uint64_t* restart_prefixes,
+       size_t key_trailer,
+       const Slice& common_prefix)
       : comparator_(comparator),
         data_(data),
         restarts_(restarts),
         num_restarts_(num_restarts),
+        hash_buckets_(hash_buckets),
+        num_buckets_(num_buckets),
+        restart_prefixes_(restart_prefixes),
+        key_trailer_(key_trailer),
+        common_prefix_(common_prefix),
         current_(restarts_),
         restart_index_(num_restarts_) {
     assert(num_restarts_ > 0);
@@ -163,10 +236,18 @@ class Block::Iter : public Iterator {
   }
 
   virtual void Seek(const Slice& target) {
+    if (num_buckets_ > 0 && target.size() >= 8 && SeekWithHashIndex(target)) {
+      return;
+    }
+
     // Binary search in restart array to find the last restart point
     // with a key < target
     uint32_t left = 0;
     uint32_t right = num_restarts_ - 1;
+    uint64_t prefix = 0;
+    const bool use_prefixes = (restart_prefixes_ != NULL &&
+                               NarrowWithPrefixes(target, &prefix,
+                                                  &left, &right));
     while (left < right) {
       uint32_t mid = (left + right + 1) / 2;
       uint32_t region_offset = GetRestartPoint(mid);
@@ -192,10 +273,22 @@ class Block::Iter : public Iterator {
 
     // Linear search (within restart block) for first key >= target
     SeekToRestartPoint(left);
+    const size_t min_key_size = key_trailer_ + common_prefix_.size();
     while (true) {
       if (!ParseNextKey()) {
         return;
       }
+      if (use_prefixes && key_.size() >= min_key_size) {
+        // Only keys with the same prefix as target need the comparator
+        const uint64_t key_prefix =
+            KeyPrefix(key_.data() + common_prefix_.size(),
+                      key_.size() - min_key_size);
+        if (key_prefix < prefix) {
+          continue;
+        } else if (key_prefix > prefix) {
+          return;
+        }
+      }
       if (Compare(key_, target) >= 0) {
         return;
       }
@@ -215,6 +308,82 @@ class Block::Iter : public Iterator {
   }
 
  private:
+  // Narrow [*left, *right] down to the restart points that the binary
+  // search needs to compare target with: the restart points with the same
+  // key prefix as target, and the one before them.  Returns false if target
+  // has no prefix to compare, in which case *prefix is not set.
+  bool NarrowWithPrefixes(const Slice& target, uint64_t* prefix,
+                          uint32_t* left, uint32_t* right) const {
+    if (target.size() < key_trailer_) {
+      return false;
+    }
+    const Slice user_key(target.data(), target.size() - key_trailer_);
+    const size_t n = std::min(user_key.size(), common_prefix_.size());
+    int r = memcmp(user_key.data(), common_prefix_.data(), n);
+    if (r == 0 && user_key.size() < common_prefix_.size()) {
+      r = -1;
+    }
+    if (r != 0) {
+      // Target is smaller or larger than all keys in the block
+      *left = *right = (r < 0 ? 0 : num_restarts_ - 1);
+      return false;
+    }
+
+    *prefix = KeyPrefix(user_key.data() + n, user_key.size() - n);
+    uint32_t less, less_or_equal;
+    if (num_restarts_ <= kMaxLinearSearchRestarts) {
+      less = port::CountLessThan(restart_prefixes_, num_restarts_, *prefix);
+      less_or_equal = (*prefix == ~static_cast<uint64_t>(0) ? num_restarts_ :
+          port::CountLessThan(restart_prefixes_, num_restarts_, *prefix + 1));
+    } else {
+      const uint64_t* end = restart_prefixes_ + num_restarts_;
+      less = std::lower_bound(restart_prefixes_, end, *prefix) -
+             restart_prefixes_;
+      less_or_equal = std::upper_bound(restart_prefixes_ + less, end,
+                                       *prefix) - restart_prefixes_;
+    }
+    *left = (less > 0 ? less - 1 : 0);
+    *right = (less_or_equal > 0 ? less_or_equal - 1 : 0);
+    return true;
+  }
+
+  // Look up the restart interval of the user key of target in the hash
+  // index.  If the user key is in this block, it is only in that interval
+  // (or the bucket would be marked as a collision), so entries before its
+  // first entry have smaller user keys and are smaller than target, which
+  // saves comparing them, and the scan can stop at the end of the interval
+  // if the user key is not found.  Returns false if the caller should fall
+  // back to a binary search, because the user key is not in this block or
+  // shares its hash with a key in another interval.
+  bool SeekWithHashIndex(const Slice& target) {
+    const Slice user_key(target.data(), target.size() - 8);
+    const uint8_t restart_index =
+        hash_buckets_[BlockHashIndexHash(user_key) % num_buckets_];
+    if (restart_index >= num_restarts_) {
+      // Empty, a collision or corrupt
+      return false;
+    }
+
+    SeekToRestartPoint(restart_index);
+    bool seen = false;
+    while (ParseNextKey()) {
+      if (key_.size() >= 8 &&
+          Slice(key_.data(), key_.size() - 8) == user_key) {
+        // Versions are ordered from newest to oldest
+        seen = true;
+        if (Compare(key_, target) >= 0) {
+          return true;
+        }
+      } else if (seen) {
+        // All versions of user_key are newer than target
+        return true;
+      } else if (restart_index_ != restart_index) {
+        return false;
+      }
+    }
+    return seen || !status_.ok();
+  }
+
   void CorruptionError() {
     current_ = restarts_;
     restart_index_ = num_restarts_;
@@ -253,16 +422,76 @@ class Block::Iter : public Iterator {
   }
 };
 
-Iterator* Block::NewIterator(const Comparator* cmp) {
+Iterator* Block::NewIterator(const Comparator* cmp, bool point_lookups) {
   if (size_ < sizeof(uint32_t)) {
     return NewErrorIterator(Status::Corruption("bad block contents"));
   }
-  const uint32_t num_restarts = NumRestarts();
-  if (num_restarts == 0) {
+  if (num_restarts_ == 0) {
     return NewEmptyIterator();
   } else {
-    return new Iter(cmp, data_, restart_offset_, num_restarts);
+    const bool use_prefixes = (cmp == comparator_);
+    return new Iter(cmp, data_, restart_offset_, num_restarts_,
+                    point_lookups ? hash_buckets_ : NULL,
+                    point_lookups ? num_buckets_ : 0,
+                    use_prefixes ? restart_prefixes_ : NULL,
+                    key_trailer_, common_prefix_);
+  }
+}
+
+// All keys in the block share the leading bytes that the user keys of its
+// first and last key have in common.  Store the next 8 bytes of the user
+// key at each restart point, which usually tell restart points apart even
+// if keys share a long prefix, so that Seek() can compare them as integers
+// instead of decoding the restart points and calling the comparator.
+void Block::InitRestartPrefixes(const Comparator* comparator) {
+  const int key_trailer = KeyTrailerSize(comparator);
+  if (key_trailer < 0) {
+    return;
+  }
+
+  // Keys at restart points are stored in full
+  std::vector<Slice> keys(num_restarts_);
+  for (uint32_t i = 0; i < num_restarts_; i++) {
+    const uint32_t offset =
+        DecodeFixed32(data_ + restart_offset_ + i * sizeof(uint32_t));
+    uint32_t shared, non_shared, value_length;
+    const char* key_ptr = (offset < restart_offset_ ?
+        DecodeEntry(data_ + offset, data_ + restart_offset_,
+                    &shared, &non_shared, &value_length) : NULL);
+    if (key_ptr == NULL || shared != 0 || non_shared < key_trailer) {
+      // Corrupt, leave it to the iterators to report
+      return;
+    }
+    keys[i] = Slice(key_ptr, non_shared - key_trailer);
+  }
+
+  Iter iter(comparator, data_, restart_offset_, num_restarts_,
+            NULL, 0, NULL, 0, Slice());
+  iter.SeekToLast();
+  if (!iter.Valid() || iter.key().size() < static_cast<size_t>(key_trailer)) {
+    return;
+  }
+  const Slice first = keys[0];
+  const Slice last(iter.key().data(), iter.key().size() - key_trailer);
+  size_t common = 0;
+  while (common < first.size() && common < last.size() &&
+         first[common] == last[common]) {
+    common++;
+  }
+
+  uint64_t* prefixes = new uint64_t[num_restarts_];
+  for (uint32_t i = 0; i < num_restarts_; i++) {
+    if (!keys[i].starts_with(Slice(first.data(), common))) {
+      // Out of order
+      delete[] prefixes;
+      return;
+    }
+    prefixes[i] = KeyPrefix(keys[i].data() + common, keys[i].size() - common);
   }
+  restart_prefixes_ = prefixes;
+  comparator_ = comparator;
+  key_trailer_ = key_trailer;
+  common_prefix_ = Slice(first.data(), common);
 }
 
 }  // namespace leveldb
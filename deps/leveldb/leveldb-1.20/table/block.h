@@ -8,6 +8,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "leveldb/iterator.h"
+#include "leveldb/slice.h"
 
 namespace leveldb {
 
@@ -16,22 +17,48 @@ class Comparator;
 
 class Block {
  public:
-  // Initialize the block with the specified contents.
-  explicit Block(const BlockContents& contents);
+  // Initialize the block with the specified contents.  If comparator is
+  // non-NULL and orders keys bytewise, the block also keeps a fixed-width
+  // prefix of the key at each restart point, which iterators created with
+  // the same comparator use to speed up Seek().  Building them takes a pass
+  // over the restart points, so it is only worth it for blocks that are
+  // kept around, like cached ones.
+  explicit Block(const BlockContents& contents,
+                 const Comparator* comparator = NULL);
 
   ~Block();
 
   size_t size() const { return size_; }
-  Iterator* NewIterator(const Comparator* comparator);
 
- private:
-  uint32_t NumRestarts() const;
+  // Memory charged to the block cache: the contents plus the restart point
+  // prefixes, if any.
+  size_t charge() const {
+    return size_ + (restart_prefixes_ != NULL ?
+                    num_restarts_ * sizeof(uint64_t) : 0);
+  }
+  // If point_lookups is true, Seek() first looks up the user key of the
+  // target in the hash index of the block, if any, which is only faster if
+  // the user key is likely to be in the block, like in Table::InternalGet().
+  Iterator* NewIterator(const Comparator* comparator,
+                        bool point_lookups = false);
 
+ private:
   const char* data_;
   size_t size_;
   uint32_t restart_offset_;     // Offset in data_ of restart array
+  uint32_t num_restarts_;
+  const uint8_t* hash_buckets_; // Hash index of user keys, or NULL
+  uint32_t num_buckets_;
   bool owned_;                  // Block owns data_[]
 
+  // Restart point key prefixes, see InitRestartPrefixes()
+  const Comparator* comparator_;
+  uint64_t* restart_prefixes_;  // Or NULL
+  size_t key_trailer_;          // Bytes after the user key of each key
+  Slice common_prefix_;         // Leading user key bytes shared by all keys
+
+  void InitRestartPrefixes(const Comparator* comparator);
+
   // No copying allowed
   Block(const Block&);
   void operator=(const Block&);
@@ -0,0 +1,249 @@
+// Microbenchmark of block iterators.  Builds data blocks of internal keys
+// of various sizes and restart intervals, and reports the cost of seeking
+// to a present key in a block without restart point prefixes (plain), with
+// them (prefix) and with them plus a hash index (hash).  Then reports the
+// cost per entry of scanning the blocks forward and backward, and that of
+// scanning a DecodedBlock of them.  Not part of the library; build with
+// e.g.:
+//
+//   c++ -O2 -std=c++11 -DLEVELDB_PLATFORM_POSIX -I. -Iinclude \
+//     table/block_bench.cc table/block.cc table/block_builder.cc \
+//     table/decoded_block.cc table/format.cc table/iterator.cc \
+//     db/dbformat.cc util/comparator.cc util/coding.cc util/compressor.cc \
+//     util/crc32c.cc util/filter_policy.cc util/hash.cc util/logging.cc \
+//     util/options.cc util/env.cc util/env_posix.cc util/status.cc \
+//     port/port_posix.cc port/port_posix_sse.cc -lpthread -o block_bench
+//
+// Flags:
+//   --seeks=N          Number of seeks, or of entries scanned, per
+//                      measurement (default 1000000)
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "db/dbformat.h"
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "table/decoded_block.h"
+#include "table/format.h"
+#include "util/hash.h"
+
+namespace leveldb {
+
+namespace {
+
+static int FLAGS_seeks = 1000000;
+
+static std::string UserKey(int i, bool prefixed) {
+  char buf[32];
+  if (prefixed) {
+    snprintf(buf, sizeof(buf), "user:profile:%08d", i);
+  } else {
+    // Sorted, but with little in common between neighbours
+    snprintf(buf, sizeof(buf), "%08x%08x", static_cast<uint32_t>(i) * 40503u,
+             Hash(reinterpret_cast<const char*>(&i), sizeof(i), 0));
+  }
+  return buf;
+}
+
+static double NowNanos() {
+  return static_cast<double>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Returns the number of seeks that found their key, which also prevents the
+// compiler from optimizing the seeks away
+static int Measure(Block* block, const Comparator* cmp,
+                   const std::vector<LookupKey*>& targets, double* nanos) {
+  Iterator* iter = block->NewIterator(cmp, true);
+  int found = 0;
+  const double start = NowNanos();
+  for (int i = 0; i < FLAGS_seeks; i++) {
+    const LookupKey* target = targets[i % targets.size()];
+    iter->Seek(target->internal_key());
+    if (iter->Valid() &&
+        ExtractUserKey(iter->key()) == target->user_key()) {
+      found++;
+    }
+  }
+  *nanos = (NowNanos() - start) / FLAGS_seeks;
+  delete iter;
+  return found;
+}
+
+// Returns the number of entries visited
+static int MeasureScan(Iterator* iter, bool reverse, double* nanos) {
+  int entries = 0;
+  size_t bytes = 0;
+  const double start = NowNanos();
+  while (entries < FLAGS_seeks) {
+    if (reverse) {
+      for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+        bytes += iter->key().size();
+        entries++;
+      }
+    } else {
+      for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        bytes += iter->key().size();
+        entries++;
+      }
+    }
+  }
+  *nanos = (NowNanos() - start) / entries;
+  delete iter;
+  return bytes > 0 ? entries : 0;
+}
+
+static void BuildBlock(size_t block_size, int restart_interval,
+                       bool prefixed, bool hash_index,
+                       std::vector<std::string>* user_keys,
+                       std::string* contents) {
+  const InternalKeyComparator cmp(BytewiseComparator());
+  Options options;
+  options.comparator = &cmp;
+  options.block_restart_interval = restart_interval;
+  BlockBuilder builder(&options, hash_index);
+
+  const std::string value(32, 'v');
+  user_keys->clear();
+  for (int i = 0; builder.CurrentSizeEstimate() < block_size; i++) {
+    std::string key;
+    user_keys->push_back(UserKey(i, prefixed));
+    AppendInternalKey(&key,
+                      ParsedInternalKey(user_keys->back(), 100, kTypeValue));
+    builder.Add(key, value);
+  }
+  *contents = builder.Finish().ToString();
+}
+
+static void RunSeek(size_t block_size, int restart_interval, bool prefixed) {
+  const InternalKeyComparator cmp(BytewiseComparator());
+  std::vector<std::string> user_keys;
+  std::string plain_data, hash_data;
+  BuildBlock(block_size, restart_interval, prefixed, false,
+             &user_keys, &plain_data);
+  BuildBlock(block_size, restart_interval, prefixed, true,
+             &user_keys, &hash_data);
+
+  BlockContents plain_contents;
+  plain_contents.data = plain_data;
+  plain_contents.cachable = false;
+  plain_contents.heap_allocated = false;
+  BlockContents hash_contents;
+  hash_contents.data = hash_data;
+  hash_contents.cachable = false;
+  hash_contents.heap_allocated = false;
+
+  Block plain_block(plain_contents);
+  Block prefix_block(plain_contents, &cmp);
+  Block hash_block(hash_contents, &cmp);
+
+  // Visit the keys in a scattered order
+  std::vector<LookupKey*> targets;
+  for (size_t i = 0; i < user_keys.size(); i++) {
+    const size_t k = (i * 7919) % user_keys.size();
+    targets.push_back(new LookupKey(user_keys[k], kMaxSequenceNumber));
+  }
+
+  double plain_nanos, prefix_nanos, hash_nanos;
+  const int found = Measure(&plain_block, &cmp, targets, &plain_nanos) +
+                    Measure(&prefix_block, &cmp, targets, &prefix_nanos) +
+                    Measure(&hash_block, &cmp, targets, &hash_nanos);
+  if (found != 3 * FLAGS_seeks) {
+    fprintf(stderr, "Seek() missed a key!\n");
+    exit(1);
+  }
+
+  fprintf(stdout, "%-9s %10d %8d %8d %9.1f %9.1f %9.1f\n",
+          prefixed ? "prefixed" : "random",
+          static_cast<int>(block_size), restart_interval,
+          static_cast<int>(user_keys.size()),
+          plain_nanos, prefix_nanos, hash_nanos);
+
+  for (size_t i = 0; i < targets.size(); i++) {
+    delete targets[i];
+  }
+}
+
+static void RunScan(size_t block_size, int restart_interval, bool prefixed) {
+  const InternalKeyComparator cmp(BytewiseComparator());
+  std::vector<std::string> user_keys;
+  std::string data;
+  BuildBlock(block_size, restart_interval, prefixed, false, &user_keys, &data);
+
+  BlockContents contents;
+  contents.data = data;
+  contents.cachable = false;
+  contents.heap_allocated = false;
+  Block block(contents, &cmp);
+  DecodedBlock* decoded = DecodedBlock::Decode(&block, &cmp);
+
+  double next_nanos, prev_nanos, decoded_next_nanos, decoded_prev_nanos;
+  if (MeasureScan(block.NewIterator(&cmp), false, &next_nanos) == 0 ||
+      MeasureScan(block.NewIterator(&cmp), true, &prev_nanos) == 0 ||
+      MeasureScan(decoded->NewIterator(&cmp), false,
+                  &decoded_next_nanos) == 0 ||
+      MeasureScan(decoded->NewIterator(&cmp), true,
+                  &decoded_prev_nanos) == 0) {
+    fprintf(stderr, "Empty block!\n");
+    exit(1);
+  }
+
+  fprintf(stdout, "%-9s %10d %8d %8d %9.1f %9.1f %9.1f %9.1f %9d\n",
+          prefixed ? "prefixed" : "random",
+          static_cast<int>(block_size), restart_interval,
+          static_cast<int>(user_keys.size()),
+          next_nanos, prev_nanos, decoded_next_nanos, decoded_prev_nanos,
+          static_cast<int>(decoded->charge()));
+
+  delete decoded;
+}
+
+}  // namespace
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    int n;
+    char junk;
+    if (sscanf(argv[i], "--seeks=%d%c", &n, &junk) == 1 && n > 0) {
+      leveldb::FLAGS_seeks = n;
+    } else {
+      fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+      exit(1);
+    }
+  }
+
+  const size_t block_sizes[] = { 4096, 65536 };
+  const int restart_intervals[] = { 16, 4, 1 };
+
+  fprintf(stdout, "Seek\n%-9s %10s %8s %8s %9s %9s %9s\n",
+          "Keys", "Block size", "Interval", "Entries",
+          "Plain ns", "Prefix ns", "Hash ns");
+  for (int prefixed = 0; prefixed <= 1; prefixed++) {
+    for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++) {
+      for (size_t r = 0;
+           r < sizeof(restart_intervals) / sizeof(restart_intervals[0]); r++) {
+        leveldb::RunSeek(block_sizes[b], restart_intervals[r], prefixed != 0);
+      }
+    }
+  }
+
+  fprintf(stdout, "\nScan, per entry\n%-9s %10s %8s %8s %9s %9s %9s %9s %9s\n",
+          "Keys", "Block size", "Interval", "Entries", "Next ns", "Prev ns",
+          "Dec. Next", "Dec. Prev", "Dec. size");
+  for (int prefixed = 0; prefixed <= 1; prefixed++) {
+    for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++) {
+      leveldb::RunScan(block_sizes[b], 16, prefixed != 0);
+    }
+  }
+
+  return 0;
+}
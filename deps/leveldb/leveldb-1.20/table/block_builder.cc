@@ -32,15 +32,18 @@
 #include <assert.h>
 #include "leveldb/comparator.h"
 #include "leveldb/table_builder.h"
+#include "table/format.h"
 #include "util/coding.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
-BlockBuilder::BlockBuilder(const Options* options)
+BlockBuilder::BlockBuilder(const Options* options, bool hash_index)
     : options_(options),
       restarts_(),
       counter_(0),
-      finished_(false) {
+      finished_(false),
+      hash_index_(hash_index) {
   assert(options->block_restart_interval >= 1);
   restarts_.push_back(0);       // First restart point is at offset 0
 }
@@ -52,11 +55,25 @@ void BlockBuilder::Reset() {
   counter_ = 0;
   finished_ = false;
   last_key_.clear();
+  hash_entries_.clear();
+}
+
+// Returns the number of buckets of the hash index, or 0 if the block gets
+// none.  Aims for a load factor of 0.75.
+size_t BlockBuilder::NumHashBuckets() const {
+  if (!hash_index_ || hash_entries_.empty() ||
+      restarts_.size() > kBlockHashIndexMaxRestarts) {
+    return 0;
+  }
+  return std::min<size_t>(hash_entries_.size() * 4 / 3 + 1,
+                          kBlockHashIndexMaxBuckets);
 }
 
 size_t BlockBuilder::CurrentSizeEstimate() const {
+  const size_t num_buckets = NumHashBuckets();
   return (buffer_.size() +                        // Raw data buffer
           restarts_.size() * sizeof(uint32_t) +   // Restart array
+          (num_buckets > 0 ? num_buckets + 2 : 0) + // Hash index
           sizeof(uint32_t));                      // Restart array length
 }
 
@@ -65,7 +82,28 @@ Slice BlockBuilder::Finish() {
   for (size_t i = 0; i < restarts_.size(); i++) {
     PutFixed32(&buffer_, restarts_[i]);
   }
-  PutFixed32(&buffer_, restarts_.size());
+
+  // Append hash index
+  uint32_t num_restarts = restarts_.size();
+  const size_t num_buckets = NumHashBuckets();
+  if (num_buckets > 0) {
+    std::string buckets(num_buckets, static_cast<char>(kBlockHashIndexEmpty));
+    for (size_t i = 0; i < hash_entries_.size(); i++) {
+      char* bucket = &buckets[hash_entries_[i].first % num_buckets];
+      const uint8_t restart_index = hash_entries_[i].second;
+      if (static_cast<uint8_t>(*bucket) == kBlockHashIndexEmpty) {
+        *bucket = static_cast<char>(restart_index);
+      } else if (static_cast<uint8_t>(*bucket) != restart_index) {
+        *bucket = static_cast<char>(kBlockHashIndexCollision);
+      }
+    }
+    buffer_.append(buckets);
+    buffer_.push_back(static_cast<char>(num_buckets & 0xff));
+    buffer_.push_back(static_cast<char>(num_buckets >> 8));
+    num_restarts |= kBlockHashIndexFlag;
+  }
+
+  PutFixed32(&buffer_, num_restarts);
   finished_ = true;
   return Slice(buffer_);
 }
@@ -90,6 +128,13 @@ void BlockBuilder::Add(const Slice& key, const Slice& value) {
   }
   const size_t non_shared = key.size() - shared;
 
+  if (hash_index_ && restarts_.size() <= kBlockHashIndexMaxRestarts) {
+    assert(key.size() >= 8);
+    hash_entries_.push_back(std::make_pair(
+        BlockHashIndexHash(Slice(key.data(), key.size() - 8)),
+        static_cast<uint8_t>(restarts_.size() - 1)));
+  }
+
   // Add "<shared><non_shared><value_size>" to buffer_
   PutVarint32(&buffer_, shared);
   PutVarint32(&buffer_, non_shared);
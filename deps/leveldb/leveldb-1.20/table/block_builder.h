@@ -16,7 +16,9 @@ struct Options;
 
 class BlockBuilder {
  public:
-  explicit BlockBuilder(const Options* options);
+  // If hash_index is true, the block gets a hash index of the user keys of
+  // its entries, which must be internal keys.
+  explicit BlockBuilder(const Options* options, bool hash_index = false);
 
   // Reset the contents as if the BlockBuilder was just constructed.
   void Reset();
@@ -46,6 +48,11 @@ class BlockBuilder {
   int                   counter_;     // Number of entries emitted since restart
   bool                  finished_;    // Has Finish() been called?
   std::string           last_key_;
+  const bool            hash_index_;
+  // Hash of the user key and restart index of each entry
+  std::vector<std::pair<uint32_t, uint8_t> > hash_entries_;
+
+  size_t NumHashBuckets() const;
 
   // No copying allowed
   BlockBuilder(const BlockBuilder&);
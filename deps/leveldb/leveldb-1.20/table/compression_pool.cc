@@ -0,0 +1,59 @@
+#include "table/compression_pool.h"
+
+#include "leveldb/env.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+static port::OnceType once = LEVELDB_ONCE_INIT;
+static CompressionPool* shared_pool;
+
+CompressionPool::CompressionPool() : cv_(&mu_), threads_(0) { }
+
+CompressionPool::~CompressionPool() { }
+
+void CompressionPool::InitShared() {
+  // Never deleted, since its threads are never stopped
+  shared_pool = new CompressionPool;
+}
+
+CompressionPool* CompressionPool::Shared(Env* env, int threads) {
+  port::InitOnce(&once, &CompressionPool::InitShared);
+  CompressionPool* pool = shared_pool;
+  MutexLock l(&pool->mu_);
+  while (pool->threads_ < threads) {
+    env->StartThread(&CompressionPool::BGThread, pool);
+    pool->threads_++;
+  }
+  return pool;
+}
+
+void CompressionPool::Schedule(void (*function)(void*), void* arg) {
+  MutexLock l(&mu_);
+  Job job;
+  job.function = function;
+  job.arg = arg;
+  queue_.push_back(job);
+  cv_.Signal();
+}
+
+void CompressionPool::BGThread(void* arg) {
+  reinterpret_cast<CompressionPool*>(arg)->Run();
+}
+
+void CompressionPool::Run() {
+  while (true) {
+    Job job;
+    {
+      MutexLock l(&mu_);
+      while (queue_.empty()) {
+        cv_.Wait();
+      }
+      job = queue_.front();
+      queue_.pop_front();
+    }
+    (*job.function)(job.arg);
+  }
+}
+
+}  // namespace leveldb
@@ -0,0 +1,54 @@
+// Threads that compress the data blocks of tables being built with
+// Options::compression_threads > 0, so that a slow compressor does not
+// limit the throughput of flushes and compactions.  A single pool is
+// shared by all TableBuilders in the process, and grows to the largest
+// number of threads that any of them asks for.  Its threads are never
+// stopped.
+//
+// Thread-safe.
+
+#ifndef STORAGE_LEVELDB_TABLE_COMPRESSION_POOL_H_
+#define STORAGE_LEVELDB_TABLE_COMPRESSION_POOL_H_
+
+#include <deque>
+#include "port/port.h"
+
+namespace leveldb {
+
+class Env;
+
+class CompressionPool {
+ public:
+  // Return the shared pool, after starting threads with env until it has
+  // at least the given number of them.
+  static CompressionPool* Shared(Env* env, int threads);
+
+  // Run (*function)(arg) in one of the threads of the pool.
+  void Schedule(void (*function)(void*), void* arg);
+
+ private:
+  CompressionPool();
+  ~CompressionPool();
+
+  static void InitShared();
+  static void BGThread(void* arg);
+  void Run();
+
+  struct Job {
+    void (*function)(void*);
+    void* arg;
+  };
+
+  port::Mutex mu_;
+  port::CondVar cv_;
+  std::deque<Job> queue_;
+  int threads_;
+
+  // No copying allowed
+  CompressionPool(const CompressionPool&);
+  void operator=(const CompressionPool&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_TABLE_COMPRESSION_POOL_H_
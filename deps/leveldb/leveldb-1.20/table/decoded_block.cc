@@ -0,0 +1,132 @@
+#include "table/decoded_block.h"
+
+#include <assert.h>
+#include <string.h>
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "table/block.h"
+
+namespace leveldb {
+
+DecodedBlock::DecodedBlock(char* data, size_t size, uint32_t num_entries)
+    : entries_(reinterpret_cast<const Entry*>(data)),
+      num_entries_(num_entries),
+      data_(data),
+      size_(size) {
+}
+
+DecodedBlock::~DecodedBlock() {
+  delete[] data_;
+}
+
+DecodedBlock* DecodedBlock::Decode(Block* block,
+                                   const Comparator* comparator) {
+  Iterator* iter = block->NewIterator(comparator);
+
+  // Size the allocation, then fill it in
+  size_t num_entries = 0;
+  size_t bytes = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    num_entries++;
+    bytes += iter->key().size() + iter->value().size();
+  }
+  const size_t size = num_entries * sizeof(Entry) + bytes;
+  if (!iter->status().ok() || size > 0xffffffffu) {
+    delete iter;
+    return NULL;
+  }
+
+  char* data = new char[size];
+  Entry* entries = reinterpret_cast<Entry*>(data);
+  uint32_t offset = num_entries * sizeof(Entry);
+  Entry* entry = entries;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    const Slice key = iter->key();
+    const Slice value = iter->value();
+    entry->offset = offset;
+    entry->key_size = key.size();
+    entry->value_size = value.size();
+    memcpy(data + offset, key.data(), key.size());
+    memcpy(data + offset + key.size(), value.data(), value.size());
+    offset += key.size() + value.size();
+    entry++;
+  }
+  delete iter;
+
+  return new DecodedBlock(data, size, num_entries);
+}
+
+class DecodedBlock::Iter : public Iterator {
+ private:
+  const Comparator* const comparator_;
+  const char* const data_;
+  const Entry* const entries_;
+  uint32_t const num_entries_;
+  uint32_t current_;  // Index of the current entry, num_entries_ if !Valid
+
+  Slice KeyAt(uint32_t index) const {
+    const Entry& entry = entries_[index];
+    return Slice(data_ + entry.offset, entry.key_size);
+  }
+
+ public:
+  Iter(const Comparator* comparator, const char* data,
+       const Entry* entries, uint32_t num_entries)
+      : comparator_(comparator),
+        data_(data),
+        entries_(entries),
+        num_entries_(num_entries),
+        current_(num_entries) {
+  }
+
+  virtual bool Valid() const { return current_ < num_entries_; }
+  virtual Status status() const { return Status::OK(); }
+  virtual Slice key() const {
+    assert(Valid());
+    return KeyAt(current_);
+  }
+  virtual Slice value() const {
+    assert(Valid());
+    const Entry& entry = entries_[current_];
+    return Slice(data_ + entry.offset + entry.key_size, entry.value_size);
+  }
+
+  virtual void Next() {
+    assert(Valid());
+    current_++;
+  }
+
+  virtual void Prev() {
+    assert(Valid());
+    current_ = (current_ == 0 ? num_entries_ : current_ - 1);
+  }
+
+  virtual void Seek(const Slice& target) {
+    // Binary search for the first key >= target
+    uint32_t left = 0;
+    uint32_t right = num_entries_;
+    while (left < right) {
+      const uint32_t mid = left + (right - left) / 2;
+      if (comparator_->Compare(KeyAt(mid), target) < 0) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    current_ = left;
+  }
+
+  virtual void SeekToFirst() {
+    current_ = 0;
+  }
+
+  virtual void SeekToLast() {
+    current_ = (num_entries_ > 0 ? num_entries_ - 1 : 0);
+  }
+};
+
+Iterator* DecodedBlock::NewIterator(const Comparator* comparator) {
+  return new Iter(comparator, data_, entries_, num_entries_);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,55 @@
+// A decoded block holds the entries of a Block with their keys fully
+// materialized, in a single allocation that starts with an array of
+// entry offsets.  Iterating over it is a matter of stepping through that
+// array, where iterating over a Block decodes each entry and rebuilds its
+// key from the previous one, and Prev() rescans from a restart point.
+
+#ifndef STORAGE_LEVELDB_TABLE_DECODED_BLOCK_H_
+#define STORAGE_LEVELDB_TABLE_DECODED_BLOCK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace leveldb {
+
+class Block;
+class Comparator;
+class Iterator;
+
+class DecodedBlock {
+ public:
+  // Decode all entries of block.  Returns NULL if the block is corrupt,
+  // in which case the caller should iterate over block to find out why.
+  static DecodedBlock* Decode(Block* block, const Comparator* comparator);
+
+  ~DecodedBlock();
+
+  // Memory charged to the block cache
+  size_t charge() const { return sizeof(DecodedBlock) + size_; }
+
+  Iterator* NewIterator(const Comparator* comparator);
+
+ private:
+  struct Entry {
+    uint32_t offset;      // Offset in data_ of the key, followed by the value
+    uint32_t key_size;
+    uint32_t value_size;
+  };
+
+  const Entry* entries_;  // Array at the start of data_
+  uint32_t num_entries_;
+  char* data_;
+  size_t size_;
+
+  DecodedBlock(char* data, size_t size, uint32_t num_entries);
+
+  // No copying allowed
+  DecodedBlock(const DecodedBlock&);
+  void operator=(const DecodedBlock&);
+
+  class Iter;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_TABLE_DECODED_BLOCK_H_
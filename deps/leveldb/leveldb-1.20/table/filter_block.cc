@@ -15,11 +15,14 @@ namespace leveldb {
 static const size_t kFilterBaseLg = 11;
 static const size_t kFilterBase = 1 << kFilterBaseLg;
 
-FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy)
-    : policy_(policy) {
+FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy,
+                                       bool whole_table)
+    : policy_(policy),
+      whole_table_(whole_table) {
 }
 
 void FilterBlockBuilder::StartBlock(uint64_t block_offset) {
+  if (whole_table_) return;
   uint64_t filter_index = (block_offset / kFilterBase);
   assert(filter_index >= filter_offsets_.size());
   while (filter_index > filter_offsets_.size()) {
@@ -38,6 +41,11 @@ Slice FilterBlockBuilder::Finish() {
     GenerateFilter();
   }
 
+  if (whole_table_) {
+    // The single filter is the whole block
+    return Slice(result_);
+  }
+
   // Append array of per-filter offsets
   const uint32_t array_offset = result_.size();
   for (size_t i = 0; i < filter_offsets_.size(); i++) {
@@ -76,12 +84,16 @@ void FilterBlockBuilder::GenerateFilter() {
 }
 
 FilterBlockReader::FilterBlockReader(const FilterPolicy* policy,
-                                     const Slice& contents)
+                                     const Slice& contents,
+                                     bool whole_table)
     : policy_(policy),
+      whole_table_(whole_table),
+      contents_(contents),
       data_(NULL),
       offset_(NULL),
       num_(0),
       base_lg_(0) {
+  if (whole_table) return;
   size_t n = contents.size();
   if (n < 5) return;  // 1 byte for base_lg_ and 4 for start of offset array
   base_lg_ = contents[n-1];
@@ -93,6 +105,10 @@ FilterBlockReader::FilterBlockReader(const FilterPolicy* policy,
 }
 
 bool FilterBlockReader::KeyMayMatch(uint64_t block_offset, const Slice& key) {
+  if (whole_table_) {
+    return policy_->KeyMayMatch(key, contents_);
+  }
+
   uint64_t index = block_offset >> base_lg_;
   if (index < num_) {
     uint32_t start = DecodeFixed32(offset_ + index*4);
@@ -22,13 +22,15 @@ class FilterPolicy;
 
 // A FilterBlockBuilder is used to construct all of the filters for a
 // particular Table.  It generates a single string which is stored as
-// a special block in the Table.
+// a special block in the Table.  If whole_table is true, that string is
+// a single filter for all keys of the Table rather than a sequence of
+// filters for ranges of data blocks.
 //
 // The sequence of calls to FilterBlockBuilder must match the regexp:
 //      (StartBlock AddKey*)* Finish
 class FilterBlockBuilder {
  public:
-  explicit FilterBlockBuilder(const FilterPolicy*);
+  FilterBlockBuilder(const FilterPolicy*, bool whole_table);
 
   void StartBlock(uint64_t block_offset);
   void AddKey(const Slice& key);
@@ -38,6 +40,7 @@ class FilterBlockBuilder {
   void GenerateFilter();
 
   const FilterPolicy* policy_;
+  const bool whole_table_;
   std::string keys_;              // Flattened key contents
   std::vector<size_t> start_;     // Starting index in keys_ of each key
   std::string result_;            // Filter data computed so far
@@ -52,11 +55,18 @@ class FilterBlockBuilder {
 class FilterBlockReader {
  public:
  // REQUIRES: "contents" and *policy must stay live while *this is live.
-  FilterBlockReader(const FilterPolicy* policy, const Slice& contents);
+  FilterBlockReader(const FilterPolicy* policy, const Slice& contents,
+                    bool whole_table);
   bool KeyMayMatch(uint64_t block_offset, const Slice& key);
 
+  // True if the block holds a single filter for the whole table, in which
+  // case block_offset is ignored by KeyMayMatch().
+  bool whole_table() const { return whole_table_; }
+
  private:
   const FilterPolicy* policy_;
+  const bool whole_table_;
+  Slice contents_;      // Whole-table filter
   const char* data_;    // Pointer to filter data (at block-start)
   const char* offset_;  // Pointer to beginning of offset array (at block-end)
   size_t num_;          // Number of entries in offset array
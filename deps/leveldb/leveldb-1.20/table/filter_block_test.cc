@@ -44,16 +44,16 @@ class FilterBlockTest {
 };
 
 TEST(FilterBlockTest, EmptyBuilder) {
-  FilterBlockBuilder builder(&policy_);
+  FilterBlockBuilder builder(&policy_, false);
   Slice block = builder.Finish();
   ASSERT_EQ("\\x00\\x00\\x00\\x00\\x0b", EscapeString(block));
-  FilterBlockReader reader(&policy_, block);
+  FilterBlockReader reader(&policy_, block, false);
   ASSERT_TRUE(reader.KeyMayMatch(0, "foo"));
   ASSERT_TRUE(reader.KeyMayMatch(100000, "foo"));
 }
 
 TEST(FilterBlockTest, SingleChunk) {
-  FilterBlockBuilder builder(&policy_);
+  FilterBlockBuilder builder(&policy_, false);
   builder.StartBlock(100);
   builder.AddKey("foo");
   builder.AddKey("bar");
@@ -63,7 +63,7 @@ TEST(FilterBlockTest, SingleChunk) {
   builder.StartBlock(300);
   builder.AddKey("hello");
   Slice block = builder.Finish();
-  FilterBlockReader reader(&policy_, block);
+  FilterBlockReader reader(&policy_, block, false);
   ASSERT_TRUE(reader.KeyMayMatch(100, "foo"));
   ASSERT_TRUE(reader.KeyMayMatch(100, "bar"));
   ASSERT_TRUE(reader.KeyMayMatch(100, "box"));
@@ -74,7 +74,7 @@ TEST(FilterBlockTest, SingleChunk) {
 }
 
 TEST(FilterBlockTest, MultiChunk) {
-  FilterBlockBuilder builder(&policy_);
+  FilterBlockBuilder builder(&policy_, false);
 
   // First filter
   builder.StartBlock(0);
@@ -94,7 +94,7 @@ TEST(FilterBlockTest, MultiChunk) {
   builder.AddKey("hello");
 
   Slice block = builder.Finish();
-  FilterBlockReader reader(&policy_, block);
+  FilterBlockReader reader(&policy_, block, false);
 
   // Check first filter
   ASSERT_TRUE(reader.KeyMayMatch(0, "foo"));
@@ -121,6 +121,26 @@ TEST(FilterBlockTest, MultiChunk) {
   ASSERT_TRUE(! reader.KeyMayMatch(9000, "bar"));
 }
 
+TEST(FilterBlockTest, WholeTable) {
+  FilterBlockBuilder builder(&policy_, true);
+  builder.StartBlock(0);
+  builder.AddKey("foo");
+  builder.StartBlock(3100);
+  builder.AddKey("box");
+  builder.StartBlock(9000);
+  builder.AddKey("hello");
+  Slice block = builder.Finish();
+  ASSERT_EQ(12, block.size());
+  FilterBlockReader reader(&policy_, block, true);
+  ASSERT_TRUE(reader.whole_table());
+  ASSERT_TRUE(reader.KeyMayMatch(0, "foo"));
+  ASSERT_TRUE(reader.KeyMayMatch(0, "box"));
+  ASSERT_TRUE(reader.KeyMayMatch(9000, "foo"));
+  ASSERT_TRUE(reader.KeyMayMatch(100000, "hello"));
+  ASSERT_TRUE(! reader.KeyMayMatch(0, "bar"));
+  ASSERT_TRUE(! reader.KeyMayMatch(9000, "missing"));
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
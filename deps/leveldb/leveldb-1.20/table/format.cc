@@ -4,6 +4,9 @@
 
 #include "table/format.h"
 
+#include <string.h>
+
+#include "leveldb/compressor.h"
 #include "leveldb/env.h"
 #include "port/port.h"
 #include "table/block.h"
@@ -34,8 +37,10 @@ void Footer::EncodeTo(std::string* dst) const {
   metaindex_handle_.EncodeTo(dst);
   index_handle_.EncodeTo(dst);
   dst->resize(2 * BlockHandle::kMaxEncodedLength);  // Padding
-  PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumber & 0xffffffffu));
-  PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumber >> 32));
+  const uint64_t magic = partitioned_index_ ? kPartitionedIndexMagicNumber
+                                            : kTableMagicNumber;
+  PutFixed32(dst, static_cast<uint32_t>(magic & 0xffffffffu));
+  PutFixed32(dst, static_cast<uint32_t>(magic >> 32));
   assert(dst->size() == original_size + kEncodedLength);
   (void)original_size;  // Disable unused variable warning.
 }
@@ -46,9 +51,10 @@ Status Footer::DecodeFrom(Slice* input) {
   const uint32_t magic_hi = DecodeFixed32(magic_ptr + 4);
   const uint64_t magic = ((static_cast<uint64_t>(magic_hi) << 32) |
                           (static_cast<uint64_t>(magic_lo)));
-  if (magic != kTableMagicNumber) {
+  if (magic != kTableMagicNumber && magic != kPartitionedIndexMagicNumber) {
     return Status::Corruption("not an sstable (bad magic number)");
   }
+  partitioned_index_ = (magic == kPartitionedIndexMagicNumber);
 
   Status result = metaindex_handle_.DecodeFrom(input);
   if (result.ok()) {
@@ -62,83 +68,166 @@ Status Footer::DecodeFrom(Slice* input) {
   return result;
 }
 
-Status ReadBlock(RandomAccessFile* file,
-                 const ReadOptions& options,
-                 const BlockHandle& handle,
-                 BlockContents* result) {
-  result->data = Slice();
-  result->cachable = false;
-  result->heap_allocated = false;
+// Blocks are read into a buffer that each thread reuses, since only the
+// uncompressed form of a compressed block outlives the read.  An
+// uncompressed block takes the buffer with it instead.  Larger blocks than
+// this get a buffer of their own, so that the thread doesn't hold on to it.
+static const size_t kMaxReadScratchSize = 256 * 1024;
 
-  // Read the block contents as well as the type/crc footer.
-  // See table_builder.cc for the code that built this structure.
-  size_t n = static_cast<size_t>(handle.size());
-  char* buf = new char[n + kBlockTrailerSize];
-  Slice contents;
-  Status s = file->Read(handle.offset(), n + kBlockTrailerSize, &contents, buf);
-  if (!s.ok()) {
-    delete[] buf;
-    return s;
+struct ReadScratch {
+  char* buf;
+  size_t size;
+
+  ReadScratch() : buf(NULL), size(0) { }
+  ~ReadScratch() { delete[] buf; }
+
+  char* Get(size_t n) {
+    if (n > size) {
+      delete[] buf;
+      buf = new char[n];
+      size = n;
+    }
+    return buf;
+  }
+
+  // Give up ownership of buf to the caller
+  char* Release() {
+    char* result = buf;
+    buf = NULL;
+    size = 0;
+    return result;
   }
+};
+
+static thread_local ReadScratch read_scratch;
+
+Status CheckBlockContents(const Slice& contents,
+                          const ReadOptions& options,
+                          const BlockHandle& handle,
+                          CompressionType* type) {
+  const size_t n = static_cast<size_t>(handle.size());
   if (contents.size() != n + kBlockTrailerSize) {
-    delete[] buf;
     return Status::Corruption("truncated block read");
   }
 
   // Check the crc of the type and the block contents
-  const char* data = contents.data();    // Pointer to where Read put the data
+  const char* data = contents.data();
   if (options.verify_checksums) {
     const uint32_t crc = crc32c::Unmask(DecodeFixed32(data + n + 1));
     const uint32_t actual = crc32c::Value(data, n + 1);
     if (actual != crc) {
-      delete[] buf;
-      s = Status::Corruption("block checksum mismatch");
-      return s;
+      return Status::Corruption("block checksum mismatch");
     }
   }
 
-  switch (data[n]) {
-    case kNoCompression:
-      if (data != buf) {
-        // File implementation gave us pointer to some other data.
-        // Use it directly under the assumption that it will be live
-        // while the file is open.
-        delete[] buf;
-        result->data = Slice(data, n);
-        result->heap_allocated = false;
-        result->cachable = false;  // Do not double-cache
-      } else {
-        result->data = Slice(buf, n);
-        result->heap_allocated = true;
-        result->cachable = true;
-      }
+  *type = static_cast<CompressionType>(static_cast<unsigned char>(data[n]));
+  return Status::OK();
+}
 
-      // Ok
-      break;
-    case kSnappyCompression: {
-      size_t ulength = 0;
-      if (!port::Snappy_GetUncompressedLength(data, n, &ulength)) {
-        delete[] buf;
-        return Status::Corruption("corrupted compressed block contents");
-      }
-      char* ubuf = new char[ulength];
-      if (!port::Snappy_Uncompress(data, n, ubuf)) {
-        delete[] buf;
-        delete[] ubuf;
-        return Status::Corruption("corrupted compressed block contents");
-      }
+Status ReadRawBlock(RandomAccessFile* file,
+                    const ReadOptions& options,
+                    const BlockHandle& handle,
+                    BlockContents* result,
+                    CompressionType* type) {
+  result->data = Slice();
+  result->cachable = false;
+  result->heap_allocated = false;
+
+  // Read the block contents as well as the type/crc footer.
+  // See table_builder.cc for the code that built this structure.
+  size_t n = static_cast<size_t>(handle.size());
+  const size_t read_size = n + kBlockTrailerSize;
+  const bool scratch = read_size <= kMaxReadScratchSize;
+  char* buf = scratch ? read_scratch.Get(read_size) : new char[read_size];
+  Slice contents;
+  Status s = file->Read(handle.offset(), read_size, &contents, buf);
+  if (s.ok()) {
+    s = CheckBlockContents(contents, options, handle, type);
+  }
+  if (!s.ok()) {
+    if (!scratch) {
       delete[] buf;
-      result->data = Slice(ubuf, ulength);
-      result->heap_allocated = true;
-      result->cachable = true;
-      break;
     }
-    default:
+    return s;
+  }
+
+  const char* data = contents.data();    // Pointer to where Read put the data
+  if (data != buf) {
+    // File implementation gave us pointer to some other data.
+    // Use it directly under the assumption that it will be live
+    // while the file is open.
+    if (!scratch) {
       delete[] buf;
-      return Status::Corruption("bad block type");
+    }
+    result->data = Slice(data, n);
+    result->heap_allocated = false;
+    result->cachable = false;  // Do not double-cache
+  } else if (scratch && *type != kNoCompression) {
+    // Only needed until it is uncompressed
+    result->data = Slice(buf, n);
+    result->heap_allocated = false;
+    result->cachable = false;
+  } else {
+    if (scratch) {
+      if (read_scratch.size - read_size <= read_size / 8) {
+        buf = read_scratch.Release();
+      } else {
+        // Far larger than the block, which would then be charged too
+        // little in the block cache
+        buf = new char[n];
+        memcpy(buf, data, n);
+      }
+    }
+    result->data = Slice(buf, n);
+    result->heap_allocated = true;
+    result->cachable = true;
   }
+  return Status::OK();
+}
 
+Status UncompressBlock(const Slice& compressed,
+                       CompressionType type,
+                       const CompressionDictionary* dictionary,
+                       BlockContents* result) {
+  const Compressor* compressor = GetCompressor(type);
+  if (compressor == NULL) {
+    return Status::Corruption("bad block type");
+  }
+  size_t ulength = 0;
+  if (!compressor->GetUncompressedLength(compressed, &ulength)) {
+    return Status::Corruption("corrupted compressed block contents");
+  }
+  char* ubuf = new char[ulength];
+  const bool uncompressed =
+      (dictionary != NULL && dictionary->type() == compressor->type())
+          ? dictionary->Uncompress(compressed, ubuf)
+          : compressor->Uncompress(compressed, ubuf);
+  if (!uncompressed) {
+    delete[] ubuf;
+    return Status::Corruption("corrupted compressed block contents");
+  }
+  result->data = Slice(ubuf, ulength);
+  result->heap_allocated = true;
+  result->cachable = true;
   return Status::OK();
 }
 
+Status ReadBlock(RandomAccessFile* file,
+                 const ReadOptions& options,
+                 const BlockHandle& handle,
+                 BlockContents* result,
+                 const CompressionDictionary* dictionary) {
+  CompressionType type;
+  Status s = ReadRawBlock(file, options, handle, result, &type);
+  if (!s.ok() || type == kNoCompression) {
+    return s;
+  }
+  const BlockContents raw = *result;
+  s = UncompressBlock(raw.data, type, dictionary, result);
+  if (raw.heap_allocated) {
+    delete[] raw.data.data();
+  }
+  return s;
+}
+
 }  // namespace leveldb
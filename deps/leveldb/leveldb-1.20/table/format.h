@@ -10,10 +10,12 @@
 #include "leveldb/slice.h"
 #include "leveldb/status.h"
 #include "leveldb/table_builder.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
 class Block;
+class CompressionDictionary;
 class RandomAccessFile;
 struct ReadOptions;
 
@@ -46,7 +48,7 @@ class BlockHandle {
 // end of every table file.
 class Footer {
  public:
-  Footer() { }
+  Footer() : partitioned_index_(false) { }
 
   // The block handle for the metaindex block of the table
   const BlockHandle& metaindex_handle() const { return metaindex_handle_; }
@@ -60,6 +62,11 @@ class Footer {
     index_handle_ = h;
   }
 
+  // Whether the index block is the top-level index of a partitioned
+  // index, which is recorded by the magic number
+  bool partitioned_index() const { return partitioned_index_; }
+  void set_partitioned_index(bool b) { partitioned_index_ = b; }
+
   void EncodeTo(std::string* dst) const;
   Status DecodeFrom(Slice* input);
 
@@ -73,6 +80,7 @@ class Footer {
  private:
   BlockHandle metaindex_handle_;
   BlockHandle index_handle_;
+  bool partitioned_index_;
 };
 
 // kTableMagicNumber was picked by running
@@ -80,9 +88,37 @@ class Footer {
 // and taking the leading 64 bits.
 static const uint64_t kTableMagicNumber = 0xdb4775248b80fb57ull;
 
+// kPartitionedIndexMagicNumber replaces kTableMagicNumber in tables with a
+// partitioned index, so that readers without support for it reject them
+// instead of misreading the top-level index.  Picked by running
+//    echo http://code.google.com/p/leveldb/partitionedindex | sha1sum
+// and taking the leading 64 bits.
+static const uint64_t kPartitionedIndexMagicNumber = 0x86094aed13906a19ull;
+
 // 1-byte type + 32-bit crc
 static const size_t kBlockTrailerSize = 5;
 
+// A data block may end with a hash index that maps the hash of the user key
+// of each entry to the index of the restart interval it is in.  It is
+// stored between the restart array and the number of restarts, as one byte
+// per bucket followed by the number of buckets as a fixed16, and its
+// presence is marked by kBlockHashIndexFlag in the number of restarts.
+// See doc/table_format.md.
+static const uint32_t kBlockHashIndexFlag = 1u << 31;
+static const uint8_t kBlockHashIndexEmpty = 255;      // No user key
+static const uint8_t kBlockHashIndexCollision = 254;  // Multiple intervals
+static const uint32_t kBlockHashIndexMaxRestarts = 254;
+static const uint32_t kBlockHashIndexMaxBuckets = 65535;
+
+inline uint32_t BlockHashIndexHash(const Slice& user_key) {
+  return Hash(user_key.data(), user_key.size(), 0x8f3d1c2b);
+}
+
+// Key of the metaindex entry that points to the compression dictionary of
+// the data blocks of a table, stored as the type of its compressor
+// followed by the dictionary.  See doc/table_format.md.
+static const char kCompressionDictionaryKey[] = "compressiondictionary";
+
 struct BlockContents {
   Slice data;           // Actual contents of data
   bool cachable;        // True iff data can be cached
@@ -90,11 +126,38 @@ struct BlockContents {
 };
 
 // Read the block identified by "handle" from "file".  On failure
-// return non-OK.  On success fill *result and return OK.
+// return non-OK.  On success fill *result and return OK.  If dictionary
+// is non-NULL, it uncompresses blocks of its type.
 extern Status ReadBlock(RandomAccessFile* file,
                         const ReadOptions& options,
                         const BlockHandle& handle,
-                        BlockContents* result);
+                        BlockContents* result,
+                        const CompressionDictionary* dictionary = NULL);
+
+// Like ReadBlock(), but does not uncompress the block.  On success sets
+// *type to the compression type of the block.  The contents of a compressed
+// block may be in a buffer owned by the calling thread, which is only valid
+// until its next call.
+extern Status ReadRawBlock(RandomAccessFile* file,
+                           const ReadOptions& options,
+                           const BlockHandle& handle,
+                           BlockContents* result,
+                           CompressionType* type);
+
+// Check "contents", read from the file for the block identified by
+// "handle" and including its trailer, as ReadRawBlock() does, and on
+// success set *type to the compression type of the block.
+extern Status CheckBlockContents(const Slice& contents,
+                                 const ReadOptions& options,
+                                 const BlockHandle& handle,
+                                 CompressionType* type);
+
+// Uncompress a block of the given type, as returned by ReadRawBlock(),
+// into *result, which is heap allocated.  On failure return non-OK.
+extern Status UncompressBlock(const Slice& compressed,
+                              CompressionType type,
+                              const CompressionDictionary* dictionary,
+                              BlockContents* result);
 
 // Implementation details follow.  Clients should ignore,
 
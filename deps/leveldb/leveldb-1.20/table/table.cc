@@ -6,10 +6,12 @@
 
 #include "leveldb/cache.h"
 #include "leveldb/comparator.h"
+#include "leveldb/compressor.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
 #include "table/block.h"
+#include "table/decoded_block.h"
 #include "table/filter_block.h"
 #include "table/format.h"
 #include "table/two_level_iterator.h"
@@ -22,19 +24,110 @@ struct Table::Rep {
     delete filter;
     delete [] filter_data;
     delete index_block;
+    delete dictionary;
   }
 
   Options options;
   Status status;
   RandomAccessFile* file;
   uint64_t cache_id;
+  uint64_t compressed_cache_id;  // Of options.compressed_block_cache
   FilterBlockReader* filter;
   const char* filter_data;
 
+  // If true, the index block and filter are not held here but stored in
+  // options.block_cache with high priority, charged to its capacity
+  bool cache_index_and_filter;
+  bool has_cached_filter;
+  bool whole_table_filter;
+  BlockHandle filter_handle;     // Valid if has_cached_filter
+
   BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
-  Block* index_block;
+  BlockHandle index_handle;
+  Block* index_block;            // NULL if cache_index_and_filter
+
+  // If true, index_block is a top-level index that maps the last key of
+  // each index partition to its handle, and partitions are read with
+  // BlockReader() like data blocks
+  bool partitioned_index;
+
+  // Dictionary that data blocks were compressed with, or NULL
+  CompressionDictionary* dictionary;
+};
+
+// A filter stored in the block cache, along with the data it refers to
+struct CachedFilter {
+  FilterBlockReader* reader;
+  const char* data;
 };
 
+// A data block stored in the compressed block cache
+struct CompressedBlock {
+  std::string data;
+  CompressionType type;
+};
+
+static void DeleteCachedBlock(const Slice& key, void* value) {
+  Block* block = reinterpret_cast<Block*>(value);
+  delete block;
+}
+
+static void DeleteCachedDecodedBlock(const Slice& key, void* value) {
+  DecodedBlock* block = reinterpret_cast<DecodedBlock*>(value);
+  delete block;
+}
+
+static void DeleteCachedCompressedBlock(const Slice& key, void* value) {
+  CompressedBlock* block = reinterpret_cast<CompressedBlock*>(value);
+  delete block;
+}
+
+static void DeleteCachedFilter(const Slice& key, void* value) {
+  CachedFilter* filter = reinterpret_cast<CachedFilter*>(value);
+  delete filter->reader;
+  delete [] filter->data;
+  delete filter;
+}
+
+static void ReleaseBlock(void* arg, void* h) {
+  Cache* cache = reinterpret_cast<Cache*>(arg);
+  Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(h);
+  cache->Release(handle);
+}
+
+static Slice BlockCacheKey(uint64_t cache_id, const BlockHandle& handle,
+                           char* buf) {
+  EncodeFixed64(buf, cache_id);
+  EncodeFixed64(buf+8, handle.offset());
+  return Slice(buf, 16);
+}
+
+static void InsertCompressedBlock(Cache* cache, const Slice& key,
+                                  const Slice& data, CompressionType type) {
+  CompressedBlock* block = new CompressedBlock;
+  block->data.assign(data.data(), data.size());
+  block->type = type;
+  cache->Release(cache->Insert(key, block, block->data.size(),
+                               &DeleteCachedCompressedBlock));
+}
+
+// Like ReadBlock(), but copies the contents to the heap if they point
+// into a memory-mapped file, so that they can be stored in a cache.
+static Status ReadOwnedBlock(RandomAccessFile* file,
+                             const ReadOptions& options,
+                             const BlockHandle& handle,
+                             BlockContents* result) {
+  Status s = ReadBlock(file, options, handle, result);
+  if (s.ok() && !result->heap_allocated) {
+    char* copy = new char[result->data.size()];
+    memcpy(copy, result->data.data(), result->data.size());
+    result->data = Slice(copy, result->data.size());
+    result->heap_allocated = true;
+    result->cachable = true;
+  }
+  return s;
+}
+
 Status Table::Open(const Options& options,
                    RandomAccessFile* file,
                    uint64_t size,
@@ -55,6 +148,8 @@ Status Table::Open(const Options& options,
   if (!s.ok()) return s;
 
   // Read the index block
+  const bool cache_index_and_filter =
+      options.cache_index_and_filter_blocks && options.block_cache != NULL;
   BlockContents contents;
   Block* index_block = NULL;
   if (s.ok()) {
@@ -62,9 +157,13 @@ Status Table::Open(const Options& options,
     if (options.paranoid_checks) {
       opt.verify_checksums = true;
     }
-    s = ReadBlock(file, opt, footer.index_handle(), &contents);
+    if (cache_index_and_filter) {
+      s = ReadOwnedBlock(file, opt, footer.index_handle(), &contents);
+    } else {
+      s = ReadBlock(file, opt, footer.index_handle(), &contents);
+    }
     if (s.ok()) {
-      index_block = new Block(contents);
+      index_block = new Block(contents, options.comparator);
     }
   }
 
@@ -75,12 +174,35 @@ Status Table::Open(const Options& options,
     rep->options = options;
     rep->file = file;
     rep->metaindex_handle = footer.metaindex_handle();
+    rep->index_handle = footer.index_handle();
     rep->index_block = index_block;
     rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
+    rep->compressed_cache_id = (options.compressed_block_cache
+                                ? options.compressed_block_cache->NewId()
+                                : 0);
     rep->filter_data = NULL;
     rep->filter = NULL;
+    rep->cache_index_and_filter = cache_index_and_filter;
+    rep->has_cached_filter = false;
+    rep->whole_table_filter = false;
+    if (cache_index_and_filter) {
+      // Hand the index block over to the block cache
+      char cache_key_buffer[16];
+      Cache* cache = options.block_cache;
+      cache->Release(cache->Insert(
+          BlockCacheKey(rep->cache_id, rep->index_handle, cache_key_buffer),
+          index_block, index_block->charge(), &DeleteCachedBlock,
+          Cache::kHighPriority));
+      rep->index_block = NULL;
+    }
+    rep->partitioned_index = footer.partitioned_index();
+    rep->dictionary = NULL;
     *table = new Table(rep);
-    (*table)->ReadMeta(footer);
+    s = (*table)->ReadMeta(footer);
+    if (!s.ok()) {
+      delete *table;
+      *table = NULL;
+    }
   } else {
     delete index_block;
   }
@@ -88,42 +210,114 @@ Status Table::Open(const Options& options,
   return s;
 }
 
-void Table::ReadMeta(const Footer& footer) {
-  if (rep_->options.filter_policy == NULL) {
-    return;  // Do not need any metadata
+Status Table::ReadMeta(const Footer& footer) {
+  // An empty block consists of a single restart point and the number of
+  // restart points, so there is nothing to read
+  if (footer.metaindex_handle().size() <= 2 * sizeof(uint32_t)) {
+    return Status::OK();
   }
 
-  // TODO(sanjay): Skip this if footer.metaindex_handle() size indicates
-  // it is an empty block.
   ReadOptions opt;
   if (rep_->options.paranoid_checks) {
     opt.verify_checksums = true;
   }
   BlockContents contents;
-  if (!ReadBlock(rep_->file, opt, footer.metaindex_handle(), &contents).ok()) {
-    // Do not propagate errors since meta info is not needed for operation
-    return;
+  Status s = ReadBlock(rep_->file, opt, footer.metaindex_handle(), &contents);
+  if (!s.ok()) {
+    // Needed to read the compression dictionary, if any
+    return s;
   }
   Block* meta = new Block(contents);
-
   Iterator* iter = meta->NewIterator(BytewiseComparator());
-  std::string key = "filter.";
-  key.append(rep_->options.filter_policy->Name());
-  iter->Seek(key);
-  if (iter->Valid() && iter->key() == Slice(key)) {
-    ReadFilter(iter->value());
+
+  iter->Seek(kCompressionDictionaryKey);
+  if (iter->Valid() && iter->key() == Slice(kCompressionDictionaryKey)) {
+    s = ReadDictionary(iter->value());
+  }
+
+  // Prefer a whole-table filter, written if options.whole_table_filter was
+  // set when the table was built
+  if (rep_->options.filter_policy != NULL) {
+    for (int whole_table = 1; whole_table >= 0; whole_table--) {
+      std::string key = whole_table ? "fullfilter." : "filter.";
+      key.append(rep_->options.filter_policy->Name());
+      iter->Seek(key);
+      if (iter->Valid() && iter->key() == Slice(key)) {
+        ReadFilter(iter->value(), whole_table != 0);
+        break;
+      }
+    }
+  }
+
+  if (s.ok()) {
+    s = iter->status();
   }
   delete iter;
   delete meta;
+  return s;
+}
+
+// Unlike a filter, the dictionary is needed to read the data blocks, so
+// failing to load it fails Table::Open()
+Status Table::ReadDictionary(const Slice& dictionary_handle_value) {
+  Slice v = dictionary_handle_value;
+  BlockHandle dictionary_handle;
+  Status s = dictionary_handle.DecodeFrom(&v);
+  if (!s.ok()) {
+    return s;
+  }
+
+  ReadOptions opt;
+  if (rep_->options.paranoid_checks) {
+    opt.verify_checksums = true;
+  }
+  BlockContents block;
+  s = ReadBlock(rep_->file, opt, dictionary_handle, &block);
+  if (!s.ok()) {
+    return s;
+  }
+  const Slice contents = block.data;
+  if (contents.empty()) {
+    s = Status::Corruption("bad compression dictionary block");
+  } else {
+    const Compressor* compressor = GetCompressor(static_cast<CompressionType>(
+        static_cast<unsigned char>(contents[0])));
+    if (compressor == NULL) {
+      s = Status::NotSupported("compression dictionary of unknown type");
+    } else {
+      rep_->dictionary = compressor->NewDictionary(
+          Slice(contents.data() + 1, contents.size() - 1));
+      if (rep_->dictionary == NULL) {
+        s = Status::Corruption("bad compression dictionary");
+      }
+    }
+  }
+  if (block.heap_allocated) {
+    delete[] block.data.data();
+  }
+  return s;
 }
 
-void Table::ReadFilter(const Slice& filter_handle_value) {
+void Table::ReadFilter(const Slice& filter_handle_value, bool whole_table) {
   Slice v = filter_handle_value;
   BlockHandle filter_handle;
   if (!filter_handle.DecodeFrom(&v).ok()) {
     return;
   }
 
+  if (rep_->cache_index_and_filter) {
+    rep_->filter_handle = filter_handle;
+    rep_->whole_table_filter = whole_table;
+    rep_->has_cached_filter = true;
+
+    // Load the filter into the block cache now rather than on first use
+    void* cache_handle;
+    if (GetFilter(&cache_handle) != NULL) {
+      ReleaseFilter(cache_handle);
+    }
+    return;
+  }
+
   // We might want to unify with ReadBlock() if we start
   // requiring checksum verification in Table::Open.
   ReadOptions opt;
@@ -137,10 +331,22 @@ void Table::ReadFilter(const Slice& filter_handle_value) {
   if (block.heap_allocated) {
     rep_->filter_data = block.data.data();     // Will need to delete later
   }
-  rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data);
+  rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data,
+                                       whole_table);
 }
 
 Table::~Table() {
+  if (rep_->cache_index_and_filter) {
+    // Unlike data blocks these would be evicted late, so erase them now
+    Cache* cache = rep_->options.block_cache;
+    char cache_key_buffer[16];
+    cache->Erase(
+        BlockCacheKey(rep_->cache_id, rep_->index_handle, cache_key_buffer));
+    if (rep_->has_cached_filter) {
+      cache->Erase(
+          BlockCacheKey(rep_->cache_id, rep_->filter_handle, cache_key_buffer));
+    }
+  }
   delete rep_;
 }
 
@@ -148,15 +354,119 @@ static void DeleteBlock(void* arg, void* ignored) {
   delete reinterpret_cast<Block*>(arg);
 }
 
-static void DeleteCachedBlock(const Slice& key, void* value) {
-  Block* block = reinterpret_cast<Block*>(value);
-  delete block;
+Iterator* Table::NewIndexIterator(const ReadOptions& options) const {
+  Iterator* iter = NewTopLevelIndexIterator(options);
+  if (rep_->partitioned_index) {
+    iter = NewTwoLevelIterator(iter, &Table::BlockReader,
+                               const_cast<Table*>(this), options);
+  }
+  return iter;
 }
 
-static void ReleaseBlock(void* arg, void* h) {
-  Cache* cache = reinterpret_cast<Cache*>(arg);
-  Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(h);
-  cache->Release(handle);
+Iterator* Table::NewTopLevelIndexIterator(const ReadOptions& options) const {
+  if (rep_->index_block != NULL) {
+    return rep_->index_block->NewIterator(rep_->options.comparator);
+  }
+
+  Cache* cache = rep_->options.block_cache;
+  char cache_key_buffer[16];
+  Slice key = BlockCacheKey(rep_->cache_id, rep_->index_handle,
+                            cache_key_buffer);
+  Cache::Handle* cache_handle = cache->Lookup(key);
+  if (cache_handle == NULL) {
+    BlockContents contents;
+    Status s = ReadOwnedBlock(rep_->file, options, rep_->index_handle,
+                              &contents);
+    if (!s.ok()) {
+      return NewErrorIterator(s);
+    }
+    Block* block = new Block(contents, rep_->options.comparator);
+    cache_handle = cache->Insert(key, block, block->charge(),
+                                 &DeleteCachedBlock, Cache::kHighPriority);
+  }
+
+  Block* block = reinterpret_cast<Block*>(cache->Value(cache_handle));
+  Iterator* iter = block->NewIterator(rep_->options.comparator);
+  iter->RegisterCleanup(&ReleaseBlock, cache, cache_handle);
+  return iter;
+}
+
+FilterBlockReader* Table::GetFilter(void** cache_handle) const {
+  *cache_handle = NULL;
+  if (!rep_->has_cached_filter) {
+    return rep_->filter;
+  }
+
+  Cache* cache = rep_->options.block_cache;
+  char cache_key_buffer[16];
+  Slice key = BlockCacheKey(rep_->cache_id, rep_->filter_handle,
+                            cache_key_buffer);
+  Cache::Handle* handle = cache->Lookup(key);
+  if (handle == NULL) {
+    ReadOptions opt;
+    if (rep_->options.paranoid_checks) {
+      opt.verify_checksums = true;
+    }
+    BlockContents block;
+    if (!ReadOwnedBlock(rep_->file, opt, rep_->filter_handle, &block).ok()) {
+      // Do not propagate errors since the filter is not needed for operation
+      return NULL;
+    }
+    CachedFilter* filter = new CachedFilter;
+    filter->data = block.data.data();
+    filter->reader = new FilterBlockReader(rep_->options.filter_policy,
+                                           block.data,
+                                           rep_->whole_table_filter);
+    handle = cache->Insert(key, filter, block.data.size(),
+                           &DeleteCachedFilter, Cache::kHighPriority);
+  }
+
+  *cache_handle = handle;
+  return reinterpret_cast<CachedFilter*>(cache->Value(handle))->reader;
+}
+
+void Table::ReleaseFilter(void* cache_handle) const {
+  if (cache_handle != NULL) {
+    rep_->options.block_cache->Release(
+        reinterpret_cast<Cache::Handle*>(cache_handle));
+  }
+}
+
+Status Table::ReadBlockContents(const ReadOptions& options,
+                                const BlockHandle& handle,
+                                BlockContents* contents) const {
+  Cache* cache = rep_->options.compressed_block_cache;
+  if (cache == NULL) {
+    return ReadBlock(rep_->file, options, handle, contents, rep_->dictionary);
+  }
+
+  char cache_key_buffer[16];
+  const Slice key = BlockCacheKey(rep_->compressed_cache_id, handle,
+                                  cache_key_buffer);
+  Cache::Handle* cache_handle = cache->Lookup(key);
+  if (cache_handle != NULL) {
+    const CompressedBlock* block =
+        reinterpret_cast<CompressedBlock*>(cache->Value(cache_handle));
+    Status s = UncompressBlock(block->data, block->type, rep_->dictionary,
+                               contents);
+    cache->Release(cache_handle);
+    return s;
+  }
+
+  CompressionType type;
+  Status s = ReadRawBlock(rep_->file, options, handle, contents, &type);
+  if (!s.ok() || type == kNoCompression) {
+    return s;
+  }
+  const BlockContents raw = *contents;
+  s = UncompressBlock(raw.data, type, rep_->dictionary, contents);
+  if (s.ok() && options.fill_cache) {
+    InsertCompressedBlock(cache, key, raw.data, type);
+  }
+  if (raw.heap_allocated) {
+    delete[] raw.data.data();
+  }
+  return s;
 }
 
 // Convert an index iterator value (i.e., an encoded BlockHandle)
@@ -164,8 +474,24 @@ static void ReleaseBlock(void* arg, void* h) {
 Iterator* Table::BlockReader(void* arg,
                              const ReadOptions& options,
                              const Slice& index_value) {
+  return ReadDataBlock(arg, options, index_value, false);
+}
+
+Iterator* Table::ScanBlockReader(void* arg,
+                                 const ReadOptions& options,
+                                 const Slice& index_value) {
+  return ReadDataBlock(arg, options, index_value, true);
+}
+
+Iterator* Table::ReadDataBlock(void* arg,
+                               const ReadOptions& options,
+                               const Slice& index_value,
+                               bool scan) {
   Table* table = reinterpret_cast<Table*>(arg);
+  const Comparator* comparator = table->rep_->options.comparator;
   Cache* block_cache = table->rep_->options.block_cache;
+  const bool cache_decoded =
+      table->rep_->options.cache_decoded_blocks && block_cache != NULL;
   Block* block = NULL;
   Cache::Handle* cache_handle = NULL;
 
@@ -175,37 +501,79 @@ Iterator* Table::BlockReader(void* arg,
   // We intentionally allow extra stuff in index_value so that we
   // can add more features in the future.
 
+  // The decoded copy of a block, if any, is stored under the key of the
+  // block followed by a 'd'
+  char cache_key_buffer[17];
+  EncodeFixed64(cache_key_buffer, table->rep_->cache_id);
+  EncodeFixed64(cache_key_buffer+8, handle.offset());
+  cache_key_buffer[16] = 'd';
+  Slice key(cache_key_buffer, 16);
+  Slice decoded_key(cache_key_buffer, 17);
+
+  if (s.ok() && cache_decoded) {
+    Cache::Handle* decoded_handle = block_cache->Lookup(decoded_key);
+    if (decoded_handle != NULL) {
+      DecodedBlock* decoded =
+          reinterpret_cast<DecodedBlock*>(block_cache->Value(decoded_handle));
+      Iterator* iter = decoded->NewIterator(comparator);
+      iter->RegisterCleanup(&ReleaseBlock, block_cache, decoded_handle);
+      return iter;
+    }
+  }
+
+  // Whether to replace the block with a decoded copy in the cache
+  const bool decode = cache_decoded && scan && options.fill_cache;
+
   if (s.ok()) {
     BlockContents contents;
     if (block_cache != NULL) {
-      char cache_key_buffer[16];
-      EncodeFixed64(cache_key_buffer, table->rep_->cache_id);
-      EncodeFixed64(cache_key_buffer+8, handle.offset());
-      Slice key(cache_key_buffer, sizeof(cache_key_buffer));
       cache_handle = block_cache->Lookup(key);
       if (cache_handle != NULL) {
         block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
       } else {
-        s = ReadBlock(table->rep_->file, options, handle, &contents);
+        s = table->ReadBlockContents(options, handle, &contents);
         if (s.ok()) {
-          block = new Block(contents);
-          if (contents.cachable && options.fill_cache) {
+          // Restart point prefixes only pay off for blocks that are
+          // seeked into more than once
+          const bool insert = contents.cachable && options.fill_cache &&
+                              !decode;
+          block = new Block(contents, insert ? comparator : NULL);
+          if (insert) {
             cache_handle = block_cache->Insert(
-                key, block, block->size(), &DeleteCachedBlock);
+                key, block, block->charge(), &DeleteCachedBlock);
           }
         }
       }
     } else {
-      s = ReadBlock(table->rep_->file, options, handle, &contents);
+      s = table->ReadBlockContents(options, handle, &contents);
       if (s.ok()) {
         block = new Block(contents);
       }
     }
   }
 
+  if (block != NULL && decode) {
+    DecodedBlock* decoded = DecodedBlock::Decode(block, comparator);
+    if (decoded != NULL) {
+      Cache::Handle* decoded_handle = block_cache->Insert(
+          decoded_key, decoded, decoded->charge(), &DeleteCachedDecodedBlock);
+      if (cache_handle != NULL) {
+        // Readers look for the decoded copy first
+        block_cache->Release(cache_handle);
+        block_cache->Erase(key);
+      } else {
+        delete block;
+      }
+      Iterator* iter = decoded->NewIterator(comparator);
+      iter->RegisterCleanup(&ReleaseBlock, block_cache, decoded_handle);
+      return iter;
+    }
+  }
+
   Iterator* iter;
   if (block != NULL) {
-    iter = block->NewIterator(table->rep_->options.comparator);
+    // Only a lookup of a single key benefits from the hash index
+    iter = block->NewIterator(comparator, !scan);
     if (cache_handle == NULL) {
       iter->RegisterCleanup(&DeleteBlock, block, NULL);
     } else {
@@ -219,21 +587,28 @@ Iterator* Table::BlockReader(void* arg,
 
 Iterator* Table::NewIterator(const ReadOptions& options) const {
   return NewTwoLevelIterator(
-      rep_->index_block->NewIterator(rep_->options.comparator),
-      &Table::BlockReader, const_cast<Table*>(this), options);
+      NewIndexIterator(options),
+      &Table::ScanBlockReader, const_cast<Table*>(this), options);
 }
 
 Status Table::InternalGet(const ReadOptions& options, const Slice& k,
                           void* arg,
                           void (*saver)(void*, const Slice&, const Slice&)) {
   Status s;
-  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  void* filter_handle;
+  FilterBlockReader* filter = GetFilter(&filter_handle);
+  if (filter != NULL && filter->whole_table() && !filter->KeyMayMatch(0, k)) {
+    // Not found, without searching the index
+    ReleaseFilter(filter_handle);
+    return s;
+  }
+
+  Iterator* iiter = NewIndexIterator(options);
   iiter->Seek(k);
   if (iiter->Valid()) {
     Slice handle_value = iiter->value();
-    FilterBlockReader* filter = rep_->filter;
     BlockHandle handle;
-    if (filter != NULL &&
+    if (filter != NULL && !filter->whole_table() &&
         handle.DecodeFrom(&handle_value).ok() &&
         !filter->KeyMayMatch(handle.offset(), k)) {
       // Not found
@@ -251,13 +626,116 @@ Status Table::InternalGet(const ReadOptions& options, const Slice& k,
     s = iiter->status();
   }
   delete iiter;
+  ReleaseFilter(filter_handle);
   return s;
 }
 
+bool Table::FindDataBlock(const ReadOptions& options, const Slice& k,
+                          BlockHandle* handle, bool* cached) const {
+  *cached = true;
+  bool may_match = true;
+  void* filter_handle;
+  FilterBlockReader* filter = GetFilter(&filter_handle);
+  if (filter != NULL && filter->whole_table() && !filter->KeyMayMatch(0, k)) {
+    may_match = false;
+  } else {
+    Iterator* iiter = NewIndexIterator(options);
+    iiter->Seek(k);
+    if (iiter->Valid()) {
+      Slice input = iiter->value();
+      if (!handle->DecodeFrom(&input).ok()) {
+        // Left to InternalGet() to report
+      } else if (filter != NULL && !filter->whole_table() &&
+                 !filter->KeyMayMatch(handle->offset(), k)) {
+        may_match = false;
+      } else {
+        *cached = DataBlockIsCached(*handle);
+      }
+    } else if (iiter->status().ok()) {
+      // Past the last key of the table
+      may_match = false;
+    }
+    delete iiter;
+  }
+  ReleaseFilter(filter_handle);
+  return may_match;
+}
+
+bool Table::DataBlockIsCached(const BlockHandle& handle) const {
+  Cache* block_cache = rep_->options.block_cache;
+  if (block_cache == NULL) {
+    return false;
+  }
+  char cache_key_buffer[17];
+  EncodeFixed64(cache_key_buffer, rep_->cache_id);
+  EncodeFixed64(cache_key_buffer+8, handle.offset());
+  cache_key_buffer[16] = 'd';
+  Cache::Handle* cache_handle =
+      block_cache->Lookup(Slice(cache_key_buffer, 16));
+  if (cache_handle == NULL && rep_->options.cache_decoded_blocks) {
+    cache_handle = block_cache->Lookup(Slice(cache_key_buffer, 17));
+  }
+  if (cache_handle != NULL) {
+    block_cache->Release(cache_handle);
+    return true;
+  }
+
+  Cache* compressed_cache = rep_->options.compressed_block_cache;
+  if (compressed_cache != NULL) {
+    cache_handle = compressed_cache->Lookup(
+        BlockCacheKey(rep_->compressed_cache_id, handle, cache_key_buffer));
+    if (cache_handle != NULL) {
+      compressed_cache->Release(cache_handle);
+      return true;
+    }
+  }
+  return false;
+}
+
+void Table::InsertDataBlock(const ReadOptions& options,
+                            const BlockHandle& handle,
+                            char* buf, const Slice& contents) const {
+  Cache* block_cache = rep_->options.block_cache;
+  CompressionType type;
+  if (block_cache == NULL || contents.data() != buf ||
+      !CheckBlockContents(contents, options, handle, &type).ok()) {
+    // A file mapped into memory returns its own pointer, and its blocks
+    // are not cached.  Errors are left to the read that follows.
+    delete[] buf;
+    return;
+  }
+
+  const Slice raw(buf, static_cast<size_t>(handle.size()));
+  BlockContents block;
+  if (type == kNoCompression) {
+    block.data = raw;
+    block.cachable = true;
+    block.heap_allocated = true;
+  } else {
+    Status s = UncompressBlock(raw, type, rep_->dictionary, &block);
+    Cache* compressed_cache = rep_->options.compressed_block_cache;
+    if (s.ok() && compressed_cache != NULL) {
+      char cache_key_buffer[16];
+      InsertCompressedBlock(
+          compressed_cache,
+          BlockCacheKey(rep_->compressed_cache_id, handle, cache_key_buffer),
+          raw, type);
+    }
+    delete[] buf;
+    if (!s.ok()) {
+      return;
+    }
+  }
+
+  Block* b = new Block(block, rep_->options.comparator);
+  char cache_key_buffer[16];
+  block_cache->Release(block_cache->Insert(
+      BlockCacheKey(rep_->cache_id, handle, cache_key_buffer),
+      b, b->charge(), &DeleteCachedBlock));
+}
 
 uint64_t Table::ApproximateOffsetOf(const Slice& key) const {
-  Iterator* index_iter =
-      rep_->index_block->NewIterator(rep_->options.comparator);
+  Iterator* index_iter = NewIndexIterator(ReadOptions());
   index_iter->Seek(key);
   uint64_t result;
   if (index_iter->Valid()) {
@@ -5,18 +5,110 @@
 #include "leveldb/table_builder.h"
 
 #include <assert.h>
+#include <string.h>
+#include <deque>
+#include <vector>
 #include "leveldb/comparator.h"
+#include "leveldb/compressor.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "port/port.h"
 #include "table/block_builder.h"
+#include "table/compression_pool.h"
 #include "table/filter_block.h"
 #include "table/format.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/mutexlock.h"
 
 namespace leveldb {
 
+// Entries held back to train a compression dictionary, as a multiple of
+// Options::compression_dictionary_size
+static const size_t kDictionaryTrainingFactor = 100;
+
+// Data blocks that may be waiting to be compressed or written, per thread
+// of Options::compression_threads
+static const size_t kBlocksInFlightPerThread = 4;
+
+// The hash index of data blocks is keyed by user key, so it is only built
+// for tables of internal keys, which are written by a DB
+static bool UseDataBlockHashIndex(const Options& options) {
+  return options.data_block_hash_index &&
+         strcmp(options.comparator->Name(),
+                "leveldb.InternalKeyComparator") == 0;
+}
+
+// Only hold back entries if the compressor can train a dictionary on them
+static bool UseCompressionDictionary(const Options& options) {
+  if (options.compression_dictionary_size == 0 ||
+      options.compression == kNoCompression) {
+    return false;
+  }
+  const Compressor* compressor = GetCompressor(options.compression);
+  return compressor != NULL && compressor->SupportsDictionaries();
+}
+
+namespace {
+
+// A data block handed to the CompressionPool.  compressed, type and done
+// are set by the pool, under *mu; the rest only by the TableBuilder.
+struct BlockTask {
+  port::Mutex* mu;
+  port::CondVar* cv;                       // Signalled when done is set
+  const Compressor* compressor;            // NULL to store raw
+  const CompressionDictionary* dictionary;
+  std::string raw;
+  std::string filter_keys;                 // Length-prefixed
+  std::string index_key;                   // Set with the next block's key
+  std::string compressed;
+  CompressionType type;
+  bool done;
+};
+
+}  // namespace
+
+// Compress raw into *compressed and return the type to store the block
+// with, which is kNoCompression if it should be stored as raw instead
+static CompressionType CompressBlock(const Compressor* compressor,
+                                     const CompressionDictionary* dictionary,
+                                     const Slice& raw,
+                                     std::string* compressed) {
+  if (compressor == NULL) {
+    return kNoCompression;
+  }
+  const bool compressed_ok =
+      (dictionary != NULL && dictionary->type() == compressor->type())
+          ? dictionary->Compress(raw, compressed)
+          : compressor->Compress(raw, compressed);
+  if (compressed_ok &&
+      compressed->size() < raw.size() - (raw.size() / 8u)) {
+    return compressor->type();
+  }
+  // Otherwise the compressor is not supported, or compressed less
+  // than 12.5%, so just store uncompressed form
+  return kNoCompression;
+}
+
+static void CompressBlockTask(void* arg) {
+  BlockTask* task = reinterpret_cast<BlockTask*>(arg);
+  const CompressionType type = CompressBlock(task->compressor,
+                                             task->dictionary,
+                                             task->raw, &task->compressed);
+  MutexLock l(task->mu);
+  task->type = type;
+  task->done = true;
+  task->cv->SignalAll();
+}
+
+static void WaitForBlockTask(BlockTask* task) {
+  MutexLock l(task->mu);
+  while (!task->done) {
+    task->cv->Wait();
+  }
+}
+
 struct TableBuilder::Rep {
   Options options;
   Options index_block_options;
@@ -25,6 +117,12 @@ struct TableBuilder::Rep {
   Status status;
   BlockBuilder data_block;
   BlockBuilder index_block;
+
+  // If the index is partitioned, index_block holds the current partition
+  // and top_index_block maps the last key of each partition to its handle.
+  const bool partition_index;
+  BlockBuilder top_index_block;
+
   std::string last_key;
   int64_t num_entries;
   bool closed;          // Either Finish() or Abandon() has been called.
@@ -44,18 +142,50 @@ struct TableBuilder::Rep {
 
   std::string compressed_output;
 
+  // With options.compression_dictionary_size and a compressor that
+  // supports dictionaries, the first entries are held in pending_entries
+  // as length-prefixed keys and values, until there are enough of them to
+  // train a dictionary for the data blocks.
+  bool collecting;
+  std::string pending_entries;
+  int64_t num_pending;
+  CompressionDictionary* dictionary;  // NULL if data blocks have none
+  std::string dictionary_block;       // Compression type + dictionary
+
+  // With options.compression_threads, data blocks are compressed by the
+  // CompressionPool, and written in order by WriteCompressedBlocks().
+  // pending_index_entry then means that the last of blocks_in_flight
+  // does not have its index_key yet.
+  CompressionPool* pool;              // NULL if blocks are compressed here
+  port::Mutex pool_mu;
+  port::CondVar pool_cv;
+  std::deque<BlockTask*> blocks_in_flight;
+  uint64_t bytes_in_flight;           // Raw size of blocks_in_flight
+  std::string block_filter_keys;      // Keys of data_block for the filter
+
   Rep(const Options& opt, WritableFile* f)
       : options(opt),
         index_block_options(opt),
         file(f),
         offset(0),
-        data_block(&options),
+        data_block(&options, UseDataBlockHashIndex(opt)),
         index_block(&index_block_options),
+        partition_index(opt.index_partition_size > 0),
+        top_index_block(&index_block_options),
         num_entries(0),
         closed(false),
         filter_block(opt.filter_policy == NULL ? NULL
-                     : new FilterBlockBuilder(opt.filter_policy)),
-        pending_index_entry(false) {
+                     : new FilterBlockBuilder(opt.filter_policy,
+                                                opt.whole_table_filter)),
+        pending_index_entry(false),
+        collecting(UseCompressionDictionary(opt)),
+        num_pending(0),
+        dictionary(NULL),
+        pool(opt.compression_threads > 0 && opt.compression != kNoCompression
+             ? CompressionPool::Shared(opt.env, opt.compression_threads)
+             : NULL),
+        pool_cv(&pool_mu),
+        bytes_in_flight(0) {
     index_block_options.block_restart_interval = 1;
   }
 };
@@ -69,7 +199,9 @@ TableBuilder::TableBuilder(const Options& options, WritableFile* file)
 
 TableBuilder::~TableBuilder() {
   assert(rep_->closed);  // Catch errors where caller forgot to call Finish()
+  assert(rep_->blocks_in_flight.empty());
   delete rep_->filter_block;
+  delete rep_->dictionary;
   delete rep_;
 }
 
@@ -93,6 +225,22 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
   Rep* r = rep_;
   assert(!r->closed);
   if (!ok()) return;
+  if (r->collecting) {
+    PutLengthPrefixedSlice(&r->pending_entries, key);
+    PutLengthPrefixedSlice(&r->pending_entries, value);
+    r->num_pending++;
+    if (r->pending_entries.size() >=
+        kDictionaryTrainingFactor * r->options.compression_dictionary_size) {
+      StartDictionary();
+    }
+    return;
+  }
+  AddToBlock(key, value);
+}
+
+void TableBuilder::AddToBlock(const Slice& key, const Slice& value) {
+  Rep* r = rep_;
+  if (!ok()) return;
   if (r->num_entries > 0) {
     assert(r->options.comparator->Compare(key, Slice(r->last_key)) > 0);
   }
@@ -100,14 +248,21 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
   if (r->pending_index_entry) {
     assert(r->data_block.empty());
     r->options.comparator->FindShortestSeparator(&r->last_key, key);
-    std::string handle_encoding;
-    r->pending_handle.EncodeTo(&handle_encoding);
-    r->index_block.Add(r->last_key, Slice(handle_encoding));
+    if (r->pool != NULL) {
+      r->blocks_in_flight.back()->index_key = r->last_key;
+    } else {
+      AddIndexEntry(r->last_key, r->pending_handle);
+    }
     r->pending_index_entry = false;
   }
 
   if (r->filter_block != NULL) {
-    r->filter_block->AddKey(key);
+    if (r->pool != NULL) {
+      // Added when the block is written, since filters are by offset
+      PutLengthPrefixedSlice(&r->block_filter_keys, key);
+    } else {
+      r->filter_block->AddKey(key);
+    }
   }
 
   r->last_key.assign(key.data(), key.size());
@@ -120,13 +275,81 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
   }
 }
 
+// Train a dictionary on the pending entries, cut into blocks the way they
+// will be written, and then add them to the table.  If the compressor
+// cannot train a dictionary from these entries, the data blocks are
+// compressed without one.
+void TableBuilder::StartDictionary() {
+  Rep* r = rep_;
+  r->collecting = false;
+  const Compressor* compressor = GetCompressor(r->options.compression);
+  if (compressor != NULL) {
+    std::vector<std::string> blocks;
+    BlockBuilder block(&r->options);
+    Slice input(r->pending_entries);
+    Slice key, value;
+    while (GetLengthPrefixedSlice(&input, &key) &&
+           GetLengthPrefixedSlice(&input, &value)) {
+      block.Add(key, value);
+      if (block.CurrentSizeEstimate() >= r->options.block_size) {
+        blocks.push_back(block.Finish().ToString());
+        block.Reset();
+      }
+    }
+    if (!block.empty()) {
+      blocks.push_back(block.Finish().ToString());
+    }
+
+    const std::vector<Slice> samples(blocks.begin(), blocks.end());
+    std::string dictionary;
+    if (compressor->TrainDictionary(samples,
+                                    r->options.compression_dictionary_size,
+                                    &dictionary)) {
+      r->dictionary = compressor->NewDictionary(dictionary);
+      if (r->dictionary != NULL) {
+        r->dictionary_block.push_back(static_cast<char>(compressor->type()));
+        r->dictionary_block.append(dictionary);
+      }
+    }
+  }
+
+  std::string entries;
+  entries.swap(r->pending_entries);
+  r->num_pending = 0;
+  Slice input(entries);
+  Slice key, value;
+  while (GetLengthPrefixedSlice(&input, &key) &&
+         GetLengthPrefixedSlice(&input, &value)) {
+    AddToBlock(key, value);
+  }
+}
+
 void TableBuilder::Flush() {
   Rep* r = rep_;
   assert(!r->closed);
   if (!ok()) return;
   if (r->data_block.empty()) return;
   assert(!r->pending_index_entry);
-  WriteBlock(&r->data_block, &r->pending_handle);
+  if (r->pool != NULL) {
+    BlockTask* task = new BlockTask;
+    task->mu = &r->pool_mu;
+    task->cv = &r->pool_cv;
+    task->compressor = GetCompressor(r->options.compression);
+    task->dictionary = r->dictionary;
+    task->raw = r->data_block.Finish().ToString();
+    task->filter_keys.swap(r->block_filter_keys);
+    task->type = kNoCompression;
+    task->done = false;
+    r->data_block.Reset();
+    r->blocks_in_flight.push_back(task);
+    r->bytes_in_flight += task->raw.size();
+    r->pending_index_entry = true;
+    r->pool->Schedule(&CompressBlockTask, task);
+    WriteCompressedBlocks(kBlocksInFlightPerThread *
+                          r->options.compression_threads);
+    return;
+  }
+  WriteBlock(&r->data_block, &r->pending_handle, r->dictionary);
   if (ok()) {
     r->pending_index_entry = true;
     r->status = r->file->Flush();
@@ -136,7 +359,89 @@ void TableBuilder::Flush() {
   }
 }
 
-void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
+// Write the data blocks at the front of blocks_in_flight that are done,
+// and wait for more until at most max_in_flight are left.  If the builder
+// has failed, discard them instead.
+void TableBuilder::WriteCompressedBlocks(size_t max_in_flight) {
+  Rep* r = rep_;
+  while (!r->blocks_in_flight.empty()) {
+    BlockTask* task = r->blocks_in_flight.front();
+    if (task == r->blocks_in_flight.back() && r->pending_index_entry) {
+      // Waits for the first key of the next block
+      break;
+    }
+    if (r->blocks_in_flight.size() > max_in_flight) {
+      WaitForBlockTask(task);
+    } else {
+      MutexLock l(&r->pool_mu);
+      if (!task->done) break;
+    }
+    r->blocks_in_flight.pop_front();
+    r->bytes_in_flight -= task->raw.size();
+
+    if (ok()) {
+      if (r->filter_block != NULL) {
+        Slice keys(task->filter_keys);
+        Slice key;
+        while (GetLengthPrefixedSlice(&keys, &key)) {
+          r->filter_block->AddKey(key);
+        }
+      }
+      BlockHandle handle;
+      WriteRawBlock(task->type == kNoCompression ? Slice(task->raw)
+                                                 : Slice(task->compressed),
+                    task->type, &handle);
+      if (ok()) {
+        r->status = r->file->Flush();
+      }
+      if (r->filter_block != NULL) {
+        r->filter_block->StartBlock(r->offset);
+      }
+      if (ok()) {
+        AddIndexEntry(task->index_key, handle);
+      }
+    }
+    delete task;
+  }
+}
+
+// Add the index entry of a data block, and flush the index partition if
+// it is full
+void TableBuilder::AddIndexEntry(const std::string& key,
+                                 const BlockHandle& handle) {
+  Rep* r = rep_;
+  std::string handle_encoding;
+  handle.EncodeTo(&handle_encoding);
+  r->index_block.Add(key, Slice(handle_encoding));
+
+  if (r->partition_index &&
+      r->index_block.CurrentSizeEstimate() >=
+          r->options.index_partition_size) {
+    FlushIndexPartition(key);
+    if (r->filter_block != NULL) {
+      // The next data block starts after the partition
+      r->filter_block->StartBlock(r->offset);
+    }
+  }
+}
+
+// Write the current index partition and add it to the top-level index,
+// keyed by last_key, the separator that was added last, which is >= all
+// keys of the partition and < all keys of the next one.
+void TableBuilder::FlushIndexPartition(const std::string& last_key) {
+  Rep* r = rep_;
+  if (!ok() || r->index_block.empty()) return;
+  BlockHandle handle;
+  WriteBlock(&r->index_block, &handle);
+  if (ok()) {
+    std::string handle_encoding;
+    handle.EncodeTo(&handle_encoding);
+    r->top_index_block.Add(last_key, Slice(handle_encoding));
+  }
+}
+
+void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle,
+                              const CompressionDictionary* dictionary) {
   // File format contains a sequence of blocks where each block has:
   //    block_data: uint8[n]
   //    type: uint8
@@ -145,29 +450,13 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
   Rep* r = rep_;
   Slice raw = block->Finish();
 
-  Slice block_contents;
-  CompressionType type = r->options.compression;
-  // TODO(postrelease): Support more compression options: zlib?
-  switch (type) {
-    case kNoCompression:
-      block_contents = raw;
-      break;
-
-    case kSnappyCompression: {
-      std::string* compressed = &r->compressed_output;
-      if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
-          compressed->size() < raw.size() - (raw.size() / 8u)) {
-        block_contents = *compressed;
-      } else {
-        // Snappy not supported, or compressed less than 12.5%, so just
-        // store uncompressed form
-        block_contents = raw;
-        type = kNoCompression;
-      }
-      break;
-    }
-  }
-  WriteRawBlock(block_contents, type, handle);
+  const Compressor* compressor = (r->options.compression == kNoCompression
+                                  ? NULL
+                                  : GetCompressor(r->options.compression));
+  const CompressionType type = CompressBlock(compressor, dictionary, raw,
+                                             &r->compressed_output);
+  WriteRawBlock(type == kNoCompression ? raw : Slice(r->compressed_output),
+                type, handle);
   r->compressed_output.clear();
   block->Reset();
 }
@@ -198,11 +487,23 @@ Status TableBuilder::status() const {
 
 Status TableBuilder::Finish() {
   Rep* r = rep_;
-  Flush();
   assert(!r->closed);
+  if (r->collecting) {
+    StartDictionary();
+  }
+  Flush();
+  if (r->pool != NULL) {
+    if (r->pending_index_entry) {
+      r->options.comparator->FindShortSuccessor(&r->last_key);
+      r->blocks_in_flight.back()->index_key = r->last_key;
+      r->pending_index_entry = false;
+    }
+    WriteCompressedBlocks(0);
+  }
   r->closed = true;
 
   BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
+  BlockHandle dictionary_block_handle;
 
   // Write filter block
   if (ok() && r->filter_block != NULL) {
@@ -210,12 +511,25 @@ Status TableBuilder::Finish() {
                   &filter_block_handle);
   }
 
+  // Write compression dictionary block
+  if (ok() && r->dictionary != NULL) {
+    WriteRawBlock(r->dictionary_block, kNoCompression,
+                  &dictionary_block_handle);
+  }
+
   // Write metaindex block
   if (ok()) {
     BlockBuilder meta_index_block(&r->options);
+    if (r->dictionary != NULL) {
+      std::string handle_encoding;
+      dictionary_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add(kCompressionDictionaryKey, handle_encoding);
+    }
     if (r->filter_block != NULL) {
-      // Add mapping from "filter.Name" to location of filter data
-      std::string key = "filter.";
+      // Add mapping from "filter.Name" or "fullfilter.Name" to location
+      // of filter data
+      std::string key =
+          r->options.whole_table_filter ? "fullfilter." : "filter.";
       key.append(r->options.filter_policy->Name());
       std::string handle_encoding;
       filter_block_handle.EncodeTo(&handle_encoding);
@@ -235,7 +549,14 @@ Status TableBuilder::Finish() {
       r->index_block.Add(r->last_key, Slice(handle_encoding));
       r->pending_index_entry = false;
     }
-    WriteBlock(&r->index_block, &index_block_handle);
+    if (r->partition_index) {
+      FlushIndexPartition(r->last_key);
+      if (ok()) {
+        WriteBlock(&r->top_index_block, &index_block_handle);
+      }
+    } else {
+      WriteBlock(&r->index_block, &index_block_handle);
+    }
   }
 
   // Write footer
@@ -243,6 +564,7 @@ Status TableBuilder::Finish() {
     Footer footer;
     footer.set_metaindex_handle(metaindex_block_handle);
     footer.set_index_handle(index_block_handle);
+    footer.set_partitioned_index(r->partition_index);
     std::string footer_encoding;
     footer.EncodeTo(&footer_encoding);
     r->status = r->file->Append(footer_encoding);
@@ -257,14 +579,22 @@ void TableBuilder::Abandon() {
   Rep* r = rep_;
   assert(!r->closed);
   r->closed = true;
+  while (!r->blocks_in_flight.empty()) {
+    WaitForBlockTask(r->blocks_in_flight.front());
+    delete r->blocks_in_flight.front();
+    r->blocks_in_flight.pop_front();
+  }
 }
 
 uint64_t TableBuilder::NumEntries() const {
-  return rep_->num_entries;
+  return rep_->num_entries + rep_->num_pending;
 }
 
 uint64_t TableBuilder::FileSize() const {
-  return rep_->offset;
+  // Count pending entries and blocks in flight at their uncompressed size,
+  // so that compactions still cut their output into files of about
+  // options.max_file_size
+  return rep_->offset + rep_->pending_entries.size() + rep_->bytes_in_flight;
 }
 
 }  // namespace leveldb
@@ -4,18 +4,26 @@
 
 #include "leveldb/table.h"
 
+#include <algorithm>
 #include <map>
+#include <set>
 #include <string>
+#include <vector>
 #include "db/dbformat.h"
 #include "db/memtable.h"
 #include "db/write_batch_internal.h"
+#include "leveldb/cache.h"
+#include "leveldb/compressor.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
 #include "leveldb/iterator.h"
 #include "leveldb/table_builder.h"
+#include "port/port.h"
 #include "table/block.h"
 #include "table/block_builder.h"
 #include "table/format.h"
+#include "util/coding.h"
 #include "util/random.h"
 #include "util/testharness.h"
 #include "util/testutil.h"
@@ -203,7 +211,7 @@ class BlockConstructor: public Constructor {
     contents.data = data_;
     contents.cachable = false;
     contents.heap_allocated = false;
-    block_ = new Block(contents);
+    block_ = new Block(contents, comparator_);
     return Status::OK();
   }
   virtual Iterator* NewIterator() const {
@@ -247,6 +255,8 @@ class TableConstructor: public Constructor {
     source_ = new StringSource(sink.contents());
     Options table_options;
     table_options.comparator = options.comparator;
+    table_options.block_cache = options.block_cache;
+    table_options.cache_decoded_blocks = options.cache_decoded_blocks;
     return Table::Open(table_options, source_, sink.contents().size(), &table_);
   }
 
@@ -407,6 +417,8 @@ struct TestArgs {
   TestType type;
   bool reverse_compare;
   int restart_interval;
+  int index_partition_size;
+  bool cache_decoded_blocks;
 };
 
 static const TestArgs kTestArgList[] = {
@@ -417,6 +429,14 @@ static const TestArgs kTestArgList[] = {
   { TABLE_TEST, true, 1 },
   { TABLE_TEST, true, 1024 },
 
+  // Partitioned index, with partitions of a few entries
+  { TABLE_TEST, false, 16, 64 },
+  { TABLE_TEST, true, 1, 64 },
+
+  // Decoded blocks in a block cache
+  { TABLE_TEST, false, 16, 0, true },
+  { TABLE_TEST, true, 1, 64, true },
+
   { BLOCK_TEST, false, 16 },
   { BLOCK_TEST, false, 1 },
   { BLOCK_TEST, false, 1024 },
@@ -436,14 +456,22 @@ static const int kNumTestArgs = sizeof(kTestArgList) / sizeof(kTestArgList[0]);
 
 class Harness {
  public:
-  Harness() : constructor_(NULL) { }
+  Harness() : constructor_(NULL), cache_(NULL) { }
 
   void Init(const TestArgs& args) {
     delete constructor_;
     constructor_ = NULL;
+    delete cache_;
+    cache_ = NULL;
     options_ = Options();
 
     options_.block_restart_interval = args.restart_interval;
+    options_.index_partition_size = args.index_partition_size;
+    if (args.cache_decoded_blocks) {
+      cache_ = NewLRUCache(1 << 20);
+      options_.block_cache = cache_;
+      options_.cache_decoded_blocks = true;
+    }
     // Use shorter block size for tests to exercise block boundary
     // conditions more.
     options_.block_size = 256;
@@ -468,6 +496,7 @@ class Harness {
 
   ~Harness() {
     delete constructor_;
+    delete cache_;
   }
 
   void Add(const std::string& key, const std::string& value) {
@@ -642,6 +671,7 @@ class Harness {
  private:
   Options options_;
   Constructor* constructor_;
+  Cache* cache_;
 };
 
 // Test empty table/block.
@@ -735,7 +765,7 @@ TEST(Harness, Randomized) {
 
 TEST(Harness, RandomizedLongDB) {
   Random rnd(test::RandomSeed());
-  TestArgs args = { DB_TEST, false, 16 };
+  TestArgs args = { DB_TEST, false, 16, 0 };
   Init(args);
   int num_entries = 100000;
   for (int e = 0; e < num_entries; e++) {
@@ -784,6 +814,168 @@ TEST(MemTableTest, Simple) {
   memtable->Unref();
 }
 
+class BlockHashIndexTest { };
+
+TEST(BlockHashIndexTest, SeekMatchesBinarySearch) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  Random rnd(301);
+  const int kRestartIntervals[] = { 1, 4, 16 };
+  for (int r = 0; r < 3; r++) {
+    Options options;
+    options.comparator = &cmp;
+    options.block_restart_interval = kRestartIntervals[r];
+    BlockBuilder plain_builder(&options);
+    BlockBuilder hash_builder(&options, true);
+
+    // Odd user keys, each with one to three versions
+    for (int i = 1; i < 200; i += 2) {
+      char user_key[16];
+      snprintf(user_key, sizeof(user_key), "k%04d", i);
+      const int versions = 1 + rnd.Uniform(3);
+      for (int v = versions; v > 0; v--) {
+        std::string key;
+        AppendInternalKey(&key, ParsedInternalKey(user_key, v * 10, kTypeValue));
+        plain_builder.Add(key, user_key);
+        hash_builder.Add(key, user_key);
+      }
+    }
+
+    BlockContents plain_contents;
+    plain_contents.data = plain_builder.Finish();
+    plain_contents.cachable = false;
+    plain_contents.heap_allocated = false;
+    BlockContents hash_contents;
+    hash_contents.data = hash_builder.Finish();
+    hash_contents.cachable = false;
+    hash_contents.heap_allocated = false;
+    ASSERT_GT(hash_contents.data.size(), plain_contents.data.size());
+
+    Block plain_block(plain_contents);
+    Block hash_block(hash_contents);
+    Iterator* plain_iter = plain_block.NewIterator(&cmp);
+    Iterator* hash_iter = hash_block.NewIterator(&cmp, true);
+
+    // Present and missing user keys, at snapshots before, between and
+    // after their versions
+    for (int i = 0; i <= 200; i++) {
+      char user_key[16];
+      snprintf(user_key, sizeof(user_key), "k%04d", i);
+      for (SequenceNumber s = 5; s <= 45; s += 10) {
+        LookupKey lkey(user_key, s);
+        plain_iter->Seek(lkey.internal_key());
+        hash_iter->Seek(lkey.internal_key());
+        ASSERT_EQ(plain_iter->Valid(), hash_iter->Valid());
+        if (plain_iter->Valid()) {
+          ASSERT_EQ(plain_iter->key().ToString(), hash_iter->key().ToString());
+          hash_iter->Next();
+          plain_iter->Next();
+          ASSERT_EQ(plain_iter->Valid(), hash_iter->Valid());
+        }
+      }
+    }
+    ASSERT_OK(hash_iter->status());
+
+    delete plain_iter;
+    delete hash_iter;
+  }
+}
+
+class BlockPrefixTest { };
+
+TEST(BlockPrefixTest, CountLessThan) {
+  Random rnd(301);
+  for (size_t n = 0; n <= 40; n++) {
+    std::vector<uint64_t> array;
+    for (size_t i = 0; i < n; i++) {
+      // Include values that differ in the sign bit
+      array.push_back((static_cast<uint64_t>(rnd.Uniform(4)) << 62) |
+                      rnd.Uniform(8));
+    }
+    std::sort(array.begin(), array.end());
+    for (size_t i = 0; i < n; i++) {
+      for (int delta = -1; delta <= 1; delta++) {
+        const uint64_t value = array[i] + delta;
+        size_t expected = 0;
+        for (size_t j = 0; j < n; j++) {
+          expected += (array[j] < value);
+        }
+        ASSERT_EQ(expected, port::CountLessThan(&array[0], n, value));
+      }
+    }
+  }
+}
+
+TEST(BlockPrefixTest, SeekMatchesPlainBlock) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  Random rnd(301);
+  const int kRestartIntervals[] = { 1, 4, 16 };
+  const char* kFormats[] = { "%d", "user:profile:%08d", "%02d\xff" };
+  const int kNumKeys[] = { 10, 100, 1000 };
+  for (int r = 0; r < 3; r++) {
+    for (int f = 0; f < 3; f++) {
+      for (int k = 0; k < 3; k++) {
+        Options options;
+        options.comparator = &cmp;
+        options.block_restart_interval = kRestartIntervals[r];
+        BlockBuilder builder(&options);
+
+        std::set<std::string> user_keys;
+        while (user_keys.size() < kNumKeys[k]) {
+          char buf[64];
+          const int n = snprintf(buf, sizeof(buf), kFormats[f],
+                                 rnd.Uniform(kNumKeys[k] * 10));
+          user_keys.insert(std::string(buf, n) +
+                           std::string(rnd.Uniform(3), '\0'));
+        }
+        for (std::set<std::string>::const_iterator it = user_keys.begin();
+             it != user_keys.end(); ++it) {
+          for (SequenceNumber s = 2; s > 0; s--) {
+            std::string key;
+            AppendInternalKey(&key, ParsedInternalKey(*it, s * 10, kTypeValue));
+            builder.Add(key, *it);
+          }
+        }
+
+        BlockContents contents;
+        contents.data = builder.Finish();
+        contents.cachable = false;
+        contents.heap_allocated = false;
+        Block plain_block(contents);
+        Block prefix_block(contents, &cmp);
+        Iterator* plain_iter = plain_block.NewIterator(&cmp);
+        Iterator* prefix_iter = prefix_block.NewIterator(&cmp);
+
+        for (int i = 0; i < 1000; i++) {
+          std::string user_key;
+          if (i % 2 == 0) {
+            std::set<std::string>::const_iterator it = user_keys.begin();
+            std::advance(it, rnd.Uniform(user_keys.size()));
+            user_key = *it;
+          } else {
+            char buf[64];
+            user_key.assign(buf, snprintf(buf, sizeof(buf), kFormats[f],
+                                          rnd.Uniform(kNumKeys[k] * 12)));
+          }
+          // Also try a prefix of the key, which may sort before all keys
+          user_key.resize(user_key.size() - rnd.Uniform(3) % user_key.size());
+          LookupKey lkey(user_key, 5 + 10 * rnd.Uniform(3));
+          plain_iter->Seek(lkey.internal_key());
+          prefix_iter->Seek(lkey.internal_key());
+          ASSERT_EQ(plain_iter->Valid(), prefix_iter->Valid());
+          if (plain_iter->Valid()) {
+            ASSERT_EQ(plain_iter->key().ToString(),
+                      prefix_iter->key().ToString());
+          }
+        }
+        ASSERT_OK(prefix_iter->status());
+
+        delete plain_iter;
+        delete prefix_iter;
+      }
+    }
+  }
+}
+
 static bool Between(uint64_t val, uint64_t low, uint64_t high) {
   bool result = (val >= low) && (val <= high);
   if (!result) {
@@ -827,18 +1019,14 @@ TEST(TableTest, ApproximateOffsetOfPlain) {
 
 }
 
-static bool SnappyCompressionSupported() {
+static bool CompressionSupported(CompressionType type) {
+  const Compressor* compressor = GetCompressor(type);
   std::string out;
   Slice in = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
-  return port::Snappy_Compress(in.data(), in.size(), &out);
+  return compressor != NULL && compressor->Compress(in, &out);
 }
 
-TEST(TableTest, ApproximateOffsetOfCompressed) {
-  if (!SnappyCompressionSupported()) {
-    fprintf(stderr, "skipping compression tests\n");
-    return;
-  }
-
+static void TestApproximateOffsetOfCompressed(CompressionType type) {
   Random rnd(301);
   TableConstructor c(BytewiseComparator());
   std::string tmp;
@@ -850,7 +1038,7 @@ TEST(TableTest, ApproximateOffsetOfCompressed) {
   KVMap kvmap;
   Options options;
   options.block_size = 1024;
-  options.compression = kSnappyCompression;
+  options.compression = type;
   c.Finish(options, &keys, &kvmap);
 
   // Expected upper and lower bounds of space used by compressible strings.
@@ -867,6 +1055,383 @@ TEST(TableTest, ApproximateOffsetOfCompressed) {
   ASSERT_TRUE(Between(c.ApproximateOffsetOf("k04"), min_z, max_z));
   // Have now emitted two large compressible strings, so adjust expected offset.
   ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"), 2 * min_z, 2 * max_z));
+
+  // And the compressed blocks read back
+  Iterator* iter = c.NewIterator();
+  iter->Seek("k04");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(kvmap["k04"], iter->value().ToString());
+  delete iter;
+}
+
+TEST(TableTest, ApproximateOffsetOfCompressed) {
+  const CompressionType types[] = {
+    kSnappyCompression, kLZ4Compression, kZstdCompression
+  };
+  for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+    if (!CompressionSupported(types[i])) {
+      fprintf(stderr, "skipping compression tests for type %d\n",
+              static_cast<int>(types[i]));
+      continue;
+    }
+    TestApproximateOffsetOfCompressed(types[i]);
+  }
+}
+
+// Small JSON documents, which are alike but a block holds too few of to
+// compress well on its own
+static std::string JsonValue(Random* rnd, int i) {
+  static const char* kStatus[] = { "active", "suspended", "deleted" };
+  char buf[512];
+  snprintf(buf, sizeof(buf),
+           "{\"id\":%d,\"name\":\"user%07u\","
+           "\"email\":\"user%07u@example.com\","
+           "\"status\":\"%s\",\"created\":\"2024-%02u-%02uT%02u:%02u:00Z\","
+           "\"settings\":{\"theme\":\"%s\",\"language\":\"en-US\","
+           "\"notifications\":{\"email\":%s,\"push\":%s}},"
+           "\"score\":%u}",
+           i, rnd->Uniform(10000000), rnd->Uniform(10000000),
+           kStatus[rnd->Uniform(3)], 1 + rnd->Uniform(12), 1 + rnd->Uniform(28),
+           rnd->Uniform(24), rnd->Uniform(60),
+           rnd->OneIn(2) ? "dark" : "light",
+           rnd->OneIn(2) ? "true" : "false", rnd->OneIn(2) ? "true" : "false",
+           rnd->Uniform(100000));
+  return buf;
+}
+
+TEST(TableTest, CompressionDictionary) {
+  if (!CompressionSupported(kZstdCompression)) {
+    fprintf(stderr, "skipping compression dictionary test\n");
+    return;
+  }
+
+  uint64_t sizes[2];
+  for (int dictionary = 0; dictionary <= 1; dictionary++) {
+    Random rnd(301);
+    TableConstructor c(BytewiseComparator());
+    char key[16];
+    for (int i = 0; i < 3000; i++) {
+      snprintf(key, sizeof(key), "k%06d", i);
+      c.Add(key, JsonValue(&rnd, i));
+    }
+    std::vector<std::string> keys;
+    KVMap kvmap;
+    Options options;
+    options.compression = kZstdCompression;
+    // Enough to train on some of the entries and add the rest directly
+    options.compression_dictionary_size = dictionary ? 4096 : 0;
+    // Index partitions are read like data blocks, but compressed without
+    // the dictionary
+    options.index_partition_size = 1024;
+    c.Finish(options, &keys, &kvmap);
+    sizes[dictionary] = c.ApproximateOffsetOf("xyz");
+
+    Iterator* iter = c.NewIterator();
+    int n = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ASSERT_EQ(kvmap[iter->key().ToString()], iter->value().ToString());
+      n++;
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(3000, n);
+    iter->Seek("k001500");
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(kvmap["k001500"], iter->value().ToString());
+    delete iter;
+  }
+
+  fprintf(stderr, "zstd without dictionary: %d bytes, with: %d bytes\n",
+          static_cast<int>(sizes[0]), static_cast<int>(sizes[1]));
+  ASSERT_LT(sizes[1], sizes[0] * 4 / 5);
+}
+
+TEST(TableTest, CompressionDictionaryNotSupported) {
+  if (!CompressionSupported(kLZ4Compression)) {
+    fprintf(stderr, "skipping compression dictionary test\n");
+    return;
+  }
+  ASSERT_TRUE(!GetCompressor(kLZ4Compression)->SupportsDictionaries());
+
+  // Entries are not held back for a dictionary that LZ4 cannot train
+  Options options;
+  options.compression = kLZ4Compression;
+  options.compression_dictionary_size = 4096;
+  options.block_size = 1024;
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  Random rnd(301);
+  std::string value;
+  char key[16];
+  for (int i = 0; i < 100; i++) {
+    snprintf(key, sizeof(key), "k%06d", i);
+    builder.Add(key, test::CompressibleString(&rnd, 0.5, 1000, &value));
+  }
+  ASSERT_GT(builder.FileSize(), 0);
+  ASSERT_OK(builder.Finish());
+}
+
+static std::string BuildTable(const Options& options, int n,
+                              bool abandon) {
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  Random rnd(301);
+  std::string value;
+  char key[16];
+  for (int i = 0; i < n; i++) {
+    snprintf(key, sizeof(key), "k%06d", i);
+    builder.Add(key, test::CompressibleString(&rnd, 0.5, 100 + i % 200,
+                                              &value));
+  }
+  if (abandon) {
+    builder.Abandon();
+  } else {
+    ASSERT_OK(builder.Finish());
+    ASSERT_EQ(sink.contents().size(), builder.FileSize());
+  }
+  ASSERT_EQ(n, builder.NumEntries());
+  return sink.contents();
+}
+
+TEST(TableTest, CompressionThreads) {
+  const FilterPolicy* policy = NewBloomFilterPolicy(10);
+  const CompressionType types[] = { kSnappyCompression, kZstdCompression };
+  for (int i = 0; i < 4; i++) {
+    // Types that are not supported are stored uncompressed
+    const bool partitioned = (i & 1) != 0;
+    Options options;
+    options.compression = types[i / 2];
+    options.block_size = 256;
+    options.filter_policy = policy;
+    options.index_partition_size = partitioned ? 256 : 0;
+    const std::string expected = BuildTable(options, 3000, false);
+
+    options.compression_threads = 3;
+    const std::string contents = BuildTable(options, 3000, false);
+    if (!partitioned) {
+      // Blocks are written in the same order, with the same filters
+      ASSERT_EQ(expected, contents);
+    }
+    BuildTable(options, 3000, true);
+
+    StringSource source(contents);
+    Table* table;
+    Options table_options;
+    table_options.filter_policy = policy;
+    ASSERT_OK(Table::Open(table_options, &source, contents.size(), &table));
+    Iterator* iter = table->NewIterator(ReadOptions());
+    int n = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      n++;
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(3000, n);
+    iter->Seek("k002500");
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ("k002500", iter->key().ToString());
+    delete iter;
+    delete table;
+  }
+  delete policy;
+}
+
+// Counts the reads of a table
+class CountingSource : public StringSource {
+ public:
+  explicit CountingSource(const Slice& contents)
+      : StringSource(contents), reads_(0) { }
+
+  int reads() const { return reads_; }
+
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const {
+    reads_++;
+    return StringSource::Read(offset, n, result, scratch);
+  }
+
+ private:
+  mutable int reads_;
+};
+
+TEST(TableTest, PartitionedIndexMagicNumber) {
+  for (int partitioned = 0; partitioned < 2; partitioned++) {
+    Options options;
+    options.block_size = 256;
+    options.index_partition_size = partitioned ? 256 : 0;
+    const std::string contents = BuildTable(options, 1000, false);
+
+    Slice input(contents.data() + contents.size() - Footer::kEncodedLength,
+                Footer::kEncodedLength);
+    const uint64_t magic = DecodeFixed64(input.data() + input.size() - 8);
+    ASSERT_EQ(partitioned ? kPartitionedIndexMagicNumber : kTableMagicNumber,
+              magic);
+    Footer footer;
+    ASSERT_OK(footer.DecodeFrom(&input));
+    ASSERT_EQ(partitioned != 0, footer.partitioned_index());
+  }
+}
+
+TEST(TableTest, CompressedBlockCache) {
+  const CompressionType types[] = {
+    kSnappyCompression, kLZ4Compression, kZstdCompression
+  };
+  for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+    if (!CompressionSupported(types[i])) {
+      continue;
+    }
+    Options options;
+    options.compression = types[i];
+    const std::string contents = BuildTable(options, 3000, false);
+
+    for (int block_cache = 0; block_cache <= 1; block_cache++) {
+      CountingSource source(contents);
+      Options table_options;
+      table_options.compressed_block_cache = NewLRUCache(1 << 20);
+      table_options.block_cache = block_cache ? NewLRUCache(4096) : NULL;
+      Table* table;
+      ASSERT_OK(Table::Open(table_options, &source, contents.size(), &table));
+
+      for (int scan = 0; scan < 2; scan++) {
+        const int reads = source.reads();
+        Iterator* iter = table->NewIterator(ReadOptions());
+        int n = 0;
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+          n++;
+        }
+        ASSERT_OK(iter->status());
+        ASSERT_EQ(3000, n);
+        delete iter;
+        if (scan == 1) {
+          // All blocks were found in the compressed block cache
+          ASSERT_EQ(reads, source.reads());
+        }
+      }
+      ASSERT_GT(table_options.compressed_block_cache->TotalCharge(), 0);
+      ASSERT_LT(table_options.compressed_block_cache->TotalCharge(),
+                contents.size());
+
+      delete table;
+      delete table_options.block_cache;
+      delete table_options.compressed_block_cache;
+    }
+    return;
+  }
+  fprintf(stderr, "skipping compressed block cache test\n");
+}
+
+TEST(TableTest, ReadBlockSizes) {
+  // Blocks are read into a buffer that is reused by each thread, and that
+  // uncompressed blocks take with them, so mix compressed and uncompressed
+  // blocks of very different sizes, some too large for the buffer
+  const int sizes[] = { 100, 300 << 10, 2000, 50, 600 << 10, 10, 4000 };
+  const int n = sizeof(sizes) / sizeof(sizes[0]);
+  Options options;
+  options.compression = CompressionSupported(kSnappyCompression)
+                            ? kSnappyCompression : kLZ4Compression;
+  options.block_size = 1;
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  Random rnd(301);
+  std::vector<std::string> values(2 * n);
+  char key[16];
+  for (int i = 0; i < 2 * n; i++) {
+    snprintf(key, sizeof(key), "k%06d", i);
+    if (i % 2 == 0) {
+      test::RandomString(&rnd, sizes[i / 2], &values[i]);
+    } else {
+      test::CompressibleString(&rnd, 0.25, sizes[i / 2], &values[i]);
+    }
+    builder.Add(key, values[i]);
+  }
+  ASSERT_OK(builder.Finish());
+
+  StringSource source(sink.contents());
+  Table* table;
+  ASSERT_OK(Table::Open(Options(), &source, sink.contents().size(), &table));
+  for (int pass = 0; pass < 2; pass++) {
+    Iterator* iter = table->NewIterator(ReadOptions());
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      ASSERT_LT(i, 2 * n);
+      ASSERT_EQ(values[i], iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(2 * n, i);
+    delete iter;
+  }
+  delete table;
+}
+
+// Stores runs of a byte as the length of the run, up to 255, and the byte
+class RunLengthCompressor : public Compressor {
+ public:
+  virtual const char* Name() const { return "test.RunLength"; }
+  virtual CompressionType type() const {
+    return static_cast<CompressionType>(0x80);
+  }
+
+  virtual bool Compress(const Slice& input, std::string* output) const {
+    output->clear();
+    for (size_t i = 0; i < input.size(); ) {
+      size_t n = 1;
+      while (n < 255 && i + n < input.size() && input[i + n] == input[i]) {
+        n++;
+      }
+      output->push_back(static_cast<char>(n));
+      output->push_back(input[i]);
+      i += n;
+    }
+    return true;
+  }
+
+  virtual bool GetUncompressedLength(const Slice& input,
+                                     size_t* length) const {
+    if (input.size() % 2 != 0) return false;
+    *length = 0;
+    for (size_t i = 0; i < input.size(); i += 2) {
+      *length += static_cast<unsigned char>(input[i]);
+    }
+    return true;
+  }
+
+  virtual bool Uncompress(const Slice& input, char* output) const {
+    for (size_t i = 0; i < input.size(); i += 2) {
+      const size_t n = static_cast<unsigned char>(input[i]);
+      memset(output, input[i + 1], n);
+      output += n;
+    }
+    return true;
+  }
+};
+
+TEST(TableTest, CustomCompressor) {
+  static RunLengthCompressor compressor;
+  ASSERT_OK(RegisterCompressor(&compressor));
+  ASSERT_TRUE(RegisterCompressor(&compressor).IsInvalidArgument());
+  ASSERT_TRUE(GetCompressor(compressor.type()) == &compressor);
+
+  TableConstructor c(BytewiseComparator());
+  c.Add("k01", std::string(10000, 'x'));
+  c.Add("k02", std::string(10000, 'y'));
+  c.Add("k03", "hello");
+  std::vector<std::string> keys;
+  KVMap kvmap;
+  Options options;
+  options.block_size = 1024;
+  options.compression = compressor.type();
+  c.Finish(options, &keys, &kvmap);
+
+  ASSERT_TRUE(Between(c.ApproximateOffsetOf("k02"), 0, 500));
+  ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"), 0, 1000));
+
+  Iterator* iter = c.NewIterator();
+  int n = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(kvmap[iter->key().ToString()], iter->value().ToString());
+    n++;
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(3, n);
+  delete iter;
 }
 
 }  // namespace leveldb
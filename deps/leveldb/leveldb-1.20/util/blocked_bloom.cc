@@ -0,0 +1,92 @@
+#include "leveldb/filter_policy.h"
+
+#include "leveldb/slice.h"
+#include "util/hash.h"
+
+namespace leveldb {
+
+namespace {
+static const size_t kBlockBytes = 64;
+static const size_t kBlockBits = kBlockBytes * 8;
+
+// Multiplier of a golden ratio hash, used to derive the probes of a key
+// from its 64-bit hash
+static const uint64_t kProbeMultiplier = 0x9e3779b97f4a7c15ull;
+
+static uint64_t BlockedBloomHash(const Slice& key) {
+  return Hash64(key.data(), key.size(), 0xbc9f1d34);
+}
+
+// Map the upper 32 bits of h to [0, n) without a division
+static inline size_t BlockIndex(uint64_t h, size_t n) {
+  return static_cast<size_t>(((h >> 32) * static_cast<uint64_t>(n)) >> 32);
+}
+
+class BlockedBloomFilterPolicy : public FilterPolicy {
+ private:
+  size_t bits_per_key_;
+  size_t k_;
+
+ public:
+  explicit BlockedBloomFilterPolicy(int bits_per_key)
+      : bits_per_key_(bits_per_key) {
+    // We intentionally round down to reduce probing cost a little bit
+    k_ = static_cast<size_t>(bits_per_key * 0.69);  // 0.69 =~ ln(2)
+    if (k_ < 1) k_ = 1;
+    if (k_ > 30) k_ = 30;
+  }
+
+  virtual const char* Name() const {
+    return "leveldb.BlockedBloomFilter";
+  }
+
+  virtual void CreateFilter(const Slice* keys, int n, std::string* dst) const {
+    // Round the number of bits up to a whole number of blocks
+    size_t blocks = (n * bits_per_key_ + kBlockBits - 1) / kBlockBits;
+    if (blocks < 1) blocks = 1;
+
+    const size_t init_size = dst->size();
+    dst->resize(init_size + blocks * kBlockBytes, 0);
+    dst->push_back(static_cast<char>(k_));  // Remember # of probes in filter
+    char* array = &(*dst)[init_size];
+    for (int i = 0; i < n; i++) {
+      uint64_t h = BlockedBloomHash(keys[i]);
+      char* block = array + BlockIndex(h, blocks) * kBlockBytes;
+      for (size_t j = 0; j < k_; j++) {
+        // Take the top 9 bits of a remixed hash as the bit within the block
+        h *= kProbeMultiplier;
+        const uint32_t bitpos = static_cast<uint32_t>(h >> 55);
+        block[bitpos/8] |= (1 << (bitpos % 8));
+      }
+    }
+  }
+
+  virtual bool KeyMayMatch(const Slice& key, const Slice& bloom_filter) const {
+    const size_t len = bloom_filter.size();
+    if (len < 2) return false;
+
+    const char* array = bloom_filter.data();
+    const size_t k = array[len-1];
+    if (k > 30 || (len - 1) % kBlockBytes != 0) {
+      // Reserved for potentially new encodings. Consider it a match.
+      return true;
+    }
+
+    uint64_t h = BlockedBloomHash(key);
+    const char* block =
+        array + BlockIndex(h, (len - 1) / kBlockBytes) * kBlockBytes;
+    for (size_t j = 0; j < k; j++) {
+      h *= kProbeMultiplier;
+      const uint32_t bitpos = static_cast<uint32_t>(h >> 55);
+      if ((block[bitpos/8] & (1 << (bitpos % 8))) == 0) return false;
+    }
+    return true;
+  }
+};
+}
+
+const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key) {
+  return new BlockedBloomFilterPolicy(bits_per_key);
+}
+
+}  // namespace leveldb
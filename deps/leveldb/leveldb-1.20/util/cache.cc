@@ -48,6 +48,7 @@ struct LRUHandle {
   size_t charge;      // TODO(opt): Only allow uint32_t?
   size_t key_length;
   bool in_cache;      // Whether entry is in the cache.
+  bool high_pri;      // Whether entry is evicted after low priority entries
   uint32_t refs;      // References, including cache reference, if present.
   uint32_t hash;      // Hash of key(); used for fast sharding and comparisons
   char key_data[1];   // Beginning of key
@@ -161,7 +162,8 @@ class LRUCache {
   // Like Cache methods, but with an extra "hash" parameter.
   Cache::Handle* Insert(const Slice& key, uint32_t hash,
                         void* value, size_t charge,
-                        void (*deleter)(const Slice& key, void* value));
+                        void (*deleter)(const Slice& key, void* value),
+                        Cache::Priority priority);
   Cache::Handle* Lookup(const Slice& key, uint32_t hash);
   void Release(Cache::Handle* handle);
   void Erase(const Slice& key, uint32_t hash);
@@ -177,6 +179,7 @@ class LRUCache {
   void Ref(LRUHandle* e);
   void Unref(LRUHandle* e);
   bool FinishErase(LRUHandle* e);
+  void EvictList(LRUHandle* list, bool all);
 
   // Initialized before use.
   size_t capacity_;
@@ -190,6 +193,10 @@ class LRUCache {
   // Entries have refs==1 and in_cache==true.
   LRUHandle lru_;
 
+  // Dummy head of LRU list of entries with high priority, which are only
+  // evicted once lru_ is empty.  Same invariants as lru_.
+  LRUHandle high_pri_lru_;
+
   // Dummy head of in-use list.
   // Entries are in use by clients, and have refs >= 2 and in_cache==true.
   LRUHandle in_use_;
@@ -202,24 +209,29 @@ LRUCache::LRUCache()
   // Make empty circular linked lists.
   lru_.next = &lru_;
   lru_.prev = &lru_;
+  high_pri_lru_.next = &high_pri_lru_;
+  high_pri_lru_.prev = &high_pri_lru_;
   in_use_.next = &in_use_;
   in_use_.prev = &in_use_;
 }
 
 LRUCache::~LRUCache() {
   assert(in_use_.next == &in_use_);  // Error if caller has an unreleased handle
-  for (LRUHandle* e = lru_.next; e != &lru_; ) {
-    LRUHandle* next = e->next;
-    assert(e->in_cache);
-    e->in_cache = false;
-    assert(e->refs == 1);  // Invariant of lru_ list.
-    Unref(e);
-    e = next;
+  LRUHandle* lists[2] = { &lru_, &high_pri_lru_ };
+  for (int i = 0; i < 2; i++) {
+    for (LRUHandle* e = lists[i]->next; e != lists[i]; ) {
+      LRUHandle* next = e->next;
+      assert(e->in_cache);
+      e->in_cache = false;
+      assert(e->refs == 1);  // Invariant of lru_ list.
+      Unref(e);
+      e = next;
+    }
   }
 }
 
 void LRUCache::Ref(LRUHandle* e) {
-  if (e->refs == 1 && e->in_cache) {  // If on lru_ list, move to in_use_ list.
+  if (e->refs == 1 && e->in_cache) {  // If on an LRU list, move to in_use_ list.
     LRU_Remove(e);
     LRU_Append(&in_use_, e);
   }
@@ -233,9 +245,9 @@ void LRUCache::Unref(LRUHandle* e) {
     assert(!e->in_cache);
     (*e->deleter)(e->key(), e->value);
     free(e);
-  } else if (e->in_cache && e->refs == 1) {  // No longer in use; move to lru_ list.
+  } else if (e->in_cache && e->refs == 1) {  // No longer in use; move to LRU list.
     LRU_Remove(e);
-    LRU_Append(&lru_, e);
+    LRU_Append(e->high_pri ? &high_pri_lru_ : &lru_, e);
   }
 }
 
@@ -268,7 +280,8 @@ void LRUCache::Release(Cache::Handle* handle) {
 
 Cache::Handle* LRUCache::Insert(
     const Slice& key, uint32_t hash, void* value, size_t charge,
-    void (*deleter)(const Slice& key, void* value)) {
+    void (*deleter)(const Slice& key, void* value),
+    Cache::Priority priority) {
   MutexLock l(&mutex_);
 
   LRUHandle* e = reinterpret_cast<LRUHandle*>(
@@ -279,6 +292,7 @@ Cache::Handle* LRUCache::Insert(
   e->key_length = key.size();
   e->hash = hash;
   e->in_cache = false;
+  e->high_pri = (priority == Cache::kHighPriority);
   e->refs = 1;  // for the returned handle.
   memcpy(e->key_data, key.data(), key.size());
 
@@ -290,16 +304,23 @@ Cache::Handle* LRUCache::Insert(
     FinishErase(table_.Insert(e));
   } // else don't cache.  (Tests use capacity_==0 to turn off caching.)
 
-  while (usage_ > capacity_ && lru_.next != &lru_) {
-    LRUHandle* old = lru_.next;
+  EvictList(&lru_, false);
+  EvictList(&high_pri_lru_, false);
+
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
+// Evict the oldest entries of list while usage_ exceeds capacity_, or all
+// of them if all is true.  Requires mutex_ held.
+void LRUCache::EvictList(LRUHandle* list, bool all) {
+  while ((all || usage_ > capacity_) && list->next != list) {
+    LRUHandle* old = list->next;
     assert(old->refs == 1);
     bool erased = FinishErase(table_.Remove(old->key(), old->hash));
     if (!erased) {  // to avoid unused variable when compiled NDEBUG
       assert(erased);
     }
   }
-
-  return reinterpret_cast<Cache::Handle*>(e);
 }
 
 // If e != NULL, finish removing *e from the cache; it has already been removed
@@ -322,14 +343,8 @@ void LRUCache::Erase(const Slice& key, uint32_t hash) {
 
 void LRUCache::Prune() {
   MutexLock l(&mutex_);
-  while (lru_.next != &lru_) {
-    LRUHandle* e = lru_.next;
-    assert(e->refs == 1);
-    bool erased = FinishErase(table_.Remove(e->key(), e->hash));
-    if (!erased) {  // to avoid unused variable when compiled NDEBUG
-      assert(erased);
-    }
-  }
+  EvictList(&lru_, true);
+  EvictList(&high_pri_lru_, true);
 }
 
 static const int kNumShardBits = 4;
@@ -340,6 +355,7 @@ class ShardedLRUCache : public Cache {
   LRUCache shard_[kNumShards];
   port::Mutex id_mutex_;
   uint64_t last_id_;
+  const size_t capacity_;
 
   static inline uint32_t HashSlice(const Slice& s) {
     return Hash(s.data(), s.size(), 0);
@@ -351,7 +367,8 @@ class ShardedLRUCache : public Cache {
 
  public:
   explicit ShardedLRUCache(size_t capacity)
-      : last_id_(0) {
+      : last_id_(0),
+        capacity_(capacity) {
     const size_t per_shard = (capacity + (kNumShards - 1)) / kNumShards;
     for (int s = 0; s < kNumShards; s++) {
       shard_[s].SetCapacity(per_shard);
@@ -361,7 +378,15 @@ class ShardedLRUCache : public Cache {
   virtual Handle* Insert(const Slice& key, void* value, size_t charge,
                          void (*deleter)(const Slice& key, void* value)) {
     const uint32_t hash = HashSlice(key);
-    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter);
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter,
+                                      kLowPriority);
+  }
+  virtual Handle* Insert(const Slice& key, void* value, size_t charge,
+                         void (*deleter)(const Slice& key, void* value),
+                         Priority priority) {
+    const uint32_t hash = HashSlice(key);
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter,
+                                      priority);
   }
   virtual Handle* Lookup(const Slice& key) {
     const uint32_t hash = HashSlice(key);
@@ -394,6 +419,9 @@ class ShardedLRUCache : public Cache {
     }
     return total;
   }
+  virtual size_t Capacity() const {
+    return capacity_;
+  }
 };
 
 }  // end anonymous namespace
@@ -156,6 +156,26 @@ TEST(CacheTest, EvictionPolicy) {
   cache_->Release(h);
 }
 
+TEST(CacheTest, HighPriority) {
+  cache_->Release(cache_->Insert(EncodeKey(100), EncodeValue(101), 1,
+                                 &CacheTest::Deleter, Cache::kHighPriority));
+  Insert(200, 201);
+
+  // Entry with high priority must outlive all others, even if unused
+  for (int i = 0; i < kCacheSize + 100; i++) {
+    Insert(1000+i, 2000+i);
+  }
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1, Lookup(200));
+
+  // Unless only high priority entries are left
+  for (int i = 0; i < kCacheSize + 100; i++) {
+    cache_->Release(cache_->Insert(EncodeKey(1000+i), EncodeValue(2000+i), 1,
+                                   &CacheTest::Deleter, Cache::kHighPriority));
+  }
+  ASSERT_EQ(-1, Lookup(100));
+}
+
 TEST(CacheTest, UseExceedsCacheSize) {
   // Overfill the cache, keeping handles on all inserted entries.
   std::vector<Cache::Handle*> h;
@@ -200,6 +220,10 @@ TEST(CacheTest, HeavyEntries) {
   ASSERT_LE(cached_weight, kCacheSize + kCacheSize/10);
 }
 
+TEST(CacheTest, Capacity) {
+  ASSERT_EQ(kCacheSize, cache_->Capacity());
+}
+
 TEST(CacheTest, NewId) {
   uint64_t a = cache_->NewId();
   uint64_t b = cache_->NewId();
@@ -0,0 +1,365 @@
+#include "leveldb/compressor.h"
+
+#include "leveldb/slice.h"
+#include "port/port.h"
+#include "util/coding.h"
+#include "util/mutexlock.h"
+
+#ifdef LZ4
+#include <lz4.h>
+#endif
+#ifdef ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+namespace leveldb {
+
+Compressor::~Compressor() { }
+
+bool Compressor::SupportsDictionaries() const {
+  return false;
+}
+
+bool Compressor::TrainDictionary(const std::vector<Slice>& samples,
+                                 size_t max_size,
+                                 std::string* dictionary) const {
+  return false;
+}
+
+CompressionDictionary* Compressor::NewDictionary(
+    const Slice& dictionary) const {
+  return NULL;
+}
+
+CompressionDictionary::~CompressionDictionary() { }
+
+namespace {
+
+class SnappyCompressor : public Compressor {
+ public:
+  virtual const char* Name() const { return "snappy"; }
+  virtual CompressionType type() const { return kSnappyCompression; }
+
+  virtual bool Compress(const Slice& input, std::string* output) const {
+    return port::Snappy_Compress(input.data(), input.size(), output);
+  }
+
+  virtual bool GetUncompressedLength(const Slice& input,
+                                     size_t* length) const {
+    return port::Snappy_GetUncompressedLength(input.data(), input.size(),
+                                              length);
+  }
+
+  virtual bool Uncompress(const Slice& input, char* output) const {
+    return port::Snappy_Uncompress(input.data(), input.size(), output);
+  }
+};
+
+#ifdef LZ4
+// An LZ4 block does not record its uncompressed length, so it is preceded
+// by a varint32 of it
+class LZ4Compressor : public Compressor {
+ public:
+  virtual const char* Name() const { return "lz4"; }
+  virtual CompressionType type() const { return kLZ4Compression; }
+
+  virtual bool Compress(const Slice& input, std::string* output) const {
+    if (input.size() > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+      return false;
+    }
+    output->clear();
+    PutVarint32(output, static_cast<uint32_t>(input.size()));
+    const size_t header = output->size();
+    const int bound = LZ4_compressBound(static_cast<int>(input.size()));
+    output->resize(header + bound);
+    const int n = LZ4_compress_default(input.data(), &(*output)[header],
+                                       static_cast<int>(input.size()), bound);
+    if (n <= 0) {
+      return false;
+    }
+    output->resize(header + n);
+    return true;
+  }
+
+  virtual bool GetUncompressedLength(const Slice& input,
+                                     size_t* length) const {
+    Slice in = input;
+    uint32_t n;
+    if (!GetVarint32(&in, &n)) {
+      return false;
+    }
+    *length = n;
+    return true;
+  }
+
+  virtual bool Uncompress(const Slice& input, char* output) const {
+    Slice in = input;
+    uint32_t n;
+    if (!GetVarint32(&in, &n) ||
+        n > static_cast<uint32_t>(LZ4_MAX_INPUT_SIZE)) {
+      return false;
+    }
+    return LZ4_decompress_safe(in.data(), output, static_cast<int>(in.size()),
+                               static_cast<int>(n)) == static_cast<int>(n);
+  }
+};
+#endif  // LZ4
+
+#ifdef ZSTD
+// Creating a zstd context allocates and initializes its tables, which costs
+// more than compressing a block, so every thread keeps its own.
+struct ZstdContexts {
+  ZSTD_CCtx* cctx;
+  ZSTD_DCtx* dctx;
+
+  ZstdContexts() : cctx(NULL), dctx(NULL) { }
+  ~ZstdContexts() {
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeDCtx(dctx);
+  }
+};
+
+static thread_local ZstdContexts zstd_contexts;
+
+static ZSTD_CCtx* ZstdCompressionContext() {
+  ZstdContexts* contexts = &zstd_contexts;
+  if (contexts->cctx == NULL) {
+    contexts->cctx = ZSTD_createCCtx();
+  }
+  return contexts->cctx;
+}
+
+static ZSTD_DCtx* ZstdDecompressionContext() {
+  ZstdContexts* contexts = &zstd_contexts;
+  if (contexts->dctx == NULL) {
+    contexts->dctx = ZSTD_createDCtx();
+  }
+  return contexts->dctx;
+}
+
+// Frames written by ZSTD_compressCCtx() and ZSTD_compress_usingCDict()
+// always record their size
+static bool ZstdGetUncompressedLength(const Slice& input, size_t* length) {
+  const unsigned long long n =
+      ZSTD_getFrameContentSize(input.data(), input.size());
+  if (n == ZSTD_CONTENTSIZE_UNKNOWN || n == ZSTD_CONTENTSIZE_ERROR ||
+      n != static_cast<size_t>(n)) {
+    return false;
+  }
+  *length = static_cast<size_t>(n);
+  return true;
+}
+
+// The digested forms of the dictionary are built on first use, since a
+// table being read only needs the one for decompression, and one being
+// written only the one for compression.
+class ZstdDictionary : public CompressionDictionary {
+ public:
+  explicit ZstdDictionary(const Slice& dictionary)
+      : dictionary_(dictionary.data(), dictionary.size()),
+        cdict_(NULL),
+        ddict_(NULL) {
+  }
+
+  virtual ~ZstdDictionary() {
+    ZSTD_freeCDict(reinterpret_cast<ZSTD_CDict*>(cdict_.NoBarrier_Load()));
+    ZSTD_freeDDict(reinterpret_cast<ZSTD_DDict*>(ddict_.NoBarrier_Load()));
+  }
+
+  virtual CompressionType type() const { return kZstdCompression; }
+
+  virtual bool Compress(const Slice& input, std::string* output) const {
+    ZSTD_CCtx* cctx = ZstdCompressionContext();
+    const ZSTD_CDict* cdict = GetCDict();
+    if (cctx == NULL || cdict == NULL) {
+      return false;
+    }
+    output->resize(ZSTD_compressBound(input.size()));
+    const size_t n = ZSTD_compress_usingCDict(cctx, &(*output)[0],
+                                              output->size(), input.data(),
+                                              input.size(), cdict);
+    if (ZSTD_isError(n)) {
+      return false;
+    }
+    output->resize(n);
+    return true;
+  }
+
+  virtual bool Uncompress(const Slice& input, char* output) const {
+    size_t length;
+    ZSTD_DCtx* dctx = ZstdDecompressionContext();
+    if (!ZstdGetUncompressedLength(input, &length) || dctx == NULL) {
+      return false;
+    }
+    size_t n;
+    if (ZSTD_getDictID_fromFrame(input.data(), input.size()) == 0) {
+      // Compressed without a dictionary, such as an index block.  Using
+      // one anyway would start from its repeat offsets rather than the
+      // defaults the frame was written with.
+      n = ZSTD_decompressDCtx(dctx, output, length,
+                              input.data(), input.size());
+    } else {
+      const ZSTD_DDict* ddict = GetDDict();
+      if (ddict == NULL) {
+        return false;
+      }
+      n = ZSTD_decompress_usingDDict(dctx, output, length,
+                                     input.data(), input.size(), ddict);
+    }
+    return !ZSTD_isError(n) && n == length;
+  }
+
+ private:
+  const ZSTD_CDict* GetCDict() const {
+    void* cdict = cdict_.Acquire_Load();
+    if (cdict == NULL) {
+      MutexLock l(&mu_);
+      cdict = cdict_.NoBarrier_Load();
+      if (cdict == NULL) {
+        cdict = ZSTD_createCDict(dictionary_.data(), dictionary_.size(),
+                                 ZSTD_CLEVEL_DEFAULT);
+        cdict_.Release_Store(cdict);
+      }
+    }
+    return reinterpret_cast<const ZSTD_CDict*>(cdict);
+  }
+
+  const ZSTD_DDict* GetDDict() const {
+    void* ddict = ddict_.Acquire_Load();
+    if (ddict == NULL) {
+      MutexLock l(&mu_);
+      ddict = ddict_.NoBarrier_Load();
+      if (ddict == NULL) {
+        ddict = ZSTD_createDDict(dictionary_.data(), dictionary_.size());
+        ddict_.Release_Store(ddict);
+      }
+    }
+    return reinterpret_cast<const ZSTD_DDict*>(ddict);
+  }
+
+  const std::string dictionary_;
+  mutable port::Mutex mu_;
+  mutable port::AtomicPointer cdict_;  // ZSTD_CDict*, or NULL until used
+  mutable port::AtomicPointer ddict_;  // ZSTD_DDict*, or NULL until used
+};
+
+class ZstdCompressor : public Compressor {
+ public:
+  virtual const char* Name() const { return "zstd"; }
+  virtual CompressionType type() const { return kZstdCompression; }
+
+  virtual bool Compress(const Slice& input, std::string* output) const {
+    ZSTD_CCtx* cctx = ZstdCompressionContext();
+    if (cctx == NULL) {
+      return false;
+    }
+    output->resize(ZSTD_compressBound(input.size()));
+    const size_t n = ZSTD_compressCCtx(cctx, &(*output)[0],
+                                       output->size(), input.data(),
+                                       input.size(), ZSTD_CLEVEL_DEFAULT);
+    if (ZSTD_isError(n)) {
+      return false;
+    }
+    output->resize(n);
+    return true;
+  }
+
+  virtual bool GetUncompressedLength(const Slice& input,
+                                     size_t* length) const {
+    return ZstdGetUncompressedLength(input, length);
+  }
+
+  virtual bool Uncompress(const Slice& input, char* output) const {
+    size_t length;
+    ZSTD_DCtx* dctx = ZstdDecompressionContext();
+    if (!ZstdGetUncompressedLength(input, &length) || dctx == NULL) {
+      return false;
+    }
+    const size_t n = ZSTD_decompressDCtx(dctx, output, length,
+                                         input.data(), input.size());
+    return !ZSTD_isError(n) && n == length;
+  }
+
+  virtual bool SupportsDictionaries() const { return true; }
+
+  virtual bool TrainDictionary(const std::vector<Slice>& samples,
+                               size_t max_size,
+                               std::string* dictionary) const {
+    std::string buffer;
+    std::vector<size_t> sizes(samples.size());
+    for (size_t i = 0; i < samples.size(); i++) {
+      buffer.append(samples[i].data(), samples[i].size());
+      sizes[i] = samples[i].size();
+    }
+    if (sizes.empty() || max_size == 0) {
+      return false;
+    }
+    dictionary->resize(max_size);
+    const size_t n = ZDICT_trainFromBuffer(&(*dictionary)[0], max_size,
+                                           buffer.data(), &sizes[0],
+                                           static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(n)) {
+      dictionary->clear();
+      return false;
+    }
+    dictionary->resize(n);
+    return true;
+  }
+
+  virtual CompressionDictionary* NewDictionary(const Slice& dictionary) const {
+    // Only trained dictionaries have an id, which frames compressed with
+    // them record
+    if (ZDICT_getDictID(dictionary.data(), dictionary.size()) == 0) {
+      return NULL;
+    }
+    return new ZstdDictionary(dictionary);
+  }
+};
+#endif  // ZSTD
+
+}  // namespace
+
+// Compressors by block type.  Lookups don't lock, since a compressor is
+// registered once and never removed.
+static port::OnceType once = LEVELDB_ONCE_INIT;
+static port::Mutex* registry_mutex;
+static port::AtomicPointer registry[256];
+
+static void InitModule() {
+  registry_mutex = new port::Mutex;
+  registry[kSnappyCompression].Release_Store(new SnappyCompressor);
+#ifdef LZ4
+  registry[kLZ4Compression].Release_Store(new LZ4Compressor);
+#endif
+#ifdef ZSTD
+  registry[kZstdCompression].Release_Store(new ZstdCompressor);
+#endif
+}
+
+Status RegisterCompressor(const Compressor* compressor) {
+  port::InitOnce(&once, InitModule);
+  const unsigned int type = compressor->type();
+  if (type == kNoCompression || type > 0xff) {
+    return Status::InvalidArgument("invalid compression type",
+                                   compressor->Name());
+  }
+  MutexLock l(registry_mutex);
+  if (registry[type].NoBarrier_Load() != NULL) {
+    return Status::InvalidArgument("compression type already registered",
+                                   compressor->Name());
+  }
+  registry[type].Release_Store(const_cast<Compressor*>(compressor));
+  return Status::OK();
+}
+
+const Compressor* GetCompressor(CompressionType type) {
+  port::InitOnce(&once, InitModule);
+  const unsigned int index = type;
+  if (index > 0xff) {
+    return NULL;
+  }
+  return reinterpret_cast<const Compressor*>(registry[index].Acquire_Load());
+}
+
+}  // namespace leveldb
@@ -0,0 +1,82 @@
+// Microbenchmark of crc32c::Value(), which reports its throughput for
+// buffers of various sizes, from that of a short log record to that of a
+// large table block.  Whether the hardware accelerated implementation is
+// in use depends on the CPU and on LEVELDB_PLATFORM_POSIX_SSE, so build it
+// with and without the latter to compare it with the portable one.  Not
+// part of the library; build with e.g.:
+//
+//   c++ -O2 -std=c++11 -DLEVELDB_PLATFORM_POSIX -DLEVELDB_PLATFORM_POSIX_SSE \
+//     -I. -Iinclude util/crc32c_bench.cc util/crc32c.cc \
+//     port/port_posix_sse.cc -o crc32c_bench
+//
+// Flags:
+//   --bytes=N          Number of bytes to checksum per measurement
+//                      (default 1000000000)
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "port/port.h"
+#include "util/crc32c.h"
+
+namespace leveldb {
+
+namespace {
+
+static double FLAGS_bytes = 1e9;
+
+static double NowNanos() {
+  return static_cast<double>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void Run(const std::string& buf, size_t size) {
+  const int iterations = static_cast<int>(FLAGS_bytes / size) + 1;
+  uint32_t crc = 0;
+  const double start = NowNanos();
+  for (int i = 0; i < iterations; i++) {
+    // Offset the buffer a little to include unaligned starts
+    crc ^= crc32c::Value(buf.data() + (i & 7), size);
+  }
+  const double nanos = NowNanos() - start;
+
+  fprintf(stdout, "%10d %10.1f %10.2f  (%08x)\n",
+          static_cast<int>(size), nanos / iterations,
+          static_cast<double>(size) * iterations / nanos, crc);
+}
+
+}  // namespace
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    double d;
+    char junk;
+    if (sscanf(argv[i], "--bytes=%lf%c", &d, &junk) == 1 && d > 0) {
+      leveldb::FLAGS_bytes = d;
+    } else {
+      fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+      exit(1);
+    }
+  }
+
+  const size_t sizes[] = { 64, 256, 1024, 4096, 16384, 65536, 1048576 };
+  std::string buf(sizes[sizeof(sizes) / sizeof(sizes[0]) - 1] + 8, '\0');
+  for (size_t i = 0; i < buf.size(); i++) {
+    buf[i] = static_cast<char>(i * 7 + (i >> 8));
+  }
+
+  const bool accelerated =
+      leveldb::port::AcceleratedCRC32C(0, buf.data(), 1) != 0;
+  fprintf(stdout, "Implementation: %s\n",
+          accelerated ? "hardware" : "portable");
+  fprintf(stdout, "%10s %10s %10s\n", "Bytes", "ns/call", "GB/s");
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    leveldb::Run(buf, sizes[s]);
+  }
+
+  return 0;
+}
@@ -3,6 +3,9 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include "util/crc32c.h"
+
+#include <algorithm>
+#include <string>
 #include "util/testharness.h"
 
 namespace leveldb {
@@ -56,6 +59,44 @@ TEST(CRC, Extend) {
             Extend(Value("hello ", 6), "world", 5));
 }
 
+// Long enough for the accelerated implementations to split the buffer
+// into interleaved streams, and to combine them at various offsets
+static std::string LongBuffer() {
+  std::string buf(100000, '\0');
+  uint32_t x = 1;
+  for (size_t i = 0; i < buf.size(); i++) {
+    x = x * 1103515245u + 12345u;
+    buf[i] = static_cast<char>(x >> 24);
+  }
+  return buf;
+}
+
+TEST(CRC, LongResults) {
+  const std::string buf = LongBuffer();
+  ASSERT_EQ(0x791c3a58, Value(buf.data(), 4096));
+  ASSERT_EQ(0x40047e27, Value(buf.data(), buf.size()));
+}
+
+TEST(CRC, ExtendInPieces) {
+  // Each piece is too short to be split into streams, so this compares the
+  // result for a whole buffer with that of a serial computation
+  const std::string buf = LongBuffer();
+  const size_t sizes[] = { 0, 1, 7, 8, 17, 767, 768, 776, 1000, 4096, 24576,
+                           24583, 30000, 99993 };
+  for (size_t offset = 0; offset < 8; offset++) {
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      const char* data = buf.data() + offset;
+      const size_t size = sizes[s];
+      uint32_t crc = 0;
+      for (size_t i = 0; i < size; i += 61) {
+        crc = Extend(crc, data + i, std::min<size_t>(61, size - i));
+      }
+      ASSERT_EQ(crc, Value(data, size)) << "offset " << offset
+                                        << ", size " << size;
+    }
+  }
+}
+
 TEST(CRC, Mask) {
   uint32_t crc = Value("foo", 3);
   ASSERT_NE(crc, Mask(crc));
@@ -13,12 +13,41 @@ Status Env::NewAppendableFile(const std::string& fname, WritableFile** result) {
   return Status::NotSupported("NewAppendableFile", fname);
 }
 
+Status Env::NewRandomAccessFileWithMmap(const std::string& fname, bool mmap,
+                                        RandomAccessFile** result) {
+  return NewRandomAccessFile(fname, result);
+}
+
+Status Env::NewRandomAccessFileWithDirectIO(const std::string& fname,
+                                            RandomAccessFile** result) {
+  return NewRandomAccessFile(fname, result);
+}
+
+Status Env::NewWritableFileWithDirectIO(const std::string& fname,
+                                        WritableFile** result) {
+  return NewWritableFile(fname, result);
+}
+
+void Env::MultiRead(ReadRequest* requests, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    ReadRequest* r = &requests[i];
+    r->status = r->file->Read(r->offset, r->n, &r->result, r->scratch);
+  }
+}
+
 SequentialFile::~SequentialFile() {
 }
 
 RandomAccessFile::~RandomAccessFile() {
 }
 
+void RandomAccessFile::Hint(AccessPattern pattern) const {
+}
+
+bool RandomAccessFile::IsMapped() const {
+  return false;
+}
+
 WritableFile::~WritableFile() {
 }
 
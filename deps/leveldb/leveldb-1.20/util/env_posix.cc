@@ -16,9 +16,20 @@
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
+#include <algorithm>
 #include <deque>
 #include <limits>
 #include <set>
+#if defined(OS_LINUX) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define LEVELDB_IO_URING 1
+#endif
+#endif
+#endif
 #include "leveldb/env.h"
 #include "leveldb/slice.h"
 #include "port/port.h"
@@ -122,17 +133,121 @@ class PosixSequentialFile: public SequentialFile {
   }
 };
 
+// Base of the random-access files opened by PosixEnv, so that
+// PosixEnv::MultiRead() can submit reads against their descriptors.
+class PosixReadableFile: public RandomAccessFile {
+ public:
+  // Descriptor that reads may be issued against directly, or -1 if they
+  // must go through Read()
+  virtual int fd() const = 0;
+  virtual const std::string& filename() const = 0;
+};
+
+// Alignment of the offsets, sizes and buffers of direct I/O.  Logical
+// block sizes are no larger in practice.
+static const size_t kDirectIOAlignment = 4096;
+
+static size_t RoundUpToAlignment(size_t n) {
+  return (n + kDirectIOAlignment - 1) & ~(kDirectIOAlignment - 1);
+}
+
+// Open fname with direct I/O, or without if the platform or the file
+// system does not support it, in which case *direct is set to false.
+static int OpenDirect(const std::string& fname, int flags, bool* direct) {
+  *direct = false;
+  int fd;
+#if defined(O_DIRECT)
+  fd = open(fname.c_str(), flags | O_DIRECT, 0644);
+  if (fd >= 0 || errno != EINVAL) {
+    *direct = (fd >= 0);
+    return fd;
+  }
+#endif
+  fd = open(fname.c_str(), flags, 0644);
+#if defined(F_NOCACHE)
+  // Needs no alignment, so is treated as not direct
+  if (fd >= 0) {
+    fcntl(fd, F_NOCACHE, 1);
+  }
+#endif
+  return fd;
+}
+
+// Aligned buffer for DirectRead() that each thread reuses, growing it as
+// needed.  Larger reads than this get a buffer of their own, so that the
+// thread doesn't hold on to it.
+static const size_t kMaxDirectReadBufferSize = 256 * 1024;
+
+struct DirectReadBuffer {
+  void* buf;
+  size_t size;
+
+  DirectReadBuffer() : buf(NULL), size(0) { }
+  ~DirectReadBuffer() { free(buf); }
+
+  // Returns NULL if out of memory
+  void* Get(size_t n) {
+    if (n > size) {
+      void* grown;
+      if (posix_memalign(&grown, kDirectIOAlignment, n) != 0) {
+        return NULL;
+      }
+      free(buf);
+      buf = grown;
+      size = n;
+    }
+    return buf;
+  }
+};
+
+static thread_local DirectReadBuffer direct_read_buffer;
+
+// Like pread(), for a descriptor opened with O_DIRECT: reads the aligned
+// range around [offset,offset+n) into an aligned buffer and copies the
+// requested part of it into scratch.
+static ssize_t DirectRead(int fd, uint64_t offset, size_t n, char* scratch) {
+  const uint64_t start =
+      offset & ~static_cast<uint64_t>(kDirectIOAlignment - 1);
+  const size_t skip = static_cast<size_t>(offset - start);
+  const size_t size = RoundUpToAlignment(skip + n);
+  const bool reuse = size <= kMaxDirectReadBufferSize;
+  void* buf;
+  if (reuse) {
+    buf = direct_read_buffer.Get(size);
+  } else if (posix_memalign(&buf, kDirectIOAlignment, size) != 0) {
+    buf = NULL;
+  }
+  if (buf == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+  ssize_t r = pread(fd, buf, size, static_cast<off_t>(start));
+  const int err = errno;
+  if (r >= 0) {
+    // Short of n at the end of the file
+    r = (static_cast<size_t>(r) > skip) ? std::min(r - skip, n) : 0;
+    memcpy(scratch, static_cast<char*>(buf) + skip, r);
+  }
+  if (!reuse) {
+    free(buf);
+  }
+  errno = err;
+  return r;
+}
+
 // pread() based random-access
-class PosixRandomAccessFile: public RandomAccessFile {
+class PosixRandomAccessFile: public PosixReadableFile {
  private:
   std::string filename_;
   bool temporary_fd_;  // If true, fd_ is -1 and we open on every read.
+  bool direct_;        // If true, fd_ was opened with O_DIRECT
   int fd_;
   Limiter* limiter_;
 
  public:
-  PosixRandomAccessFile(const std::string& fname, int fd, Limiter* limiter)
-      : filename_(fname), fd_(fd), limiter_(limiter) {
+  PosixRandomAccessFile(const std::string& fname, int fd, bool direct,
+                        Limiter* limiter)
+      : filename_(fname), direct_(direct), fd_(fd), limiter_(limiter) {
     temporary_fd_ = !limiter->Acquire();
     if (temporary_fd_) {
       // Open file on every access.
@@ -148,18 +263,25 @@ class PosixRandomAccessFile: public RandomAccessFile {
     }
   }
 
+  // Direct reads need aligned buffers, so they go through Read()
+  virtual int fd() const { return (temporary_fd_ || direct_) ? -1 : fd_; }
+  virtual const std::string& filename() const { return filename_; }
+
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const {
     int fd = fd_;
     if (temporary_fd_) {
-      fd = open(filename_.c_str(), O_RDONLY);
+      bool direct;
+      fd = direct_ ? OpenDirect(filename_, O_RDONLY, &direct)
+                   : open(filename_.c_str(), O_RDONLY);
       if (fd < 0) {
         return IOError(filename_, errno);
       }
     }
 
     Status s;
-    ssize_t r = pread(fd, scratch, n, static_cast<off_t>(offset));
+    ssize_t r = direct_ ? DirectRead(fd, offset, n, scratch)
+                        : pread(fd, scratch, n, static_cast<off_t>(offset));
     *result = Slice(scratch, (r < 0) ? 0 : r);
     if (r < 0) {
       // An error: return a non-ok status
@@ -171,15 +293,28 @@ class PosixRandomAccessFile: public RandomAccessFile {
     }
     return s;
   }
+
+  virtual void Hint(AccessPattern pattern) const {
+#if defined(POSIX_FADV_RANDOM)
+    if (temporary_fd_ || direct_) {
+      return;
+    }
+    static const int kAdvice[] = {
+      POSIX_FADV_NORMAL, POSIX_FADV_RANDOM, POSIX_FADV_SEQUENTIAL,
+      POSIX_FADV_WILLNEED
+    };
+    posix_fadvise(fd_, 0, 0, kAdvice[pattern]);
+#endif
+  }
 };
 
 // mmap() based random-access
-class PosixMmapReadableFile: public RandomAccessFile {
+class PosixMmapReadableFile: public PosixReadableFile {
  private:
   std::string filename_;
   void* mmapped_region_;
   size_t length_;
-  Limiter* limiter_;
+  Limiter* limiter_;  // NULL if the file was mapped regardless of limits
 
  public:
   // base[0,length-1] contains the mmapped contents of the file.
@@ -191,9 +326,16 @@ class PosixMmapReadableFile: public RandomAccessFile {
 
   virtual ~PosixMmapReadableFile() {
     munmap(mmapped_region_, length_);
-    limiter_->Release();
+    if (limiter_ != NULL) {
+      limiter_->Release();
+    }
   }
 
+  // Reads are served from the mapping without a system call
+  virtual int fd() const { return -1; }
+  virtual const std::string& filename() const { return filename_; }
+  virtual bool IsMapped() const { return true; }
+
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const {
     Status s;
@@ -205,7 +347,240 @@ class PosixMmapReadableFile: public RandomAccessFile {
     }
     return s;
   }
+
+  virtual void Hint(AccessPattern pattern) const {
+    static const int kAdvice[] = {
+      POSIX_MADV_NORMAL, POSIX_MADV_RANDOM, POSIX_MADV_SEQUENTIAL,
+      POSIX_MADV_WILLNEED
+    };
+    posix_madvise(mmapped_region_, length_, kAdvice[pattern]);
+  }
+};
+
+#if defined(LEVELDB_IO_URING)
+// Read the rest of a request of which the first "done" bytes have already
+// been read into r->scratch, with pread().
+static void PreadRemainder(const PosixReadableFile* file, size_t done,
+                           ReadRequest* r) {
+  while (done < r->n) {
+    ssize_t k = pread(file->fd(), r->scratch + done, r->n - done,
+                      static_cast<off_t>(r->offset + done));
+    if (k < 0 && errno == EINTR) {
+      continue;
+    } else if (k < 0) {
+      r->result = Slice(r->scratch, 0);
+      r->status = IOError(file->filename(), errno);
+      return;
+    } else if (k == 0) {
+      break;  // End of file
+    }
+    done += k;
+  }
+  r->result = Slice(r->scratch, done);
+  r->status = Status::OK();
+}
+
+// An io_uring instance driven with raw system calls, so that no library
+// is needed.  Each thread has its own, and waits for every read it
+// submits before returning, so rings are never shared.
+class IoUring {
+ public:
+  enum { kEntries = 64 };
+
+  // Return the ring of the calling thread, or NULL if io_uring is not
+  // available to this process.
+  static IoUring* Current() {
+    static thread_local IoUring ring;
+    if (!ring.tried_) {
+      ring.tried_ = true;
+      ring.Setup();
+    }
+    return ring.ring_fd_ >= 0 ? &ring : NULL;
+  }
+
+  ~IoUring() { Teardown(); }
+
+  // Read requests[0,n-1], whose files all have descriptors, and wait for
+  // them.  Falls back to pread() if the ring has failed.
+  // REQUIRES: n <= kEntries
+  void Read(ReadRequest** requests, size_t n) {
+    if (ring_fd_ < 0) {
+      for (size_t i = 0; i < n; i++) {
+        PreadRemainder(File(requests[i]), 0, requests[i]);
+      }
+      return;
+    }
+
+    unsigned tail = *sq_tail_;
+    for (size_t i = 0; i < n; i++, tail++) {
+      const unsigned index = tail & sq_mask_;
+      struct io_uring_sqe* sqe = &sqes_[index];
+      memset(sqe, 0, sizeof(*sqe));
+      iovecs_[i].iov_base = requests[i]->scratch;
+      iovecs_[i].iov_len = requests[i]->n;
+      sqe->opcode = IORING_OP_READV;
+      sqe->fd = File(requests[i])->fd();
+      sqe->off = requests[i]->offset;
+      sqe->addr = reinterpret_cast<uintptr_t>(&iovecs_[i]);
+      sqe->len = 1;
+      sqe->user_data = i;
+      sq_array_[index] = index;
+    }
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+    size_t submitted = 0;
+    size_t completed = 0;
+    bool failed = false;
+    while (completed < submitted || (!failed && submitted < n)) {
+      const unsigned to_submit = failed ? 0 : n - submitted;
+      int r = syscall(__NR_io_uring_enter, ring_fd_, to_submit, 1,
+                      IORING_ENTER_GETEVENTS, NULL, 0);
+      if (r >= 0) {
+        submitted += r;
+      } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        if (failed) {
+          // Reads are in flight into buffers we are about to give back
+          fprintf(stderr, "io_uring_enter: %s\n", strerror(errno));
+          abort();
+        }
+        failed = true;
+      }
+      completed += Reap(requests);
+    }
+
+    if (failed) {
+      // Entries the kernel did not take are still queued, so the ring
+      // can not be used again.  Read them, and all later ones, otherwise.
+      Teardown();
+      for (size_t i = submitted; i < n; i++) {
+        PreadRemainder(File(requests[i]), 0, requests[i]);
+      }
+    }
+  }
+
+ private:
+  bool tried_;
+  int ring_fd_;
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  struct io_uring_sqe* sqes_;
+  size_t sqes_size_;
+  unsigned* sq_tail_;
+  unsigned sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned cq_mask_;
+  struct io_uring_cqe* cqes_;
+  struct iovec iovecs_[kEntries];
+
+  IoUring()
+      : tried_(false), ring_fd_(-1), sq_ring_(MAP_FAILED), sq_ring_size_(0),
+        cq_ring_(MAP_FAILED), cq_ring_size_(0),
+        sqes_(static_cast<struct io_uring_sqe*>(MAP_FAILED)), sqes_size_(0) {
+  }
+
+  static const PosixReadableFile* File(const ReadRequest* r) {
+    return static_cast<const PosixReadableFile*>(r->file);
+  }
+
+  void Setup() {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = syscall(__NR_io_uring_setup, kEntries, &p);
+    if (fd < 0) {
+      return;
+    }
+    ring_fd_ = fd;
+    sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = false;
+#if defined(IORING_FEAT_SINGLE_MMAP)
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      single_mmap = true;
+      sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+#endif
+    sq_ring_ = mmap(NULL, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      Teardown();
+      return;
+    }
+    if (!single_mmap) {
+      cq_ring_ = mmap(NULL, cq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+      if (cq_ring_ == MAP_FAILED) {
+        Teardown();
+        return;
+      }
+    }
+    sqes_size_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = static_cast<struct io_uring_sqe*>(
+        mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+      Teardown();
+      return;
+    }
+
+    char* sq = static_cast<char*>(sq_ring_);
+    char* cq = static_cast<char*>(single_mmap ? sq_ring_ : cq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+  }
+
+  void Teardown() {
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+      sqes_ = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+    }
+    if (cq_ring_ != MAP_FAILED) {
+      munmap(cq_ring_, cq_ring_size_);
+      cq_ring_ = MAP_FAILED;
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+      sq_ring_ = MAP_FAILED;
+    }
+    if (ring_fd_ >= 0) {
+      close(ring_fd_);
+      ring_fd_ = -1;
+    }
+  }
+
+  // Complete the requests whose reads have finished, and return how many
+  size_t Reap(ReadRequest** requests) {
+    size_t reaped = 0;
+    unsigned head = *cq_head_;
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++, reaped++) {
+      const struct io_uring_cqe* cqe = &cqes_[head & cq_mask_];
+      ReadRequest* r = requests[cqe->user_data];
+      if (cqe->res < 0) {
+        r->result = Slice(r->scratch, 0);
+        r->status = IOError(File(r)->filename(), -cqe->res);
+      } else {
+        // Reads may come up short of the end of the file; finish them
+        PreadRemainder(File(r), cqe->res, r);
+      }
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return reaped;
+  }
+
+  // No copying allowed
+  IoUring(const IoUring&);
+  void operator=(const IoUring&);
 };
+#endif  // defined(LEVELDB_IO_URING)
 
 class PosixWritableFile : public WritableFile {
  private:
@@ -288,6 +663,101 @@ class PosixWritableFile : public WritableFile {
   }
 };
 
+// Size of the aligned buffer that PosixDirectWritableFile writes from
+static const size_t kDirectWriteBufferSize = 1 << 20;
+
+// O_DIRECT based writes.  Appended data is held in an aligned buffer until
+// it is full or the file is synced or closed.  A partly filled last block
+// is then written out padded, and the file truncated to its actual size;
+// later appends rewrite that block.
+class PosixDirectWritableFile : public WritableFile {
+ private:
+  std::string filename_;
+  int fd_;
+  char* buf_;        // Aligned, of kDirectWriteBufferSize bytes
+  size_t pos_;       // Number of bytes in buf_
+  uint64_t offset_;  // Aligned offset in the file of buf_[0]
+
+  Status WriteBuffer() {
+    const size_t size = RoundUpToAlignment(pos_);
+    memset(buf_ + pos_, 0, size - pos_);
+    size_t done = 0;
+    while (done < size) {
+      ssize_t r = pwrite(fd_, buf_ + done, size - done,
+                         static_cast<off_t>(offset_ + done));
+      if (r < 0 && errno == EINTR) {
+        continue;
+      } else if (r < 0) {
+        return IOError(filename_, errno);
+      }
+      done += r;
+    }
+    if (size != pos_ && ftruncate(fd_, offset_ + pos_) != 0) {
+      return IOError(filename_, errno);
+    }
+
+    // Keep the partly filled last block, to be rewritten
+    const size_t full = pos_ & ~(kDirectIOAlignment - 1);
+    memmove(buf_, buf_ + full, pos_ - full);
+    offset_ += full;
+    pos_ -= full;
+    return Status::OK();
+  }
+
+ public:
+  PosixDirectWritableFile(const std::string& fname, int fd, char* buf)
+      : filename_(fname), fd_(fd), buf_(buf), pos_(0), offset_(0) { }
+
+  ~PosixDirectWritableFile() {
+    if (fd_ >= 0) {
+      // Ignoring any potential errors
+      close(fd_);
+    }
+    free(buf_);
+  }
+
+  virtual Status Append(const Slice& data) {
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+      const size_t n = std::min(left, kDirectWriteBufferSize - pos_);
+      memcpy(buf_ + pos_, p, n);
+      pos_ += n;
+      p += n;
+      left -= n;
+      if (pos_ == kDirectWriteBufferSize) {
+        Status s = WriteBuffer();
+        if (!s.ok()) {
+          return s;
+        }
+      }
+    }
+    return Status::OK();
+  }
+
+  virtual Status Close() {
+    Status result = WriteBuffer();
+    if (close(fd_) != 0 && result.ok()) {
+      result = IOError(filename_, errno);
+    }
+    fd_ = -1;
+    return result;
+  }
+
+  // Only whole aligned blocks can be written, so data stays in the buffer
+  virtual Status Flush() {
+    return Status::OK();
+  }
+
+  virtual Status Sync() {
+    Status s = WriteBuffer();
+    if (s.ok() && fdatasync(fd_) != 0) {
+      s = IOError(filename_, errno);
+    }
+    return s;
+  }
+};
+
 static int LockOrUnlock(int fd, bool lock) {
   errno = 0;
   struct flock f;
@@ -346,30 +816,87 @@ class PosixEnv : public Env {
 
   virtual Status NewRandomAccessFile(const std::string& fname,
                                      RandomAccessFile** result) {
+    if (!mmap_limit_.Acquire()) {
+      return OpenRandomAccessFile(fname, false, NULL, result);
+    }
+    Status s = OpenRandomAccessFile(fname, true, &mmap_limit_, result);
+    if (!s.ok()) {
+      mmap_limit_.Release();
+    }
+    return s;
+  }
+
+  virtual Status NewRandomAccessFileWithMmap(const std::string& fname,
+                                             bool mmap,
+                                             RandomAccessFile** result) {
+    return OpenRandomAccessFile(fname, mmap, NULL, result);
+  }
+
+  virtual Status NewRandomAccessFileWithDirectIO(const std::string& fname,
+                                                 RandomAccessFile** result) {
     *result = NULL;
-    Status s;
-    int fd = open(fname.c_str(), O_RDONLY);
+    bool direct;
+    int fd = OpenDirect(fname, O_RDONLY, &direct);
     if (fd < 0) {
-      s = IOError(fname, errno);
-    } else if (mmap_limit_.Acquire()) {
-      uint64_t size;
-      s = GetFileSize(fname, &size);
-      if (s.ok()) {
-        void* base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
-        if (base != MAP_FAILED) {
-          *result = new PosixMmapReadableFile(fname, base, size, &mmap_limit_);
-        } else {
-          s = IOError(fname, errno);
-        }
+      return IOError(fname, errno);
+    }
+    *result = new PosixRandomAccessFile(fname, fd, direct, &fd_limit_);
+    return Status::OK();
+  }
+
+  virtual Status NewWritableFileWithDirectIO(const std::string& fname,
+                                             WritableFile** result) {
+    *result = NULL;
+    bool direct;
+    int fd = OpenDirect(fname, O_WRONLY | O_CREAT | O_TRUNC, &direct);
+    if (fd < 0) {
+      return IOError(fname, errno);
+    }
+    if (!direct) {
+      FILE* f = fdopen(fd, "w");
+      if (f == NULL) {
+        Status s = IOError(fname, errno);
+        close(fd);
+        return s;
       }
+      *result = new PosixWritableFile(fname, f);
+      return Status::OK();
+    }
+    void* buf;
+    if (posix_memalign(&buf, kDirectIOAlignment, kDirectWriteBufferSize) != 0) {
       close(fd);
-      if (!s.ok()) {
-        mmap_limit_.Release();
+      return IOError(fname, ENOMEM);
+    }
+    *result = new PosixDirectWritableFile(fname, fd, static_cast<char*>(buf));
+    return Status::OK();
+  }
+
+  virtual void MultiRead(ReadRequest* requests, size_t n) {
+#if defined(LEVELDB_IO_URING)
+    // A single read is cheaper with pread() than through a ring
+    IoUring* ring = (n > 1) ? IoUring::Current() : NULL;
+    if (ring != NULL) {
+      ReadRequest* batch[IoUring::kEntries];
+      size_t k = 0;
+      for (size_t i = 0; i < n; i++) {
+        ReadRequest* r = &requests[i];
+        if (static_cast<const PosixReadableFile*>(r->file)->fd() < 0) {
+          r->status = r->file->Read(r->offset, r->n, &r->result, r->scratch);
+          continue;
+        }
+        batch[k++] = r;
+        if (k == IoUring::kEntries) {
+          ring->Read(batch, k);
+          k = 0;
+        }
       }
-    } else {
-      *result = new PosixRandomAccessFile(fname, fd, &fd_limit_);
+      if (k > 0) {
+        ring->Read(batch, k);
+      }
+      return;
     }
-    return s;
+#endif
+    Env::MultiRead(requests, n);
   }
 
   virtual Status NewWritableFile(const std::string& fname,
@@ -542,6 +1069,34 @@ class PosixEnv : public Env {
   }
 
  private:
+  // Maps the file into memory if use_mmap is true, in which case
+  // mmap_limiter, if non-NULL, is released when it is unmapped.
+  Status OpenRandomAccessFile(const std::string& fname, bool use_mmap,
+                              Limiter* mmap_limiter,
+                              RandomAccessFile** result) {
+    *result = NULL;
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return IOError(fname, errno);
+    }
+    if (!use_mmap) {
+      *result = new PosixRandomAccessFile(fname, fd, false, &fd_limit_);
+      return Status::OK();
+    }
+    uint64_t size;
+    Status s = GetFileSize(fname, &size);
+    if (s.ok()) {
+      void* base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+      if (base != MAP_FAILED) {
+        *result = new PosixMmapReadableFile(fname, base, size, mmap_limiter);
+      } else {
+        s = IOError(fname, errno);
+      }
+    }
+    close(fd);
+    return s;
+  }
+
   void PthreadCall(const char* label, int result) {
     if (result != 0) {
       fprintf(stderr, "pthread %s: %s\n", label, strerror(result));
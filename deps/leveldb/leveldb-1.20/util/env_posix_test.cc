@@ -56,6 +56,153 @@ TEST(EnvPosixTest, TestOpenOnRead) {
   ASSERT_OK(env_->DeleteFile(test_file));
 }
 
+TEST(EnvPosixTest, TestOpenWithMmap) {
+  std::string test_dir;
+  ASSERT_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file = test_dir + "/open_with_mmap.txt";
+  const char kFileData[] = "abcdefghijklmnopqrstuvwxyz";
+  ASSERT_OK(WriteStringToFile(env_, kFileData, test_file));
+
+  // Files are mapped or not as asked, regardless of the mmap limit
+  const int kNumFiles = kMMapLimit + 2;
+  leveldb::RandomAccessFile* mapped[kNumFiles] = {0};
+  leveldb::RandomAccessFile* unmapped[kNumFiles] = {0};
+  for (int i = 0; i < kNumFiles; i++) {
+    ASSERT_OK(env_->NewRandomAccessFileWithMmap(test_file, true, &mapped[i]));
+    ASSERT_OK(env_->NewRandomAccessFileWithMmap(test_file, false,
+                                                &unmapped[i]));
+  }
+  char scratch;
+  Slice read_result;
+  for (int i = 0; i < kNumFiles; i++) {
+    ASSERT_TRUE(mapped[i]->IsMapped());
+    ASSERT_TRUE(!unmapped[i]->IsMapped());
+    mapped[i]->Hint(RandomAccessFile::kRandom);
+    unmapped[i]->Hint(RandomAccessFile::kSequential);
+    ASSERT_OK(mapped[i]->Read(i, 1, &read_result, &scratch));
+    ASSERT_EQ(kFileData[i], read_result[0]);
+    ASSERT_TRUE(read_result.data() != &scratch);
+    ASSERT_OK(unmapped[i]->Read(i, 1, &read_result, &scratch));
+    ASSERT_EQ(kFileData[i], read_result[0]);
+    ASSERT_TRUE(read_result.data() == &scratch);
+  }
+  for (int i = 0; i < kNumFiles; i++) {
+    delete mapped[i];
+    delete unmapped[i];
+  }
+
+  // Which left the limit as it was
+  leveldb::RandomAccessFile* files[kMMapLimit + 1] = {0};
+  for (int i = 0; i <= kMMapLimit; i++) {
+    ASSERT_OK(env_->NewRandomAccessFile(test_file, &files[i]));
+    ASSERT_OK(files[i]->Read(0, 1, &read_result, &scratch));
+    ASSERT_EQ(i < kMMapLimit, read_result.data() != &scratch);
+  }
+  for (int i = 0; i <= kMMapLimit; i++) {
+    delete files[i];
+  }
+  ASSERT_OK(env_->DeleteFile(test_file));
+}
+
+TEST(EnvPosixTest, TestMultiRead) {
+  std::string test_dir;
+  ASSERT_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file = test_dir + "/multi_read.txt";
+  std::string data;
+  for (int i = 0; i < 10000; i++) {
+    data.push_back(static_cast<char>('a' + i % 26));
+  }
+  ASSERT_OK(WriteStringToFile(env_, data, test_file));
+
+  // Mapped files, files with a descriptor and, past the descriptor limit,
+  // files that open one on every read
+  const int kNumFiles = kReadOnlyFileLimit + 3;
+  leveldb::RandomAccessFile* files[kNumFiles + 1] = {0};
+  ASSERT_OK(env_->NewRandomAccessFileWithMmap(test_file, true, &files[0]));
+  for (int i = 1; i <= kNumFiles; i++) {
+    ASSERT_OK(env_->NewRandomAccessFileWithMmap(test_file, false, &files[i]));
+  }
+
+  // More reads than fit in one submission, the last of them running past
+  // the end of the file
+  const int kNumReads = 150;
+  std::vector<ReadRequest> requests(kNumReads);
+  std::vector<std::string> scratch(kNumReads, std::string(100, '\0'));
+  for (int i = 0; i < kNumReads; i++) {
+    requests[i].file = files[i % (kNumFiles + 1)];
+    requests[i].offset = (i * 61) % data.size();
+    requests[i].n = 100;
+    requests[i].scratch = &scratch[i][0];
+  }
+  requests[kNumReads - 1].offset = data.size() - 10;
+  requests[kNumReads - 1].file = files[1];
+  env_->MultiRead(&requests[0], kNumReads);
+  for (int i = 0; i < kNumReads; i++) {
+    ASSERT_OK(requests[i].status);
+    ASSERT_EQ(data.substr(requests[i].offset, 100),
+              requests[i].result.ToString());
+  }
+  ASSERT_EQ(10, requests[kNumReads - 1].result.size());
+
+  for (int i = 0; i <= kNumFiles; i++) {
+    delete files[i];
+  }
+  ASSERT_OK(env_->DeleteFile(test_file));
+}
+
+TEST(EnvPosixTest, TestDirectIO) {
+  std::string test_dir;
+  ASSERT_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file = test_dir + "/direct_io.txt";
+
+  // Appends of odd sizes, synced part way, across several buffer fills
+  std::string data;
+  WritableFile* writable;
+  ASSERT_OK(env_->NewWritableFileWithDirectIO(test_file, &writable));
+  for (int i = 0; data.size() < 3000000; i++) {
+    std::string piece(i * 37 % 10000, static_cast<char>('a' + i % 26));
+    ASSERT_OK(writable->Append(piece));
+    ASSERT_OK(writable->Flush());
+    data += piece;
+    if (i % 50 == 7) {
+      ASSERT_OK(writable->Sync());
+    }
+  }
+  ASSERT_OK(writable->Close());
+  delete writable;
+
+  uint64_t size;
+  ASSERT_OK(env_->GetFileSize(test_file, &size));
+  ASSERT_EQ(data.size(), size);
+  std::string contents;
+  ASSERT_OK(ReadFileToString(env_, test_file, &contents));
+  ASSERT_TRUE(contents == data);
+
+  // Reads at unaligned offsets, and up to and past the end of the file
+  RandomAccessFile* file;
+  ASSERT_OK(env_->NewRandomAccessFileWithDirectIO(test_file, &file));
+  std::string scratch(10000, '\0');
+  Slice result;
+  const uint64_t offsets[] = { 0, 1, 4095, 4096, 123457, data.size() - 5000 };
+  for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+    ASSERT_OK(file->Read(offsets[i], 5000, &result, &scratch[0]));
+    ASSERT_EQ(data.substr(offsets[i], 5000), result.ToString());
+  }
+  // Reads that grow the reused buffer, exceed its limit and shrink again
+  const size_t sizes[] = { 100, 70000, 1000000, 200 };
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    std::string big(sizes[i], '\0');
+    ASSERT_OK(file->Read(777, sizes[i], &result, &big[0]));
+    ASSERT_EQ(data.substr(777, sizes[i]), result.ToString());
+  }
+  ASSERT_OK(file->Read(data.size() - 10, 5000, &result, &scratch[0]));
+  ASSERT_EQ(data.substr(data.size() - 10), result.ToString());
+  ASSERT_OK(file->Read(data.size() + 10, 5000, &result, &scratch[0]));
+  ASSERT_EQ(0, result.size());
+  delete file;
+  ASSERT_OK(env_->DeleteFile(test_file));
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
@@ -0,0 +1,134 @@
+// Microbenchmark of the builtin filter policies.  For each policy, builds
+// filters for sets of keys of increasing size and reports the filter size
+// in bits per key, the false positive rate and the cost of a lookup of a
+// present and a missing key.  Not part of the library; build with e.g.:
+//
+//   c++ -O2 -std=c++11 -DLEVELDB_PLATFORM_POSIX -I. -Iinclude \
+//     util/filter_bench.cc util/bloom.cc util/blocked_bloom.cc util/ribbon.cc \
+//     util/filter_policy.cc util/hash.cc util/coding.cc -o filter_bench
+//
+// Flags:
+//   --bits_per_key=N   Bits per key to pass to the policies (default 10)
+//   --lookups=N        Number of lookups per measurement (default 1000000)
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "leveldb/filter_policy.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+namespace {
+
+static int FLAGS_bits_per_key = 10;
+static int FLAGS_lookups = 1000000;
+
+struct PolicyInfo {
+  const char* name;
+  const FilterPolicy* (*factory)(int bits_per_key);
+};
+
+static const PolicyInfo kPolicies[] = {
+  { "bloom", NewBloomFilterPolicy },
+  { "blocked-bloom", NewBlockedBloomFilterPolicy },
+  { "ribbon", NewRibbonFilterPolicy },
+};
+
+static std::string Key(int i, bool present) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%c%015d", present ? 'k' : 'm', i);
+  return buf;
+}
+
+static double NowNanos() {
+  return static_cast<double>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Returns the number of matches, which also prevents the compiler from
+// optimizing the lookups away
+static int Probe(const FilterPolicy* policy, const std::string& filter,
+                 const std::vector<std::string>& keys, double* nanos) {
+  int matches = 0;
+  const double start = NowNanos();
+  for (int i = 0; i < FLAGS_lookups; i++) {
+    const std::string& key = keys[i % keys.size()];
+    if (policy->KeyMayMatch(key, filter)) matches++;
+  }
+  *nanos = (NowNanos() - start) / FLAGS_lookups;
+  return matches;
+}
+
+static void Run(const PolicyInfo& info, int n) {
+  const FilterPolicy* policy = info.factory(FLAGS_bits_per_key);
+
+  std::vector<std::string> present;
+  std::vector<std::string> missing;
+  std::vector<Slice> slices;
+  for (int i = 0; i < n; i++) {
+    present.push_back(Key(i, true));
+  }
+  for (int i = 0; i < n; i++) {
+    slices.push_back(Slice(present[i]));
+  }
+  for (int i = 0; i < FLAGS_lookups && i < 1000000; i++) {
+    missing.push_back(Key(i, false));
+  }
+
+  std::string filter;
+  policy->CreateFilter(&slices[0], n, &filter);
+
+  double present_nanos, missing_nanos;
+  const int hits = Probe(policy, filter, present, &present_nanos);
+  const int false_positives = Probe(policy, filter, missing, &missing_nanos);
+
+  if (hits != FLAGS_lookups) {
+    fprintf(stderr, "%s: false negatives!\n", info.name);
+    exit(1);
+  }
+
+  fprintf(stdout, "%-14s %10d %9.2f %8.3f%% %9.1f %9.1f\n",
+          info.name, n, filter.size() * 8.0 / n,
+          100.0 * false_positives / FLAGS_lookups,
+          present_nanos, missing_nanos);
+
+  delete policy;
+}
+
+}  // namespace
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    int n;
+    char junk;
+    if (sscanf(argv[i], "--bits_per_key=%d%c", &n, &junk) == 1) {
+      leveldb::FLAGS_bits_per_key = n;
+    } else if (sscanf(argv[i], "--lookups=%d%c", &n, &junk) == 1 && n > 0) {
+      leveldb::FLAGS_lookups = n;
+    } else {
+      fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+      exit(1);
+    }
+  }
+
+  fprintf(stdout, "Bits per key: %d\n", leveldb::FLAGS_bits_per_key);
+  fprintf(stdout, "%-14s %10s %9s %9s %9s %9s\n",
+          "Policy", "Keys", "Bits/key", "FP rate", "Hit ns", "Miss ns");
+
+  const int sizes[] = { 100, 10000, 1000000 };
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    for (size_t p = 0;
+         p < sizeof(leveldb::kPolicies) / sizeof(leveldb::kPolicies[0]); p++) {
+      leveldb::Run(leveldb::kPolicies[p], sizes[s]);
+    }
+  }
+
+  return 0;
+}
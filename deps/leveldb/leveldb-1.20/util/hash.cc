@@ -8,10 +8,17 @@
 
 // The FALLTHROUGH_INTENDED macro can be used to annotate implicit fall-through
 // between switch labels. The real definition should be provided externally.
-// This one is a fallback version for unsupported compilers.
+// This one is a fallback version, which uses the attribute of compilers
+// that warn about implicit fall-through.
 #ifndef FALLTHROUGH_INTENDED
+#if defined(__clang__)
+#define FALLTHROUGH_INTENDED [[clang::fallthrough]]
+#elif defined(__GNUC__) && __GNUC__ >= 7
+#define FALLTHROUGH_INTENDED __attribute__((fallthrough))
+#else
 #define FALLTHROUGH_INTENDED do { } while (0)
 #endif
+#endif
 
 namespace leveldb {
 
@@ -48,5 +55,54 @@ uint32_t Hash(const char* data, size_t n, uint32_t seed) {
   return h;
 }
 
+uint64_t Hash64(const char* data, size_t n, uint64_t seed) {
+  // Similar to murmur hash 64A
+  const uint64_t m = 0xc6a4a7935bd1e995ull;
+  const int r = 47;
+  const char* limit = data + n;
+  uint64_t h = seed ^ (n * m);
+
+  // Pick up eight bytes at a time
+  while (data + 8 <= limit) {
+    uint64_t w = DecodeFixed64(data);
+    data += 8;
+    w *= m;
+    w ^= (w >> r);
+    w *= m;
+    h ^= w;
+    h *= m;
+  }
+
+  // Pick up remaining bytes
+  switch (limit - data) {
+    case 7:
+      h ^= static_cast<uint64_t>(static_cast<unsigned char>(data[6])) << 48;
+      FALLTHROUGH_INTENDED;
+    case 6:
+      h ^= static_cast<uint64_t>(static_cast<unsigned char>(data[5])) << 40;
+      FALLTHROUGH_INTENDED;
+    case 5:
+      h ^= static_cast<uint64_t>(static_cast<unsigned char>(data[4])) << 32;
+      FALLTHROUGH_INTENDED;
+    case 4:
+      h ^= static_cast<uint64_t>(static_cast<unsigned char>(data[3])) << 24;
+      FALLTHROUGH_INTENDED;
+    case 3:
+      h ^= static_cast<uint64_t>(static_cast<unsigned char>(data[2])) << 16;
+      FALLTHROUGH_INTENDED;
+    case 2:
+      h ^= static_cast<uint64_t>(static_cast<unsigned char>(data[1])) << 8;
+      FALLTHROUGH_INTENDED;
+    case 1:
+      h ^= static_cast<uint64_t>(static_cast<unsigned char>(data[0]));
+      h *= m;
+      break;
+  }
+
+  h ^= (h >> r);
+  h *= m;
+  h ^= (h >> r);
+  return h;
+}
 
 }  // namespace leveldb
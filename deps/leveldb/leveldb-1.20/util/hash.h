@@ -14,6 +14,10 @@ namespace leveldb {
 
 extern uint32_t Hash(const char* data, size_t n, uint32_t seed);
 
+// Similar to Hash() but picks up eight bytes at a time and returns a
+// 64-bit hash, for data structures that need more bits per key.
+extern uint64_t Hash64(const char* data, size_t n, uint64_t seed);
+
 }
 
 #endif  // STORAGE_LEVELDB_UTIL_HASH_H_
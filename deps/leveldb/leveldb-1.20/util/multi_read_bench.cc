@@ -0,0 +1,146 @@
+// Microbenchmark of random reads from a file that is not mapped into
+// memory: one RandomAccessFile::Read() at a time (queue depth 1) against
+// batches of reads passed to Env::MultiRead(), which the POSIX Env issues
+// through io_uring where available.  Reads are served from the page cache
+// unless the file is larger than memory or caches are dropped between
+// runs.  Not part of the library; build with e.g.:
+//
+//   c++ -O2 -std=c++11 -DLEVELDB_PLATFORM_POSIX -DOS_LINUX -I. -Iinclude \
+//     util/multi_read_bench.cc util/env.cc util/env_posix.cc \
+//     util/status.cc port/port_posix.cc -lpthread -o multi_read_bench
+//
+// Flags:
+//   --file_size=N   Size of the file read, in MB (default 256)
+//   --block_size=N  Size of each read, in bytes (default 4096)
+//   --reads=N       Number of reads per measurement (default 100000)
+//   --max_batch=N   Largest batch passed to MultiRead() (default 64)
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "leveldb/env.h"
+#include "leveldb/slice.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+namespace {
+
+static int FLAGS_file_size = 256;
+static int FLAGS_block_size = 4096;
+static int FLAGS_reads = 100000;
+static int FLAGS_max_batch = 64;
+
+static double NowNanos() {
+  return static_cast<double>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void Check(const Status& s) {
+  if (!s.ok()) {
+    fprintf(stderr, "%s\n", s.ToString().c_str());
+    exit(1);
+  }
+}
+
+static void WriteFile(Env* env, const std::string& fname) {
+  WritableFile* file;
+  Check(env->NewWritableFile(fname, &file));
+  std::string chunk(1 << 20, '\0');
+  Random rnd(301);
+  for (int i = 0; i < FLAGS_file_size; i++) {
+    for (size_t j = 0; j < chunk.size(); j++) {
+      chunk[j] = static_cast<char>(rnd.Next());
+    }
+    Check(file->Append(chunk));
+  }
+  Check(file->Close());
+  delete file;
+}
+
+// Reads FLAGS_reads blocks at random offsets, batch at a time, or one at a
+// time with Read() if batch is 0, and reports the cost per read
+static void Run(Env* env, RandomAccessFile* file, int batch) {
+  const uint64_t blocks =
+      (static_cast<uint64_t>(FLAGS_file_size) << 20) / FLAGS_block_size;
+  const int n = (batch == 0) ? 1 : batch;
+  std::vector<std::string> scratch(n, std::string(FLAGS_block_size, '\0'));
+  std::vector<ReadRequest> requests(n);
+  Random rnd(batch + 1);
+  size_t bytes = 0;
+
+  const double start = NowNanos();
+  for (int done = 0; done < FLAGS_reads; done += n) {
+    for (int i = 0; i < n; i++) {
+      requests[i].file = file;
+      requests[i].offset = (rnd.Next() % blocks) * FLAGS_block_size;
+      requests[i].n = FLAGS_block_size;
+      requests[i].scratch = &scratch[i][0];
+    }
+    if (batch == 0) {
+      ReadRequest* r = &requests[0];
+      r->status = file->Read(r->offset, r->n, &r->result, r->scratch);
+    } else {
+      env->MultiRead(&requests[0], n);
+    }
+    for (int i = 0; i < n; i++) {
+      Check(requests[i].status);
+      bytes += requests[i].result.size();
+    }
+  }
+  const double nanos = NowNanos() - start;
+
+  const int reads = (FLAGS_reads + n - 1) / n * n;
+  fprintf(stdout, "%-10s %6d %10.2f %10.1f\n",
+          batch == 0 ? "read" : "multiread", n, nanos / reads / 1000.0,
+          bytes / (nanos / 1e9) / 1048576.0);
+}
+
+}  // namespace
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    int n;
+    char junk;
+    if (sscanf(argv[i], "--file_size=%d%c", &n, &junk) == 1 && n > 0) {
+      leveldb::FLAGS_file_size = n;
+    } else if (sscanf(argv[i], "--block_size=%d%c", &n, &junk) == 1 &&
+               n > 0) {
+      leveldb::FLAGS_block_size = n;
+    } else if (sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1 && n > 0) {
+      leveldb::FLAGS_reads = n;
+    } else if (sscanf(argv[i], "--max_batch=%d%c", &n, &junk) == 1 &&
+               n > 0) {
+      leveldb::FLAGS_max_batch = n;
+    } else {
+      fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+      exit(1);
+    }
+  }
+
+  leveldb::Env* env = leveldb::Env::Default();
+  std::string fname;
+  leveldb::Check(env->GetTestDirectory(&fname));
+  fname += "/multi_read_bench.dat";
+  leveldb::WriteFile(env, fname);
+  leveldb::RandomAccessFile* file;
+  leveldb::Check(env->NewRandomAccessFileWithMmap(fname, false, &file));
+  file->Hint(leveldb::RandomAccessFile::kRandom);
+
+  fprintf(stdout, "File: %d MB, reads of %d bytes\n",
+          leveldb::FLAGS_file_size, leveldb::FLAGS_block_size);
+  fprintf(stdout, "%-10s %6s %10s %10s\n", "Mode", "Batch", "us/read", "MB/s");
+  leveldb::Run(env, file, 0);
+  for (int batch = 1; batch <= leveldb::FLAGS_max_batch; batch *= 4) {
+    leveldb::Run(env, file, batch);
+  }
+
+  delete file;
+  env->DeleteFile(fname);
+  return 0;
+}
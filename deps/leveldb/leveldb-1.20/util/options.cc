@@ -18,13 +18,26 @@ Options::Options()
       info_log(NULL),
       write_buffer_size(4<<20),
       max_open_files(1000),
+      mmap_reads(false),
+      max_mmap_files(1000),
+      use_direct_io(false),
       block_cache(NULL),
+      compressed_block_cache(NULL),
+      row_cache(NULL),
+      negative_cache_entries(0),
       block_size(4096),
       block_restart_interval(16),
       max_file_size(2<<20),
       compression(kSnappyCompression),
+      compression_dictionary_size(0),
+      compression_threads(0),
       reuse_logs(false),
-      filter_policy(NULL) {
+      filter_policy(NULL),
+      whole_table_filter(false),
+      cache_index_and_filter_blocks(false),
+      index_partition_size(0),
+      data_block_hash_index(false),
+      cache_decoded_blocks(false) {
 }
 
 }  // namespace leveldb
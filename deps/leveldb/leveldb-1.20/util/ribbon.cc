@@ -0,0 +1,220 @@
+// A standard Ribbon filter (Dillinger & Walzer, "Ribbon filter: practically
+// smaller than Bloom and Xor") with a coefficient width of 64.  Each key is
+// hashed to a start row s, a 64-bit coefficient row c (whose lowest bit is
+// set) and an r-bit result.  Building solves the banded linear system over
+// GF(2) in which, for every key, the XOR of the solution rows s+k for each
+// bit k set in c equals its result.  A lookup recomputes that XOR and
+// compares it with the result of the key being looked up, which matches by
+// chance with probability 2^-r.
+//
+// The solution is stored interleaved: for each block of 64 rows, r words in
+// which word j holds bit j of the solution of each row.  A lookup thus
+// reads two adjacent blocks of r words.
+//
+// Filter layout:
+//   [solution: blocks * r * 8 bytes][seed: 1 byte][r: 1 byte]
+
+#include "leveldb/filter_policy.h"
+
+#include <vector>
+#include "leveldb/slice.h"
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace leveldb {
+
+namespace {
+static const size_t kRibbonWidth = 64;
+static const uint64_t kSeedBase = 0x4b5d1c8a7f3e2961ull;
+static const uint64_t kCoeffMultiplier = 0x9e3779b97f4a7c15ull;
+static const uint64_t kResultMultiplier = 0xc2b2ae3d27d4eb4full;
+
+// Number of seeds to try before adding rows to the system
+static const int kSeedsPerSize = 4;
+static const int kMaxAttempts = 64;
+
+static inline int Parity(uint64_t x) {
+#if defined(__GNUC__)
+  return __builtin_parityll(x);
+#else
+  x ^= x >> 32;
+  x ^= x >> 16;
+  x ^= x >> 8;
+  x ^= x >> 4;
+  x ^= x >> 2;
+  x ^= x >> 1;
+  return static_cast<int>(x & 1);
+#endif
+}
+
+static inline int CountTrailingZeros(uint64_t x) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(x);
+#else
+  int n = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+struct RibbonRow {
+  size_t start;
+  uint64_t coeff;
+  uint32_t result;
+};
+
+static inline RibbonRow HashToRow(const Slice& key, uint8_t seed,
+                                  size_t starts, int result_bits) {
+  const uint64_t h = Hash64(key.data(), key.size(), kSeedBase + seed);
+  RibbonRow row;
+  row.start = static_cast<size_t>(((h >> 32) * starts) >> 32);
+  row.coeff = (h * kCoeffMultiplier) | 1;
+  row.result = static_cast<uint32_t>((h * kResultMultiplier) >> 32) &
+               (0xffffffffu >> (32 - result_bits));
+  return row;
+}
+
+class RibbonFilterPolicy : public FilterPolicy {
+ private:
+  int result_bits_;
+
+  // Solve the system for the given number of rows and seed.  Returns false
+  // if two keys conflict, in which case a different seed or size is needed.
+  bool Solve(const Slice* keys, int n, size_t rows, uint8_t seed,
+             char* array) const {
+    std::vector<uint64_t> coeffs(rows, 0);
+    std::vector<uint32_t> results(rows, 0);
+    const size_t starts = rows - kRibbonWidth + 1;
+
+    // Gaussian elimination on the fly, keeping the system in row echelon
+    // form where row i, if present, has its lowest coefficient bit at i
+    for (int k = 0; k < n; k++) {
+      RibbonRow row = HashToRow(keys[k], seed, starts, result_bits_);
+      size_t i = row.start;
+      uint64_t c = row.coeff;
+      uint32_t r = row.result;
+      for (;;) {
+        if (coeffs[i] == 0) {
+          coeffs[i] = c;
+          results[i] = r;
+          break;
+        }
+        c ^= coeffs[i];
+        r ^= results[i];
+        if (c == 0) {
+          // A duplicate key is redundant, anything else is a conflict
+          if (r == 0) break;
+          return false;
+        }
+        const int shift = CountTrailingZeros(c);
+        i += shift;
+        c >>= shift;
+      }
+    }
+
+    // Back substitution, from the last row to the first. Word j of state
+    // holds bit j of the solution of the current row and the 63 after it.
+    uint64_t state[32] = { 0 };
+    for (size_t i = rows; i-- > 0; ) {
+      const uint64_t c = coeffs[i];
+      const uint32_t r = results[i];
+      for (int j = 0; j < result_bits_; j++) {
+        state[j] <<= 1;
+        state[j] |= static_cast<uint64_t>(((r >> j) & 1) ^ Parity(c & state[j]));
+      }
+      if (i % kRibbonWidth == 0) {
+        char* block = array + (i / kRibbonWidth) * result_bits_ * 8;
+        for (int j = 0; j < result_bits_; j++) {
+          EncodeFixed64(block + j * 8, state[j]);
+        }
+      }
+    }
+
+    return true;
+  }
+
+ public:
+  explicit RibbonFilterPolicy(int bits_per_key) {
+    // Match the false positive rate of a bloom filter with the same
+    // bits_per_key, which is about 2^-(bits_per_key * ln(2))
+    result_bits_ = static_cast<int>(bits_per_key * 0.69 + 0.5);
+    if (result_bits_ < 1) result_bits_ = 1;
+    if (result_bits_ > 32) result_bits_ = 32;
+  }
+
+  virtual const char* Name() const {
+    return "leveldb.RibbonFilter";
+  }
+
+  virtual void CreateFilter(const Slice* keys, int n, std::string* dst) const {
+    // Start with about 3% more rows than keys, rounded up to whole blocks
+    size_t rows = n + n / 32 + 1;
+
+    for (int attempt = 0; attempt < kMaxAttempts; attempt++) {
+      if (attempt > 0 && attempt % kSeedsPerSize == 0) {
+        rows += rows / 32;
+      }
+      rows = (rows + kRibbonWidth - 1) / kRibbonWidth * kRibbonWidth;
+
+      const size_t bytes = rows / kRibbonWidth * result_bits_ * 8;
+      const size_t init_size = dst->size();
+      dst->resize(init_size + bytes, 0);
+
+      const uint8_t seed = static_cast<uint8_t>(attempt);
+      if (Solve(keys, n, rows, seed, &(*dst)[init_size])) {
+        dst->push_back(static_cast<char>(seed));
+        dst->push_back(static_cast<char>(result_bits_));
+        return;
+      }
+
+      dst->resize(init_size);
+    }
+
+    // Give up and write an empty filter that matches every key
+    dst->push_back(0);
+    dst->push_back(0);
+  }
+
+  virtual bool KeyMayMatch(const Slice& key, const Slice& ribbon_filter) const {
+    const size_t len = ribbon_filter.size();
+    if (len < 2) return false;
+
+    const char* array = ribbon_filter.data();
+    const uint8_t seed = static_cast<uint8_t>(array[len-2]);
+    const int result_bits = static_cast<uint8_t>(array[len-1]);
+    const size_t block_bytes = static_cast<size_t>(result_bits) * 8;
+    if (result_bits < 1 || result_bits > 32 || len == 2 ||
+        (len - 2) % block_bytes != 0) {
+      // Reserved for potentially new encodings, or a filter that could not
+      // be built. Consider it a match.
+      return true;
+    }
+
+    const size_t rows = (len - 2) / block_bytes * kRibbonWidth;
+    const RibbonRow row =
+        HashToRow(key, seed, rows - kRibbonWidth + 1, result_bits);
+    const size_t offset = row.start % kRibbonWidth;
+    const char* block = array + (row.start / kRibbonWidth) * block_bytes;
+
+    uint32_t result = 0;
+    for (int j = 0; j < result_bits; j++) {
+      uint64_t window = DecodeFixed64(block + j * 8) >> offset;
+      if (offset > 0) {
+        window |= DecodeFixed64(block + block_bytes + j * 8) <<
+                  (kRibbonWidth - offset);
+      }
+      result |= static_cast<uint32_t>(Parity(row.coeff & window)) << j;
+    }
+    return result == row.result;
+  }
+};
+}
+
+const FilterPolicy* NewRibbonFilterPolicy(int bits_per_key) {
+  return new RibbonFilterPolicy(bits_per_key);
+}
+
+}  // namespace leveldb
@@ -1,7 +1,13 @@
 {
   "variables": {
     'openssl_fips': '',
-    'android_ndk_path': ''
+    'android_ndk_path': '',
+
+    # Set to 'true' to support LZ4 and Zstandard block compression, linked
+    # against the system liblz4 and libzstd. For example:
+    # npx node-gyp rebuild --leveldb_lz4=true --leveldb_zstd=true
+    'leveldb_lz4%': 'false',
+    'leveldb_zstd%': 'false'
   },
   "targets": [{
     "target_name": "leveldb",
@@ -194,6 +200,34 @@
         "cflags": [
           "-mfloat-abi=hard"
         ]
+      }],
+      ["leveldb_lz4 == 'true'", {
+        "defines": [
+          "LZ4=1"
+        ],
+        "link_settings": {
+          "libraries": [
+            "-llz4"
+          ]
+        }
+      }],
+      ["leveldb_zstd == 'true'", {
+        "defines": [
+          "ZSTD=1"
+        ],
+        "link_settings": {
+          "libraries": [
+            "-lzstd"
+          ]
+        }
+      }],
+      ["target_arch == 'x64' or target_arch == 'ia32'", {
+        # Hardware crc32c. The SSE 4.2 and PCLMUL code in port_posix_sse.cc
+        # is compiled with function target attributes and only used if the
+        # CPU supports it, so no -msse4.2 here.
+        "defines": [
+          "LEVELDB_PLATFORM_POSIX_SSE=1"
+        ]
       }]
     ],
     "sources": [
@@ -214,6 +248,8 @@
       "leveldb-<(ldbversion)/db/log_writer.h",
       "leveldb-<(ldbversion)/db/memtable.cc",
       "leveldb-<(ldbversion)/db/memtable.h",
+      "leveldb-<(ldbversion)/db/negative_cache.cc",
+      "leveldb-<(ldbversion)/db/negative_cache.h",
       "leveldb-<(ldbversion)/db/repair.cc",
       "leveldb-<(ldbversion)/db/skiplist.h",
       "leveldb-<(ldbversion)/db/snapshot.h",
@@ -229,6 +265,7 @@
       "leveldb-<(ldbversion)/helpers/memenv/memenv.h",
       "leveldb-<(ldbversion)/include/leveldb/cache.h",
       "leveldb-<(ldbversion)/include/leveldb/comparator.h",
+      "leveldb-<(ldbversion)/include/leveldb/compressor.h",
       "leveldb-<(ldbversion)/include/leveldb/db.h",
       "leveldb-<(ldbversion)/include/leveldb/dumpfile.h",
       "leveldb-<(ldbversion)/include/leveldb/env.h",
@@ -246,6 +283,10 @@
       "leveldb-<(ldbversion)/table/block.h",
       "leveldb-<(ldbversion)/table/block_builder.cc",
       "leveldb-<(ldbversion)/table/block_builder.h",
+      "leveldb-<(ldbversion)/table/compression_pool.cc",
+      "leveldb-<(ldbversion)/table/compression_pool.h",
+      "leveldb-<(ldbversion)/table/decoded_block.cc",
+      "leveldb-<(ldbversion)/table/decoded_block.h",
       "leveldb-<(ldbversion)/table/filter_block.cc",
       "leveldb-<(ldbversion)/table/filter_block.h",
       "leveldb-<(ldbversion)/table/format.cc",
@@ -260,11 +301,13 @@
       "leveldb-<(ldbversion)/table/two_level_iterator.h",
       "leveldb-<(ldbversion)/util/arena.cc",
       "leveldb-<(ldbversion)/util/arena.h",
+      "leveldb-<(ldbversion)/util/blocked_bloom.cc",
       "leveldb-<(ldbversion)/util/bloom.cc",
       "leveldb-<(ldbversion)/util/cache.cc",
       "leveldb-<(ldbversion)/util/coding.cc",
       "leveldb-<(ldbversion)/util/coding.h",
       "leveldb-<(ldbversion)/util/comparator.cc",
+      "leveldb-<(ldbversion)/util/compressor.cc",
       "leveldb-<(ldbversion)/util/crc32c.cc",
       "leveldb-<(ldbversion)/util/crc32c.h",
       "leveldb-<(ldbversion)/util/env.cc",
@@ -275,6 +318,7 @@
       "leveldb-<(ldbversion)/util/logging.h",
       "leveldb-<(ldbversion)/util/mutexlock.h",
       "leveldb-<(ldbversion)/util/options.cc",
+      "leveldb-<(ldbversion)/util/ribbon.cc",
       "leveldb-<(ldbversion)/util/random.h",
       "leveldb-<(ldbversion)/util/status.cc"
     ]
@@ -151,6 +151,8 @@ inline bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg) {
 
 uint32_t AcceleratedCRC32C(uint32_t crc, const char* buf, size_t size);
 
+size_t CountLessThan(const uint64_t* array, size_t n, uint64_t value);
+
 } // namespace port
 } // namespace leveldb
 
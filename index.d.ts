@@ -98,7 +98,7 @@ declare class ClassicLevel<KDefault = string, VDefault = string>
    * Manually trigger a database compaction in the range `[start..end)`.
    */
   compactRange (start: KDefault, end: KDefault): Promise<void>
-  compactRange<K = KDefault> (start: K, end: K, options: StartEndOptions<K>): Promise<void>
+  compactRange<K = KDefault> (start: K, end: K, options: CompactRangeOptions<K>): Promise<void>
 
   /**
    * Get internal details from LevelDB.
@@ -133,9 +133,16 @@ export interface OpenOptions extends AbstractOpenOptions {
    * Snappy compression algorithm before being stored. Snappy is very fast so
    * leave this on unless you have good reason to turn it off.
    *
+   * Can also be the name of a compression algorithm: `'none'`, `'snappy'`,
+   * `'lz4'` or `'zstd'`. LZ4 is faster than Snappy, while Zstandard
+   * compresses about a third smaller at a higher CPU cost. These two are
+   * only available if `classic-level` was built with them, otherwise
+   * opening the database fails. Table files written with either remain
+   * readable only by such builds.
+   *
    * @defaultValue `true`
    */
-  compression?: boolean | undefined
+  compression?: boolean | 'none' | 'snappy' | 'lz4' | 'zstd' | undefined
 
   /**
    * The size (in bytes) of the in-memory
@@ -146,6 +153,85 @@ export interface OpenOptions extends AbstractOpenOptions {
    */
   cacheSize?: number | undefined
 
+  /**
+   * If `true`, the index and filter of each open table file are stored in the
+   * cache sized by `cacheSize` rather than held in memory for as long as the
+   * table file is open, so that `cacheSize` also bounds their memory usage.
+   *
+   * @defaultValue `false`
+   */
+  cacheIndexAndFilterBlocks?: boolean | undefined
+
+  /**
+   * If `true`, the first iterator that reads a block of a table file stores
+   * a decoded copy of it in the cache sized by `cacheSize`, with all keys
+   * written out in full, which makes later iteration over the block cheaper
+   * at the cost of memory.
+   *
+   * @defaultValue `false`
+   */
+  cacheDecodedBlocks?: boolean | undefined
+
+  /**
+   * The size (in bytes) of a second in-memory LRU cache with blocks as they
+   * are stored in table files, compressed. Reads that miss the cache sized
+   * by `cacheSize` look here before reading from disk, and then only have
+   * to decompress the block. Since compressed blocks are smaller, this
+   * holds more data in the same memory. Disabled if `0`.
+   *
+   * @defaultValue `0`
+   */
+  compressedCacheSize?: number | undefined
+
+  /**
+   * The size (in bytes) of an in-memory LRU cache with values of recently
+   * read keys, consulted by `get()` before the table files. Disabled if `0`.
+   * Entries are invalidated whenever the log is written to a table file, so
+   * it's most effective for read-mostly workloads.
+   *
+   * @defaultValue `0`
+   */
+  rowCacheSize?: number | undefined
+
+  /**
+   * The number of keys to remember that were found to not exist, so that
+   * repeated reads of missing keys are answered from memory. Each entry takes
+   * 24 bytes. Disabled if `0`. The hit rate is available through the
+   * `leveldb.negative-cache` property.
+   *
+   * @defaultValue `0`
+   */
+  negativeCacheSize?: number | undefined
+
+  /**
+   * The number of bits per key in the filter stored with each table file.
+   * More bits lower the false positive rate at the cost of memory and disk
+   * space. Disabled if `0`.
+   *
+   * @defaultValue `10`
+   */
+  filterBitsPerKey?: number | undefined
+
+  /**
+   * The type of filter stored with each table file. A `'blocked-bloom'`
+   * filter confines the probes for a key to a single cache line, which makes
+   * lookups faster at a slightly higher false positive rate. A `'ribbon'`
+   * filter takes about 25% less space than a bloom filter with the same false
+   * positive rate, but is slower to build.
+   *
+   * @defaultValue `'bloom'`
+   */
+  filterType?: 'bloom' | 'blocked-bloom' | 'ribbon' | undefined
+
+  /**
+   * If `true`, new table files get a single filter for all of their keys
+   * instead of one filter per 2 KB of data. It's checked once per table file
+   * before searching the table index, and uses its bits more efficiently.
+   *
+   * @defaultValue `false`
+   */
+  wholeTableFilter?: boolean | undefined
+
   /**
    * The maximum size (in bytes) of the log (in memory and stored in the `.log`
    * file on disk). Beyond this size, LevelDB will convert the log data to the
@@ -182,6 +268,34 @@ export interface OpenOptions extends AbstractOpenOptions {
    */
   maxOpenFiles?: number | undefined
 
+  /**
+   * If `true`, table files are mapped into memory (up to `maxMmapFiles` of
+   * them) and read from the page cache without copying. Uncompressed blocks
+   * are then not stored in the cache sized by `cacheSize`, so a small
+   * `cacheSize` will do.
+   *
+   * @defaultValue `false`
+   */
+  mmapReads?: boolean | undefined
+
+  /**
+   * The maximum number of table files to map into memory if `mmapReads` is
+   * `true`.
+   *
+   * @defaultValue `1000`
+   */
+  maxMmapFiles?: number | undefined
+
+  /**
+   * If `true`, table files are written and read with direct I/O, bypassing
+   * the page cache of the operating system, so that the cache sized by
+   * `cacheSize` is the only cache of their contents. Takes precedence over
+   * `mmapReads`.
+   *
+   * @defaultValue `false`
+   */
+  directIO?: boolean | undefined
+
   /**
    * The number of entries before restarting the "delta encoding" of keys
    * within blocks. Each "restart" point stores the full key for the entry,
@@ -195,6 +309,57 @@ export interface OpenOptions extends AbstractOpenOptions {
    */
   blockRestartInterval?: number | undefined
 
+  /**
+   * Per-level overrides of {@link compression} for the table files written
+   * to each of the 7 levels. Element `i` applies to level `i`, and the last
+   * element to the levels after it. Data in the first levels is rewritten
+   * soon, so compressing it mostly costs CPU, while the last levels hold most
+   * of the data.
+   *
+   * @defaultValue `undefined` (all levels use {@link compression})
+   */
+  compressionPerLevel?: Array<boolean | 'none' | 'snappy' | 'lz4' | 'zstd'> | undefined
+
+  /**
+   * Per-level overrides of {@link blockSize}, like
+   * {@link compressionPerLevel}.
+   *
+   * @defaultValue `undefined` (all levels use {@link blockSize})
+   */
+  blockSizePerLevel?: number[] | undefined
+
+  /**
+   * Per-level overrides of {@link blockRestartInterval}, like
+   * {@link compressionPerLevel}.
+   *
+   * @defaultValue `undefined` (all levels use {@link blockRestartInterval})
+   */
+  blockRestartIntervalPerLevel?: number[] | undefined
+
+  /**
+   * If non-zero, table files compressed with Zstandard get a dictionary of
+   * up to this many bytes, trained on their first blocks and stored in the
+   * file. This helps most when values are small and alike, such as JSON
+   * documents of a few hundred bytes. Writing a table file holds back about
+   * 100 times this size of data to train on, so pair it with
+   * {@link compressionPerLevel} to only use Zstandard for the last levels.
+   * Capped at 1 MB.
+   *
+   * @defaultValue `0`
+   */
+  compressionDictionarySize?: number | undefined
+
+  /**
+   * The number of threads that compress the blocks of the table files
+   * written by flushes and compactions, which otherwise compress them one
+   * at a time on a single thread. Worth setting with a slow
+   * {@link compression} such as `'zstd'` and idle CPU cores. The threads
+   * are shared by all databases in the process. At most 64.
+   *
+   * @defaultValue `0` (compress on the flush or compaction thread)
+   */
+  compressionThreads?: number | undefined
+
   /**
    * The maximum amount of bytes to write to a file before switching to a new
    * one. From LevelDB documentation:
@@ -209,6 +374,38 @@ export interface OpenOptions extends AbstractOpenOptions {
    */
   maxFileSize?: number | undefined
 
+  /**
+   * If non-zero, the index of new table files is split into partitions of
+   * approximately this many bytes, which are read when needed rather than
+   * when a table file is opened. Table files with a partitioned index can not
+   * be read by older versions of `classic-level`.
+   *
+   * @defaultValue `0`
+   */
+  indexPartitionSize?: number | undefined
+
+  /**
+   * If true, each data block of new table files gets a small hash table that
+   * maps keys to their restart interval, so that looking up an existing key
+   * can skip the binary search over the restart points of the block. Table
+   * files with this option can not be read by older versions of
+   * `classic-level`.
+   *
+   * @defaultValue `false`
+   */
+  dataBlockHashIndex?: boolean | undefined
+
+  /**
+   * If true, a get() joins a pending get() of the same key with the same
+   * options rather than doing its own lookup, as long as no writes completed
+   * in the meantime, including writes of other instances opened on the same
+   * location with `multithreading`. Gets that read from an explicit snapshot
+   * are not coalesced.
+   *
+   * @defaultValue `false`
+   */
+  coalesceGets?: boolean | undefined
+
   /**
    * Allows multi-threaded access to a single DB instance for sharing a DB
    * across multiple worker threads within the same process.
@@ -329,6 +526,47 @@ export interface StartEndOptions<K> {
   keyEncoding?: string | Transcoder.PartialEncoder<K> | undefined
 }
 
+/**
+ * Options for the {@link ClassicLevel.compactRange} method.
+ */
+export interface CompactRangeOptions<K> extends StartEndOptions<K> {
+  /**
+   * Abort the compaction. It stops before its next step, leaving the work
+   * done so far in place, and the promise is rejected with an `AbortError`.
+   */
+  signal?: AbortSignal | undefined
+
+  /**
+   * Function to call (without waiting) after each step of the compaction.
+   */
+  onProgress?: ((progress: CompactRangeProgress) => void) | undefined
+}
+
+/**
+ * Progress of a {@link ClassicLevel.compactRange} call.
+ */
+export interface CompactRangeProgress {
+  /**
+   * Number of levels that have been fully compacted.
+   */
+  levelsDone: number
+
+  /**
+   * Total number of levels to compact.
+   */
+  levelsTotal: number
+
+  /**
+   * Total size of table files read so far.
+   */
+  bytesRead: number
+
+  /**
+   * Total size of table files written so far.
+   */
+  bytesWritten: number
+}
+
 // Export remaining types so that consumers don't have to guess whether they're extended
 export type BatchOperation<TDatabase, K, V> = AbstractBatchOperation<TDatabase, K, V>
 
@@ -9,9 +9,12 @@ const { Iterator } = require('./iterator')
 
 const kContext = Symbol('context')
 const kLocation = Symbol('location')
+const filterTypes = new Set(['bloom', 'blocked-bloom', 'ribbon'])
+const compressionTypes = new Set(['none', 'snappy', 'lz4', 'zstd'])
 
 class ClassicLevel extends AbstractLevel {
   #sharedBuffer = null
+  #nextCompactionId = 0
 
   constructor (location, options) {
     if (typeof location !== 'string' || location === '') {
@@ -47,6 +50,25 @@ class ClassicLevel extends AbstractLevel {
   }
 
   async _open (options) {
+    if (options.filterType != null && !filterTypes.has(options.filterType)) {
+      throw new TypeError(`The 'filterType' option must be one of: ${[...filterTypes].join(', ')}`)
+    }
+
+    if (options.compression != null && !isCompression(options.compression)) {
+      throw new TypeError(`The 'compression' option must be a boolean or one of: ${[...compressionTypes].join(', ')}`)
+    }
+
+    if (options.compressionPerLevel != null &&
+      (!Array.isArray(options.compressionPerLevel) || !options.compressionPerLevel.every(isCompression))) {
+      throw new TypeError("The 'compressionPerLevel' option must be an array of values for the 'compression' option")
+    }
+
+    for (const name of ['blockSizePerLevel', 'blockRestartIntervalPerLevel']) {
+      if (options[name] != null && (!Array.isArray(options[name]) || !options[name].every(isPositiveInteger))) {
+        throw new TypeError(`The '${name}' option must be an array of positive integers`)
+      }
+    }
+
     if (options.createIfMissing) {
       await fsp.mkdir(this[kLocation], { recursive: true })
     }
@@ -237,9 +259,35 @@ class ClassicLevel extends AbstractLevel {
       })
     } else {
       const keyEncoding = this.keyEncoding(options && options.keyEncoding)
+      const signal = options && options.signal != null ? options.signal : null
+      const onProgress = options && typeof options.onProgress === 'function' ? options.onProgress : null
+
+      if (signal !== null && signal.aborted) {
+        throw new ModuleError('Operation has been aborted', {
+          code: 'LEVEL_ABORTED',
+          name: 'AbortError'
+        })
+      }
+
+      const context = this[kContext]
+      const id = this.#nextCompactionId
+      const abort = () => binding.db_compact_range_abort(context, id)
+
+      this.#nextCompactionId = (id + 1) >>> 0
       start = keyEncoding.encode(start)
       end = keyEncoding.encode(end)
-      return binding.db_compact_range(this[kContext], start, end)
+
+      if (signal === null) {
+        return binding.db_compact_range(context, id, start, end, onProgress)
+      }
+
+      signal.addEventListener('abort', abort, { once: true })
+
+      try {
+        return await binding.db_compact_range(context, id, start, end, onProgress)
+      } finally {
+        signal.removeEventListener('abort', abort)
+      }
     }
   }
 
@@ -301,6 +349,14 @@ class Snapshot extends AbstractSnapshot {
   }
 }
 
+function isCompression (value) {
+  return typeof value === 'boolean' || compressionTypes.has(value)
+}
+
+function isPositiveInteger (value) {
+  return Number.isInteger(value) && value > 0 && value < 2 ** 32
+}
+
 exports.ClassicLevel = ClassicLevel
 
 // Singular values are cheaper to transfer from JS to C++, so we
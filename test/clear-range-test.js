@@ -0,0 +1,84 @@
+'use strict'
+
+const test = require('tape')
+const fs = require('fs')
+const testCommon = require('./common')
+
+const value = Buffer.alloc(1024, 1)
+const count = 2000
+
+function key (i) {
+  return String(i).padStart(6, '0')
+}
+
+function numFiles (db) {
+  let total = 0
+  for (let i = 1; i < 7; i++) {
+    total += Number(db.getProperty('leveldb.num-files-at-level' + i))
+  }
+  return total
+}
+
+async function populate (db) {
+  const batch = db.batch()
+  for (let i = 0; i < count; i++) batch.put(key(i), value)
+  await batch.write()
+  await db.compactRange(key(0), key(count))
+}
+
+test('clear() removes table files covered by the range', async function (t) {
+  const db = testCommon.factory({ writeBufferSize: 64 * 1024, maxFileSize: 64 * 1024, compression: false })
+  await db.open()
+  await populate(db)
+
+  const filesBefore = numFiles(db)
+  t.ok(filesBefore > 2, 'has table files')
+
+  await db.clear({ gt: key(100), lte: key(1900) })
+  t.ok(numFiles(db) < filesBefore, 'removed table files')
+
+  t.same(await db.getMany([key(100), key(101), key(1000), key(1900), key(1901)], { valueEncoding: 'buffer' }), [
+    value, undefined, undefined, undefined, value
+  ])
+
+  t.same(await db.keys({ gte: key(99), lte: key(1902) }).all(), [
+    key(99), key(100), key(1901), key(1902)
+  ])
+
+  await db.clear()
+  t.is(numFiles(db), 0, 'removed all table files')
+  t.same(fs.readdirSync(db.location).filter(f => f.endsWith('.ldb')), [], 'unlinked table files')
+  t.same(await db.keys().all(), [])
+
+  return db.close()
+})
+
+test('clear() does not remove table files visible to a snapshot', async function (t) {
+  const db = testCommon.factory({ writeBufferSize: 64 * 1024, maxFileSize: 64 * 1024, compression: false })
+  await db.open()
+  await populate(db)
+
+  const snapshot = db.snapshot()
+  await db.clear()
+
+  t.is(await db.get(key(1000)), undefined)
+  t.same(await db.get(key(1000), { snapshot, valueEncoding: 'buffer' }), value)
+
+  await snapshot.close()
+  return db.close()
+})
+
+test('clear() does not remove writes made after it was called', async function (t) {
+  const db = testCommon.factory({ writeBufferSize: 64 * 1024, maxFileSize: 64 * 1024, compression: false })
+  await db.open()
+  await populate(db)
+
+  const promise = db.clear()
+  await db.put(key(1000), 'after')
+  await promise
+
+  t.is(await db.get(key(1000)), 'after')
+  t.same(await db.keys().all(), [key(1000)])
+
+  return db.close()
+})
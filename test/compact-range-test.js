@@ -41,6 +41,91 @@ test('compactRange() frees disk space after key deletion', async function (t) {
   t.ok(sizeAfterCompact < sizeAfterPuts)
 })
 
+test('compactRange() reports progress', async function (t) {
+  const batch = db.batch()
+  const progress = []
+
+  for (let i = 0; i < 1000; i++) {
+    batch.put(String(i).padStart(6, '0'), Buffer.alloc(1024))
+  }
+
+  await batch.write()
+  await db.compactRange('0', 'z', { onProgress: (p) => progress.push(p) })
+
+  t.ok(progress.length > 0, 'called onProgress')
+
+  const last = progress[progress.length - 1]
+  t.is(last.levelsDone, last.levelsTotal)
+  t.ok(last.bytesWritten > 0)
+})
+
+test('compactRange() can be aborted', async function (t) {
+  t.plan(3)
+
+  const controller = new AbortController()
+  const progress = []
+
+  // Compact the range once so that the writes below overlap a level other
+  // than level 0. Their compaction then takes more than one step.
+  await db.put('000000', 'x')
+  await db.compactRange('0', 'z')
+
+  const batch = db.batch()
+
+  for (let i = 0; i < 1000; i++) {
+    batch.put(String(i).padStart(6, '0'), Buffer.alloc(1024))
+  }
+
+  await batch.write()
+
+  // Abort before the first step completes, rather than from onProgress,
+  // which is called asynchronously and may thus be too late
+  const promise = db.compactRange('0', 'z', {
+    signal: controller.signal,
+    onProgress: (p) => progress.push(p)
+  })
+
+  controller.abort()
+
+  try {
+    await promise
+  } catch (err) {
+    t.is(err.code, 'LEVEL_ABORTED')
+    t.is(err.name, 'AbortError')
+  }
+
+  const last = progress[progress.length - 1]
+  t.ok(last.levelsDone < last.levelsTotal, 'stopped before the last step')
+})
+
+test('compactRange() resolves if aborted after the last step', async function (t) {
+  const controller = new AbortController()
+  let last = null
+
+  await db.compactRange('0', 'z', {
+    signal: controller.signal,
+    onProgress: (p) => {
+      last = p
+      if (p.levelsDone === p.levelsTotal) controller.abort()
+    }
+  })
+
+  t.is(last.levelsDone, last.levelsTotal)
+})
+
+test('compactRange() rejects if signal was already aborted', async function (t) {
+  t.plan(1)
+
+  const controller = new AbortController()
+  controller.abort()
+
+  try {
+    await db.compactRange('0', 'z', { signal: controller.signal })
+  } catch (err) {
+    t.is(err.code, 'LEVEL_ABORTED')
+  }
+})
+
 test('compactRange() teardown', async function (t) {
   return db.close()
 })
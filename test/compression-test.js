@@ -3,6 +3,7 @@
 const du = require('du')
 const testCommon = require('./common')
 const { ClassicLevel } = require('..')
+const binding = require('../binding')
 const test = require('tape')
 
 const compressableData = Buffer.from(Array.apply(null, Array(1024 * 100)).map(function () {
@@ -38,7 +39,7 @@ const cycle = async function (db, compression) {
 }
 
 test('compression', function (t) {
-  t.plan(4)
+  t.plan(7)
 
   t.test('data is compressed by default (db.put())', async function (t) {
     const db = testCommon.factory()
@@ -91,4 +92,135 @@ test('compression', function (t) {
     await cycle(db, false)
     await verify(db.location, false, t)
   })
+  t.test('data is not compressed with compression=\'none\' on open() (db.batch())', async function (t) {
+    const db = testCommon.factory()
+    await db.open({ compression: 'none' })
+
+    const operations = Array.apply(null, Array(multiples)).map(function (e, i) {
+      return { type: 'put', key: String(i), value: compressableData }
+    })
+
+    await db.batch(operations)
+    await cycle(db, 'none')
+    await verify(db.location, false, t)
+  })
+
+  for (const compression of ['lz4', 'zstd']) {
+    t.test(`data is compressed with compression='${compression}' if built with it (db.batch())`, async function (t) {
+      const db = testCommon.factory({ compression })
+
+      // LZ4 and Zstandard are opt-in at build time
+      if (!binding.compression_supported(compression)) {
+        try {
+          await db.open()
+          t.fail('should have failed')
+        } catch (err) {
+          t.is(err.code, 'LEVEL_DATABASE_NOT_OPEN')
+          t.ok(/not supported/.test(err.cause.message), 'not supported by this build')
+        }
+        return
+      }
+
+      await db.open()
+
+      const operations = Array.apply(null, Array(multiples)).map(function (e, i) {
+        return { type: 'put', key: String(i), value: compressableData }
+      })
+
+      await db.batch(operations)
+      await cycle(db, compression)
+      await verify(db.location, true, t)
+
+      const reopened = new ClassicLevel(db.location)
+      await reopened.open({ compression })
+      t.same(await reopened.get('0', { valueEncoding: 'buffer' }), compressableData)
+      await reopened.close()
+    })
+  }
+})
+
+test('compression option must be a boolean or a known algorithm', async function (t) {
+  const db = testCommon.factory({ compression: 'gzip' })
+
+  try {
+    await db.open()
+    t.fail('should have thrown')
+  } catch (err) {
+    t.is(err.code, 'LEVEL_DATABASE_NOT_OPEN')
+    t.is(err.cause.name, 'TypeError')
+  }
+})
+
+test('compressionPerLevel overrides compression', function (t) {
+  t.plan(2)
+
+  for (const [compression, compressionPerLevel] of [[true, [false]], [false, [false, true]]]) {
+    t.test(`compression=${compression}, compressionPerLevel=${JSON.stringify(compressionPerLevel)}`, async function (t) {
+      const db = testCommon.factory({ compression, compressionPerLevel })
+      await db.open()
+
+      const operations = Array.apply(null, Array(multiples)).map(function (e, i) {
+        return { type: 'put', key: String(i), value: compressableData }
+      })
+
+      // New data is written to level 0 to 2
+      await db.batch(operations)
+      await db.compactRange('0', '9')
+      await db.close()
+      await verify(db.location, compressionPerLevel[compressionPerLevel.length - 1], t)
+    })
+  }
+})
+
+test('compressionDictionarySize shrinks small zstd-compressed values', { skip: !binding.compression_supported('zstd') }, async function (t) {
+  const sizes = []
+
+  for (const compressionDictionarySize of [0, 4096]) {
+    const db = testCommon.factory({ compression: 'zstd', compressionDictionarySize })
+    await db.open()
+
+    // Enough small JSON documents to train a dictionary on
+    const operations = Array.from({ length: 3000 }, function (e, i) {
+      return {
+        type: 'put',
+        key: String(i).padStart(6, '0'),
+        value: JSON.stringify({
+          id: i,
+          name: 'user' + ((i * 7919) % 1000003),
+          status: ['active', 'suspended', 'deleted'][i % 3],
+          settings: { theme: i % 2 ? 'dark' : 'light', language: 'en-US' },
+          score: (i * 104729) % 100000
+        })
+      }
+    })
+
+    await db.batch(operations)
+    await db.compactRange('000000', '999999')
+    t.same(await db.get('001234'), operations[1234].value)
+    await db.close()
+
+    sizes.push(await new Promise(function (resolve, reject) {
+      du(db.location, function (err, size) {
+        if (err) reject(err)
+        else resolve(size)
+      })
+    }))
+  }
+
+  t.ok(sizes[1] < sizes[0], `size with dictionary (${sizes[1]}) is less than without (${sizes[0]})`)
+})
+
+test('compressionThreads compresses blocks in parallel', async function (t) {
+  const db = testCommon.factory({ compressionThreads: 2 })
+  await db.open()
+
+  const operations = Array.apply(null, Array(multiples)).map(function (e, i) {
+    return { type: 'put', key: String(i), value: compressableData }
+  })
+
+  await db.batch(operations)
+  await db.compactRange('0', '9')
+  t.same(await db.get('5', { valueEncoding: 'buffer' }), compressableData)
+  await db.close()
+  await verify(db.location, true, t)
 })
@@ -38,3 +38,223 @@ test('getSync() with growing sharedBuffer', async function (t) {
   await db.put(longKey, 'b')
   t.is(db.getSync(longKey), 'b')
 })
+
+test('get() with coalesceGets', async function (t) {
+  const db = testCommon.factory({ coalesceGets: true })
+  await db.open()
+  await db.put('a', 'foo')
+
+  const values = await Promise.all(Array(100).fill('a').map((k) => db.get(k)))
+  t.ok(values.every((v) => v === 'foo'), 'resolved all gets')
+
+  const buffers = await Promise.all([
+    db.get('a', { valueEncoding: 'buffer' }),
+    db.get('a', { valueEncoding: 'buffer' })
+  ])
+  t.isNot(buffers[0], buffers[1], 'does not share buffers')
+  t.same(buffers[0], buffers[1])
+
+  t.same(await Promise.all([db.get('b'), db.get('b')]), [undefined, undefined])
+
+  // Must not join a get that may have missed this write
+  const pending = db.get('a')
+  await db.put('a', 'bar')
+  t.is(await db.get('a'), 'bar', 'sees completed write')
+  await pending
+
+  return db.close()
+})
+
+test('get() with coalesceGets sees writes of another instance', async function (t) {
+  const db1 = testCommon.factory({ coalesceGets: true, multithreading: true })
+  await db1.open()
+  const db2 = new db1.constructor(db1.location, { multithreading: true })
+  await db2.open()
+  await db1.put('a', 'foo')
+
+  const pending = db1.get('a')
+  await db2.put('a', 'bar')
+  t.is(await db1.get('a'), 'bar', 'sees completed write')
+  await pending
+
+  await db2.close()
+  return db1.close()
+})
+
+test('get() with filter options', async function (t) {
+  for (const options of [
+    { filterType: 'blocked-bloom' },
+    { filterType: 'ribbon' },
+    { filterType: 'ribbon', wholeTableFilter: true },
+    { filterBitsPerKey: 0 }
+  ]) {
+    const db = testCommon.factory({ ...options, writeBufferSize: 64 * 1024 })
+    await db.open()
+
+    const batch = db.batch()
+    for (let i = 0; i < 1000; i++) batch.put(String(i).padStart(4, '0'), 'a' + i)
+    await batch.write()
+    await db.compactRange('0', 'z')
+
+    t.is(await db.get('0001'), 'a1', JSON.stringify(options))
+    t.is(await db.get('0999'), 'a999', JSON.stringify(options))
+    t.is(await db.get('1000'), undefined, JSON.stringify(options))
+
+    await db.close()
+  }
+})
+
+test('get() with indexPartitionSize', async function (t) {
+  const db = testCommon.factory({ indexPartitionSize: 128, blockSize: 256, writeBufferSize: 64 * 1024 })
+  await db.open()
+
+  const batch = db.batch()
+  for (let i = 0; i < 1000; i++) batch.put(String(i).padStart(4, '0'), 'a' + i)
+  await batch.write()
+  await db.compactRange('0', 'z')
+
+  for (let i = 0; i < 1000; i += 37) {
+    t.is(await db.get(String(i).padStart(4, '0')), 'a' + i)
+  }
+  t.is(await db.get('1000'), undefined)
+
+  const entries = await db.iterator({ gte: '0990' }).all()
+  t.same(entries.map(e => e[0]), ['0990', '0991', '0992', '0993', '0994', '0995', '0996', '0997', '0998', '0999'])
+
+  return db.close()
+})
+
+test('get() with dataBlockHashIndex', async function (t) {
+  const db = testCommon.factory({ dataBlockHashIndex: true, blockRestartInterval: 4, writeBufferSize: 64 * 1024 })
+  await db.open()
+
+  const batch = db.batch()
+  for (let i = 0; i < 1000; i += 2) batch.put(String(i).padStart(4, '0'), 'a' + i)
+  await batch.write()
+  await db.compactRange('0', 'z')
+
+  // Keep the old version of a key in the table files
+  const snapshot = db.snapshot()
+  await db.put('0010', 'b')
+  await db.compactRange('0', 'z')
+
+  for (let i = 0; i < 1000; i += 37) {
+    const key = String(i).padStart(4, '0')
+    t.is(await db.get(key), i % 2 === 0 ? 'a' + i : undefined, key)
+  }
+
+  t.is(await db.get('0010'), 'b')
+  t.is(await db.get('0010', { snapshot }), 'a10')
+  t.is(await db.get('1000'), undefined)
+
+  const entries = await db.iterator({ gte: '0989', lte: '0995' }).all()
+  t.same(entries.map(e => e[0]), ['0990', '0992', '0994'])
+
+  await snapshot.close()
+  return db.close()
+})
+
+test('get() with rowCacheSize', async function (t) {
+  const db = testCommon.factory({ rowCacheSize: 1024 * 1024, writeBufferSize: 64 * 1024 })
+  await db.open()
+
+  const batch = db.batch()
+  for (let i = 0; i < 1000; i++) batch.put(String(i).padStart(4, '0'), 'a' + i)
+  await batch.write()
+  await db.compactRange('0', 'z')
+
+  t.is(await db.get('0001'), 'a1')
+  t.is(await db.get('0001'), 'a1', 'cached')
+
+  // Write and move the new value to a table file
+  await db.put('0001', 'b')
+  await db.del('0002')
+  await db.compactRange('0', 'z')
+
+  t.is(await db.get('0001'), 'b', 'invalidated by update')
+  t.is(await db.get('0002'), undefined, 'invalidated by delete')
+
+  return db.close()
+})
+
+test('get() with compressedCacheSize', async function (t) {
+  // A block cache that holds few blocks, so that most reads use the compressed cache
+  const db = testCommon.factory({ cacheSize: 16 * 1024, compressedCacheSize: 1024 * 1024 })
+  await db.open()
+
+  const batch = db.batch()
+  for (let i = 0; i < 2000; i++) batch.put(String(i).padStart(4, '0'), 'value ' + i + ' '.repeat(100))
+  await batch.write()
+  await db.compactRange('0', 'z')
+
+  for (let round = 0; round < 2; round++) {
+    for (const i of [1, 500, 1999, 1000]) {
+      t.is(await db.get(String(i).padStart(4, '0')), 'value ' + i + ' '.repeat(100))
+    }
+  }
+
+  return db.close()
+})
+
+test('get() and iterator with mmapReads', async function (t) {
+  // Only some of the table files are mapped
+  const db = testCommon.factory({ mmapReads: true, maxMmapFiles: 1, maxFileSize: 64 * 1024, cacheSize: 16 * 1024 })
+  await db.open()
+
+  const batch = db.batch()
+  for (let i = 0; i < 2000; i++) batch.put(String(i).padStart(4, '0'), 'value ' + i + ' '.repeat(100))
+  await batch.write()
+  await db.compactRange('0', 'z')
+
+  for (const i of [1, 500, 1999, 1000]) {
+    t.is(await db.get(String(i).padStart(4, '0')), 'value ' + i + ' '.repeat(100))
+  }
+
+  const entries = await db.iterator({ fillCache: false }).all()
+  t.is(entries.length, 2000)
+  t.same(entries[1999], ['1999', 'value 1999' + ' '.repeat(100)])
+
+  return db.close()
+})
+
+test('getMany() and hasMany() read blocks at once', async function (t) {
+  // Table files are read with system calls rather than mapped
+  const db = testCommon.factory({ mmapReads: true, maxMmapFiles: 0, maxFileSize: 64 * 1024, cacheSize: 16 * 1024 })
+  await db.open()
+
+  const batch = db.batch()
+  for (let i = 0; i < 2000; i++) batch.put(String(i).padStart(4, '0'), 'value ' + i + ' '.repeat(100))
+  await batch.write()
+  await db.compactRange('0', 'z')
+  await db.put('0003', 'newer')
+  await db.del('0007')
+
+  const keys = ['1999', '0003', '0500', '0007', 'x', '1000', '0001']
+  t.same(await db.getMany(keys), ['value 1999' + ' '.repeat(100), 'newer', 'value 500' + ' '.repeat(100), undefined, undefined, 'value 1000' + ' '.repeat(100), 'value 1' + ' '.repeat(100)])
+  t.same(await db.getMany(keys, { fillCache: false }), await db.getMany(keys))
+
+  t.same(await db.hasMany(keys), [true, true, true, false, false, true, true])
+
+  return db.close()
+})
+
+test('get() and iterator with directIO', async function (t) {
+  const db = testCommon.factory({ directIO: true, maxFileSize: 64 * 1024, cacheSize: 16 * 1024 })
+  await db.open()
+
+  const batch = db.batch()
+  for (let i = 0; i < 2000; i++) batch.put(String(i).padStart(4, '0'), 'value ' + i + ' '.repeat(100))
+  await batch.write()
+  await db.compactRange('0', 'z')
+
+  for (const i of [1, 500, 1999, 1000]) {
+    t.is(await db.get(String(i).padStart(4, '0')), 'value ' + i + ' '.repeat(100))
+  }
+  t.same(await db.getMany(['0002', 'x', '1998']), ['value 2' + ' '.repeat(100), undefined, 'value 1998' + ' '.repeat(100)])
+
+  const entries = await db.iterator().all()
+  t.is(entries.length, 2000)
+  t.same(entries[1999], ['1999', 'value 1999' + ' '.repeat(100)])
+
+  return db.close()
+})
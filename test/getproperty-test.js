@@ -53,6 +53,45 @@ test('invalid getProperty("leveldb.sstables")', function (t) {
   t.end()
 })
 
+test('getProperty("leveldb.negative-cache")', async function (t) {
+  const db = testCommon.factory({ negativeCacheSize: 1024 })
+  await db.open()
+
+  t.is(db.getProperty('leveldb.negative-cache'), 'Lookups: 0\nHits: 0\nHit rate: 0.00%\n')
+
+  t.is(await db.get('missing'), undefined)
+  t.is(await db.has('missing'), false)
+  t.is(db.getProperty('leveldb.negative-cache'), 'Lookups: 2\nHits: 1\nHit rate: 50.00%\n')
+
+  // Invalidated by a write
+  await db.put('missing', 'present')
+  t.is(await db.get('missing'), 'present')
+  t.is(await db.has('missing'), true)
+
+  return db.close()
+})
+
+test('getProperty("leveldb.approximate-memory-usage") with cacheIndexAndFilterBlocks', async function (t) {
+  const usage = []
+
+  for (const cacheIndexAndFilterBlocks of [false, true]) {
+    const db = testCommon.factory({ cacheIndexAndFilterBlocks, writeBufferSize: 64 * 1024 })
+    await db.open()
+
+    const batch = db.batch()
+    for (let i = 0; i < 1000; i++) batch.put(String(i).padStart(4, '0'), 'a' + i)
+    await batch.write()
+    await db.compactRange('0', 'z')
+
+    t.is(await db.get('0500'), 'a500')
+    usage.push(Number(db.getProperty('leveldb.approximate-memory-usage')))
+
+    await db.close()
+  }
+
+  t.ok(usage[1] > usage[0], 'includes index and filter blocks')
+})
+
 test('getProperty() teardown', async function (t) {
   return db.close()
 })
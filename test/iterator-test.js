@@ -38,6 +38,31 @@ test('iterator optimized for seek', async function (t) {
   return db.close()
 })
 
+test('iterator with cacheDecodedBlocks', async function (t) {
+  const db = testCommon.factory({ cacheDecodedBlocks: true, writeBufferSize: 64 * 1024 })
+  await db.open()
+
+  const batch = db.batch()
+  for (let i = 0; i < 1000; i++) batch.put(String(i).padStart(4, '0'), 'a' + i)
+  await batch.write()
+  await db.compactRange('0', 'z')
+
+  const expected = []
+  for (let i = 0; i < 1000; i++) expected.push(String(i).padStart(4, '0'))
+
+  // The first scans decode the blocks, later ones read the decoded copies
+  for (let i = 0; i < 2; i++) {
+    t.same(await db.keys().all(), expected)
+    t.same(await db.keys({ reverse: true }).all(), expected.slice().reverse())
+    t.same(await db.iterator({ gte: '0500', limit: 2 }).all(), [['0500', 'a500'], ['0501', 'a501']])
+  }
+
+  t.is(await db.get('0123'), 'a123')
+  t.is(await db.get('1000'), undefined)
+
+  return db.close()
+})
+
 // TODO: move to abstract-level
 for (const slice of [false, true]) {
   test(`nextv() after next() respects cache (slice=${slice})`, async function (t) {
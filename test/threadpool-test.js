@@ -0,0 +1,24 @@
+'use strict'
+
+const test = require('tape')
+const fork = require('child_process').fork
+const path = require('path')
+
+test('bulk and background work leaves a thread for get()', function (t) {
+  t.plan(3)
+
+  const child = fork(path.join(__dirname, 'threadpool.js'), {
+    env: { ...process.env, CLASSIC_LEVEL_THREADPOOL_SIZE: '2' },
+    execArgv: [...process.execArgv, '--unhandled-rejections=strict']
+  })
+
+  child.on('message', function (order) {
+    t.is(order[0], 'interactive', `completed first: ${order.join(', ')}`)
+    child.disconnect()
+  })
+
+  child.on('exit', function (code, sig) {
+    t.is(code, 0, 'child exited normally')
+    t.is(sig, null, 'not terminated due to signal')
+  })
+})
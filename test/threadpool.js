@@ -0,0 +1,44 @@
+'use strict'
+
+const testCommon = require('./common')
+
+// Saturate the thread pool with bulk and background work, then check
+// that a get() is not queued behind it. Runs in a child process because
+// the pool size is read once per process.
+async function test () {
+  const db = testCommon.factory()
+  const keys = []
+  const ops = []
+
+  for (let i = 0; i < 2e4; i++) {
+    const key = String(i).padStart(6, '0')
+    keys.push(key)
+    ops.push({ type: 'put', key, value: 'x'.repeat(100) })
+  }
+
+  await db.open()
+  await db.batch(ops)
+
+  // Reopen without a block cache so that reads hit the disk
+  await db.close()
+  await db.open({ cacheSize: 0 })
+
+  const order = []
+  const pending = []
+
+  for (let i = 0; i < 4; i++) {
+    const gte = keys[i * 5e3]
+    const lt = keys[(i + 1) * 5e3] || '~'
+
+    pending.push(db.getMany(keys, { fillCache: false }).then(() => order.push('bulk')))
+    pending.push(db.clear({ gte, lt }).then(() => order.push('background')))
+  }
+
+  await db.get(keys[1]).then(() => order.push('interactive'))
+  await Promise.all(pending)
+  await db.close()
+
+  process.send(order)
+}
+
+test()